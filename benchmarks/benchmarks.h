@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+// registers EVTCParser::parse for every log in the manifest.json of a corpus written by tools/evtc_generator.py, returns false if there is none
+bool register_evtc_parser_benchmarks(const std::filesystem::path& corpus_directory);
+
+// registers Subprocess::wait with the benchmarks executable started as the child, which then runs write_subprocess_output instead
+void register_subprocess_benchmarks(const std::filesystem::path& executable_file);
+
+// writes the number of bytes to stdout, returns the exit code of the child
+int write_subprocess_output(uint64_t bytes);
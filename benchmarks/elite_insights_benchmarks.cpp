@@ -0,0 +1,131 @@
+#include "elite_insights_report.h"
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+// stdout of a successful run, progress lines followed by the result and the generated reports
+std::string make_output(int64_t progress_lines)
+{
+	std::string output;
+
+	for (int64_t i = 0; i < progress_lines; ++i)
+		output += "20240101-120000.zevtc: Parsing combat events - " + std::to_string(i * 100 / progress_lines) + "%\r\n";
+
+	output += "Parsing Successful - 20240101-120000.zevtc: Vale Guardian - Success\r\n";
+	output += "Completed parsing for 20240101-120000.zevtc\r\n";
+	output += "Generated: C:\\Users\\Player\\Documents\\Guild Wars 2\\addons\\log-uploader\\log-data\\20240101-120000_vg_kill.json\r\n";
+	output += "Generated: C:\\Users\\Player\\Documents\\Guild Wars 2\\addons\\log-uploader\\log-data\\20240101-120000_vg_kill.html\r\n";
+	output += "Completed for 20240101-120000.zevtc\r\n";
+
+	return output;
+}
+
+// json report with the layout of Elite Insights, the per player rotations and skill and buff maps make up most of it as in real reports
+std::string make_report(int64_t players)
+{
+	nlohmann::json report;
+
+	report["eliteInsightsVersion"] = "3.10.0.0";
+	report["triggerID"] = 15438;
+	report["fightName"] = "Vale Guardian";
+	report["recordedBy"] = "Character Zero";
+	report["recordedAccountBy"] = "Account.0000";
+	report["timeStartStd"] = "2024-01-01 12:00:00 +01:00";
+	report["timeEndStd"] = "2024-01-01 12:05:00 +01:00";
+	report["durationMS"] = 300000;
+	report["success"] = true;
+	report["isCM"] = false;
+	report["isLegendaryCM"] = false;
+
+	for (int target = 0; target < 4; ++target)
+	{
+		nlohmann::json entry = { { "id", target == 0 ? 15438 : 15420 + target }, { "name", "Target " + std::to_string(target) }, { "healthPercentBurned", target == 0 ? 100.0 : 37.5 } };
+
+		for (int phase = 0; phase < 8; ++phase)
+			entry["dpsAll"].push_back({ { "damage", 1000000 + phase }, { "dps", 3333 + phase }, { "breakbarDamage", 12.5 } });
+
+		for (int point = 0; point < 300; ++point)
+			entry["healthPercents"].push_back({ point * 1000, 100.0 - point / 3.0 });
+
+		report["targets"].push_back(entry);
+	}
+
+	for (int64_t player = 0; player < players; ++player)
+	{
+		nlohmann::json entry = { { "name", "Character " + std::to_string(player) }, { "account", "Account." + std::to_string(1000 + player) }, { "group", player / 5 + 1 }, { "profession", "Guardian" } };
+
+		for (int skill = 0; skill < 120; ++skill)
+		{
+			nlohmann::json rotation = { { "id", 9000 + skill } };
+
+			for (int cast = 0; cast < 25; ++cast)
+				rotation["skills"].push_back({ { "castTime", cast * 11000 + skill }, { "duration", 750 }, { "timeGained", 0 }, { "quickness", 0.5 } });
+
+			entry["rotation"].push_back(rotation);
+		}
+
+		for (int buff = 0; buff < 60; ++buff)
+			entry["buffUptimes"].push_back({ { "id", 700 + buff }, { "buffData", { { { "uptime", 87.5 }, { "presence", 0.0 } } } }, { "states", { { 0, 1 }, { 15000, 0 }, { 30000, 1 } } } });
+
+		report["players"].push_back(entry);
+	}
+
+	for (int skill = 0; skill < 600; ++skill)
+		report["skillMap"]["s" + std::to_string(9000 + skill)] = { { "name", "Skill " + std::to_string(skill) }, { "autoAttack", false }, { "icon", "https://render.guildwars2.com/file/0000000000000000000000000000000000000000/000000.png" } };
+
+	for (int buff = 0; buff < 300; ++buff)
+		report["buffMap"]["b" + std::to_string(700 + buff)] = { { "name", "Buff " + std::to_string(buff) }, { "stacking", buff % 2 == 0 }, { "icon", "https://render.guildwars2.com/file/0000000000000000000000000000000000000000/000000.png" } };
+
+	return report.dump();
+}
+} // namespace
+
+static void BM_EliteInsightsOutputScan(benchmark::State& state)
+{
+	auto output = make_output(state.range(0));
+
+	for (auto _ : state)
+	{
+		auto scanned_output = EliteInsightsOutput::scan(output);
+		benchmark::DoNotOptimize(scanned_output);
+	}
+
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * output.size()));
+}
+BENCHMARK(BM_EliteInsightsOutputScan)->Name("EliteInsightsOutput::scan")->ArgName("lines")->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_ReadEncounterReport(benchmark::State& state)
+{
+	auto report = make_report(state.range(0));
+
+	for (auto _ : state)
+	{
+		std::istringstream stream(report);
+		auto encounter = read_encounter_report(stream);
+		benchmark::DoNotOptimize(encounter);
+	}
+
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * report.size()));
+}
+BENCHMARK(BM_ReadEncounterReport)->Name("read_encounter_report")->ArgName("players")->Arg(10)->Arg(50)->Unit(benchmark::kMillisecond);
+
+// reference for read_encounter_report, the same report parsed without discarding the fields it does not read
+static void BM_ParseWholeReport(benchmark::State& state)
+{
+	auto report = make_report(state.range(0));
+
+	for (auto _ : state)
+	{
+		std::istringstream stream(report);
+		auto json = nlohmann::json::parse(stream);
+		benchmark::DoNotOptimize(json);
+	}
+
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * report.size()));
+}
+BENCHMARK(BM_ParseWholeReport)->Name("nlohmann::json::parse/report")->ArgName("players")->Arg(10)->Arg(50)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,45 @@
+#include "benchmarks.h"
+#include "evtc_parser.h"
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <string>
+
+bool register_evtc_parser_benchmarks(const std::filesystem::path& corpus_directory)
+{
+	std::ifstream manifest_file(corpus_directory / "manifest.json");
+
+	if (!manifest_file.is_open())
+		return false;
+
+	for (const auto& entry : nlohmann::json::parse(manifest_file))
+	{
+		auto file_path = corpus_directory / entry.at("file").get<std::string>();
+		auto evtc_size = entry.at("evtc_size").get<uint64_t>();
+		auto events = entry.at("events").get<uint64_t>();
+
+		// named after the format and size, e.g. EVTCParser::parse/zevtc/10M, so results of different corpora line up
+		auto extension = file_path.extension().string().substr(1);
+		auto megabytes = (evtc_size + (1 << 19)) >> 20;
+		auto size = megabytes > 0 ? std::to_string(megabytes) + "M" : std::to_string((evtc_size + (1 << 9)) >> 10) + "K";
+
+		benchmark::RegisterBenchmark(("EVTCParser::parse/" + extension + "/" + size).c_str(),
+			[file_path, evtc_size, events](benchmark::State& state) {
+				for (auto _ : state)
+				{
+					auto data = addon::evtc_parser->parse(file_path);
+					benchmark::DoNotOptimize(data);
+				}
+
+				// the whole evtc is read for its hash, throughput is per uncompressed byte
+				state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * evtc_size));
+				state.counters["events"] = static_cast<double>(events);
+			})
+			->Unit(benchmark::kMillisecond)
+			->UseRealTime();
+	}
+
+	return true;
+}
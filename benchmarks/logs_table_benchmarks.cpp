@@ -0,0 +1,97 @@
+#include "log_table_entry.h"
+#include "settings.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace
+{
+LogData make_log_data(bool parsed)
+{
+	LogData data;
+
+	data.trigger_id = TriggerID::ValeGuardian;
+	data.evtc_file_time = std::chrono::system_clock::time_point(std::chrono::seconds(1704110400));
+
+	if (parsed)
+	{
+		data.parser_data.status = ParseStatus::PARSED;
+		data.parser_data.encounter.name = "Vale Guardian";
+		data.parser_data.encounter.duration_ms = 283456;
+		data.parser_data.encounter.has_boss = true;
+		data.parser_data.encounter.health_percent_burned = 62.5f;
+		data.parser_data.encounter.end_time = data.evtc_file_time;
+	}
+
+	return data;
+}
+
+// every encounter known to the addon, in the order the encounter selector lists them
+std::vector<TriggerID> get_trigger_ids()
+{
+	std::vector<TriggerID> trigger_ids;
+
+	for (const auto& category : EncounterCategories)
+		for (const auto& instance : category.instances)
+			for (const auto& encounter : instance.encounters)
+				trigger_ids.insert(trigger_ids.end(), encounter.triggers.begin(), encounter.triggers.end());
+
+	return trigger_ids;
+}
+} // namespace
+
+static void BM_UpdateView(benchmark::State& state)
+{
+	LogTableEntry entry(nullptr);
+	entry.data = make_log_data(state.range(0) != 0);
+
+	for (auto _ : state)
+	{
+		entry.update_view();
+		benchmark::DoNotOptimize(entry.view);
+	}
+}
+BENCHMARK(BM_UpdateView)->Name("LogTableEntry::update_view")->ArgName("parsed")->Arg(0)->Arg(1);
+
+static void BM_EncounterNamesLookup(benchmark::State& state)
+{
+	auto trigger_ids = get_trigger_ids();
+
+	// as many ids the addon has no name for, above the highest known one
+	if (state.range(0) == 0)
+		for (size_t i = 0; i < trigger_ids.size(); ++i)
+			trigger_ids[i] = static_cast<TriggerID>(50000 + i);
+
+	for (auto _ : state)
+	{
+		for (auto trigger_id : trigger_ids)
+		{
+			auto it = EncounterNames.find(trigger_id);
+			benchmark::DoNotOptimize(it);
+		}
+	}
+
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * trigger_ids.size()));
+}
+BENCHMARK(BM_EncounterNamesLookup)->Name("EncounterNames::find")->ArgName("known")->Arg(1)->Arg(0);
+
+static void BM_AutoUploadEncounterFilter(benchmark::State& state)
+{
+	auto trigger_ids = get_trigger_ids();
+
+	// the first selected encounters, 0 selects all of them
+	EncounterSelection selection(trigger_ids.begin(), state.range(0) > 0 ? trigger_ids.begin() + std::min<size_t>(state.range(0), trigger_ids.size()) : trigger_ids.end());
+
+	for (auto _ : state)
+	{
+		for (auto trigger_id : trigger_ids)
+		{
+			auto selected = is_encounter_selected(selection, trigger_id);
+			benchmark::DoNotOptimize(selected);
+		}
+	}
+
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * trigger_ids.size()));
+}
+BENCHMARK(BM_AutoUploadEncounterFilter)->Name("is_encounter_selected")->ArgName("selected")->Arg(1)->Arg(10)->Arg(0);
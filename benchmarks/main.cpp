@@ -0,0 +1,47 @@
+#include "benchmarks.h"
+
+#include <benchmark/benchmark.h>
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+int main(int argc, char** argv)
+{
+	// started as the child of the Subprocess benchmarks
+	if (argc == 2 && std::string_view(argv[1]).starts_with("--write-output="))
+		return write_subprocess_output(std::stoull(std::string(std::string_view(argv[1]).substr(std::string_view("--write-output=").size()))));
+
+	// relative to the working directory, which the benchmarks do not change
+	auto executable_file = std::filesystem::absolute(argv[0]);
+
+	benchmark::Initialize(&argc, argv);
+
+	// the corpus generated by the build unless --corpus points at another one, e.g. with larger logs
+	std::filesystem::path corpus_directory = BENCHMARK_CORPUS_DIRECTORY;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view argument = argv[i];
+
+		if (!argument.starts_with("--corpus="))
+		{
+			std::cerr << "Unknown argument: " << argument << std::endl;
+			return 1;
+		}
+
+		corpus_directory = argument.substr(std::string_view("--corpus=").size());
+	}
+
+	if (!register_evtc_parser_benchmarks(corpus_directory))
+		std::cerr << "No corpus in " << corpus_directory.string() << ", EVTCParser::parse is skipped" << std::endl;
+
+	register_subprocess_benchmarks(executable_file);
+
+	benchmark::AddCustomContext("corpus", corpus_directory.string());
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// the modules only pass the MumbleLink data around, its layout is never read outside the ui
+namespace Mumble
+{
+struct Data;
+}
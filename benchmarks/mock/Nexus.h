@@ -0,0 +1,23 @@
+#pragma once
+
+// the part of the Nexus API the addon modules call outside of main.cpp and the ui, the replay harness fills it in with its own functions
+
+enum ELogLevel
+{
+	ELogLevel_OFF = 0,
+	ELogLevel_CRITICAL = 1,
+	ELogLevel_WARNING = 2,
+	ELogLevel_INFO = 3,
+	ELogLevel_DEBUG = 4,
+	ELogLevel_TRACE = 5,
+	ELogLevel_ALL
+};
+
+typedef void (*LOGGER_LOG2)(ELogLevel aLogLevel, const char* aChannel, const char* aStr);
+typedef const char* (*PATHS_GETADDONDIR)(const char* aName);
+
+typedef struct AddonAPI
+{
+	PATHS_GETADDONDIR Paths_GetAddonDirectory;
+	LOGGER_LOG2 Log;
+} AddonAPI_t;
@@ -0,0 +1,688 @@
+#include "addon.h"
+#include "artifact_compressor.h"
+#include "dps_report_uploader.h"
+#include "fingerprint_index.h"
+#include "log_manager.h"
+#include "parse_cost_model.h"
+#include "parser.h"
+#include "retention_manager.h"
+#include "settings.h"
+#include "statistics.h"
+#include "subprocess.h"
+#include "upload_archives.h"
+#include "upload_journal.h"
+#include "wingman_uploader.h"
+
+#include <cpr/cpr.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <thread>
+
+// replays a corpus of logs through the addon without Guild Wars 2, Nexus or Elite Insights: a mock Nexus api, the stub Elite Insights
+// of stub_elite_insights.cpp and, for uploads, tools/upload_stand_in.py. logs are added the way the directory monitor adds them and go
+// through the real LogManager, Parser, DPSReportUploader and WingmanUploader, the result is their throughput, queue depths and memory
+
+namespace
+{
+struct ReplayOptions
+{
+	std::filesystem::path corpus_directory = REPLAY_CORPUS_DIRECTORY;
+	std::filesystem::path work_directory = std::filesystem::temp_directory_path() / "log-uploader-replay";
+
+	// 0 replays every log of the corpus, equal logs would be taken for duplicates so the corpus is never repeated
+	size_t logs = 0;
+
+	// arrival rate, 0 adds all logs at once
+	double logs_per_minute = 0;
+
+	// uploads are disabled without a server
+	std::string dps_report_url;
+	std::string wingman_url;
+
+	// starts tools/upload_stand_in.py with these options and uploads to it where no server is given
+	std::optional<std::string> stand_in_options;
+
+	// handed to the stub Elite Insights through its environment
+	double parse_delay_ms = 500;
+	double parse_ms_per_mb = 100;
+	double parse_failure_rate = 0;
+
+	std::chrono::seconds timeout = std::chrono::minutes(30);
+	std::chrono::milliseconds sample_interval = std::chrono::seconds(1);
+
+	std::filesystem::path output_file;
+	bool verbose = false;
+};
+
+struct CorpusLog
+{
+	std::filesystem::path file_path;
+	TriggerID trigger_id = TriggerID::Invalid;
+};
+
+struct Sample
+{
+	std::chrono::milliseconds time{};
+	std::array<size_t, static_cast<size_t>(PipelineQueue::COUNT)> queue_depths{};
+	MemoryUsage memory;
+	size_t finished_logs = 0;
+};
+
+std::filesystem::path addons_directory;
+std::atomic<bool> verbose = false;
+std::atomic<uint64_t> warnings = 0;
+
+const char* get_addon_directory(const char* name)
+{
+	// the returned strings must outlive the call, entries of the map are never moved
+	static std::mutex mutex;
+	static std::map<std::string, std::string> directories;
+
+	std::lock_guard lock(mutex);
+	auto& directory = directories[name];
+	directory = (addons_directory / name).string();
+
+	return directory.c_str();
+}
+
+void log_message(ELogLevel level, const char* channel, const char* message)
+{
+	if (level <= ELogLevel_WARNING)
+		warnings.fetch_add(1, std::memory_order_relaxed);
+
+	if (level <= ELogLevel_WARNING || verbose.load(std::memory_order_relaxed))
+		std::cerr << "[" << channel << "] " << message << std::endl;
+}
+
+AddonAPI_t api = { get_addon_directory, log_message };
+
+void set_environment(const char* name, double value)
+{
+	auto text = std::to_string(value);
+#ifdef _WIN32
+	_putenv_s(name, text.c_str());
+#else
+	setenv(name, text.c_str(), 1);
+#endif
+}
+
+std::vector<CorpusLog> read_corpus(const std::filesystem::path& corpus_directory)
+{
+	std::ifstream manifest_file(corpus_directory / "manifest.json");
+
+	if (!manifest_file.is_open())
+		throw std::runtime_error("No manifest.json in " + corpus_directory.string());
+
+	std::vector<CorpusLog> corpus;
+
+	for (const auto& entry : nlohmann::json::parse(manifest_file))
+		corpus.push_back({ corpus_directory / entry.at("file").get<std::string>(), static_cast<TriggerID>(entry.at("trigger_id").get<int>()) });
+
+	if (corpus.empty())
+		throw std::runtime_error("Empty corpus in " + corpus_directory.string());
+
+	return corpus;
+}
+
+// tools/upload_stand_in.py in a child process, listening on a port it picks itself
+class StandIn
+{
+public:
+	explicit StandIn(const std::string& options)
+	{
+		std::vector<std::wstring> arguments = { L"-u", std::filesystem::path(UPLOAD_STAND_IN_FILE).wstring(), L"--port", L"0" };
+		std::istringstream option_stream(options);
+
+		for (std::string option; option_stream >> option;)
+			arguments.push_back(std::filesystem::path(option).wstring());
+
+		process = std::make_unique<Subprocess>(PYTHON_EXECUTABLE, arguments);
+
+		wait_thread = std::thread([this]() {
+			try
+			{
+				process->wait(std::chrono::steady_clock::now() + std::chrono::hours(24), [this](std::string_view text) {
+					std::lock_guard lock(mutex);
+
+					if (url.empty())
+						output += text;
+
+					if (auto start = output.find("http://"); url.empty() && start != std::string::npos)
+						if (auto end = output.find_first_of("\r\n", start); end != std::string::npos)
+							url = output.substr(start, end - start);
+
+					cv.notify_all();
+				});
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << std::endl;
+			}
+
+			std::lock_guard lock(mutex);
+			exited = true;
+			cv.notify_all();
+		});
+
+		std::unique_lock lock(mutex);
+
+		if (!cv.wait_for(lock, std::chrono::seconds(10), [this]() { return !url.empty() || exited; }) || url.empty())
+		{
+			lock.unlock();
+			stop();
+			throw std::runtime_error("Failed to start the upload stand-in: " + output);
+		}
+	}
+
+	~StandIn() { stop(); }
+
+	const std::string& get_url() const { return url; }
+
+	// request counts, status codes and handling times per endpoint, empty if the stand-in does not answer
+	nlohmann::json get_statistics() const
+	{
+		auto response = cpr::Get(cpr::Url{ url + "/stats" }, cpr::Timeout{ std::chrono::seconds(10) });
+		return response.status_code == 200 ? nlohmann::json::parse(response.text, nullptr, false) : nlohmann::json();
+	}
+
+private:
+	void stop()
+	{
+		if (wait_thread.joinable())
+		{
+			process->cancel();
+			wait_thread.join();
+		}
+	}
+
+	std::unique_ptr<Subprocess> process;
+	std::thread wait_thread;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::string output;
+	std::string url;
+	bool exited = false;
+};
+
+// an installation the parser loads without any network access, the executable is the stub under the name of the real one
+void install_stub_elite_insights(const std::filesystem::path& addon_directory)
+{
+	auto version_directory = addon_directory / "elite-insights" / "v1.0.0.0";
+
+	std::filesystem::create_directories(version_directory);
+	std::filesystem::copy_file(STUB_ELITE_INSIGHTS_FILE, version_directory / "GuildWars2EliteInsights-CLI.exe", std::filesystem::copy_options::overwrite_existing);
+	std::ofstream(version_directory / ".version") << "v1.0.0.0";
+}
+
+// the modules in the order main.cpp loads them, without Nexus, the ui and the directory monitor
+void load(const ReplayOptions& options, const EncounterSelection& encounters)
+{
+	addon::api = &api;
+	addon::directory = std::filesystem::path(api.Paths_GetAddonDirectory(ADDON_DIRECTORY));
+
+	std::filesystem::create_directories(addon::directory);
+	install_stub_elite_insights(addon::directory);
+
+	addon::settings->initialize();
+	addon::settings->write([&](SettingsData& s) {
+		s.parser.auto_update = false;
+		s.parser.auto_parse = true;
+
+		s.dps_report.auto_upload = !options.dps_report_url.empty();
+		s.dps_report.server_url = options.dps_report_url;
+		s.dps_report.auto_upload_encounters = encounters;
+
+		s.wingman.auto_upload = !options.wingman_url.empty();
+		s.wingman.server_url = options.wingman_url;
+		s.wingman.auto_upload_encounters = encounters;
+
+		s.general.log_level = options.verbose ? LOGLEVEL_DEBUG : LOGLEVEL_INFO;
+	});
+
+	addon::log_level.store(static_cast<LogLevel>(addon::settings->get().general.log_level));
+	addon::start_log_sink();
+
+	addon::upload_journal->initialize();
+	addon::fingerprint_index->initialize();
+	addon::parse_cost_model->initialize();
+	addon::upload_archives->initialize();
+
+	addon::parser->initialize();
+	addon::dps_report_uploader->initialize();
+	addon::wingman_uploader->initialize();
+	addon::artifact_compressor->initialize();
+	addon::retention_manager->initialize();
+}
+
+void unload()
+{
+	addon::settings->release();
+
+	addon::parser->release();
+	addon::artifact_compressor->release();
+	addon::dps_report_uploader->release();
+	addon::wingman_uploader->release();
+	addon::log_manager->release();
+	addon::retention_manager->release();
+
+	addon::upload_archives->release();
+	addon::parse_cost_model->release();
+	addon::fingerprint_index->release();
+	addon::upload_journal->release();
+
+	addon::stop_log_sink();
+}
+
+bool is_finished(const std::shared_ptr<Log>& log, const ReplayOptions& options)
+{
+	static const auto is_upload_finished = [](UploadStatus status) {
+		return status == UploadStatus::UPLOADED || status == UploadStatus::SKIPPED || status == UploadStatus::FAILED || status == UploadStatus::UNAVAILABLE;
+	};
+
+	std::shared_lock lock(log->mutex);
+
+	auto parse_status = log->parser_data.status;
+
+	if (parse_status != ParseStatus::PARSED && parse_status != ParseStatus::FAILED)
+		return false;
+
+	if (!options.dps_report_url.empty() && !is_upload_finished(log->dps_report_upload.status))
+		return false;
+
+	// Wingman only takes parsed logs
+	if (!options.wingman_url.empty() && parse_status == ParseStatus::PARSED && !is_upload_finished(log->wingman_upload.status))
+		return false;
+
+	return true;
+}
+
+std::string format_duration(std::chrono::milliseconds duration) { return std::format("{}m {:02}s", duration.count() / 60000, duration.count() / 1000 % 60); }
+
+double to_mebibytes(uint64_t bytes) { return bytes / 1048576.0; }
+
+// logs per minute between the first log added and the last one reaching the stage
+double get_throughput(const std::vector<std::shared_ptr<Log>>& logs, PipelineStage stage, std::chrono::steady_clock::time_point start_time, size_t& count)
+{
+	std::optional<std::chrono::steady_clock::time_point> last_time;
+	count = 0;
+
+	for (const auto& log : logs)
+	{
+		std::shared_lock lock(log->mutex);
+
+		if (auto time = log->pipeline_times[stage]; time.has_value())
+		{
+			++count;
+			last_time = std::max(last_time.value_or(*time), *time);
+		}
+	}
+
+	if (!last_time.has_value() || *last_time <= start_time)
+		return 0.0;
+
+	return count / std::chrono::duration<double, std::ratio<60>>(*last_time - start_time).count();
+}
+
+bool parse_arguments(int argc, char** argv, ReplayOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view argument = argv[i];
+		auto separator = argument.find('=');
+		auto name = argument.substr(0, separator);
+		auto value = separator == std::string_view::npos ? std::string() : std::string(argument.substr(separator + 1));
+
+		if (name == "--corpus")
+			options.corpus_directory = value;
+		else if (name == "--work")
+			options.work_directory = value;
+		else if (name == "--logs")
+			options.logs = std::stoull(value);
+		else if (name == "--rate")
+			options.logs_per_minute = std::stod(value);
+		else if (name == "--dps-report")
+			options.dps_report_url = value;
+		else if (name == "--wingman")
+			options.wingman_url = value;
+		else if (name == "--stand-in")
+			options.stand_in_options = value;
+		else if (name == "--parse-delay")
+			options.parse_delay_ms = std::stod(value);
+		else if (name == "--parse-ms-per-mb")
+			options.parse_ms_per_mb = std::stod(value);
+		else if (name == "--parse-failure-rate")
+			options.parse_failure_rate = std::stod(value);
+		else if (name == "--timeout")
+			options.timeout = std::chrono::seconds(std::stoll(value));
+		else if (name == "--sample-interval")
+			options.sample_interval = std::chrono::milliseconds(std::stoll(value));
+		else if (name == "--output")
+			options.output_file = value;
+		else if (name == "--verbose")
+			options.verbose = true;
+		else
+		{
+			std::cerr << "Unknown argument: " << argument << "\n\n"
+					  << "Usage: " << argv[0] << " [options]\n"
+					  << "  --corpus=DIR              logs to replay, a manifest.json written by tools/evtc_generator.py corpus (default: the generated replay corpus)\n"
+					  << "  --work=DIR                addon and arcdps directories of the run, replaced on start (default: log-uploader-replay in the temporary directory)\n"
+					  << "  --logs=N                  logs to add, at most as many as the corpus holds (default: all of them)\n"
+					  << "  --rate=LOGS_PER_MINUTE    arrival rate, 0 adds all logs at once (default: 0)\n"
+					  << "  --dps-report=URL          dps.report server, e.g. the upload stand-in, uploads are disabled without one\n"
+					  << "  --wingman=URL             Wingman server, e.g. the upload stand-in, uploads are disabled without one\n"
+					  << "  --stand-in[=OPTIONS]      starts tools/upload_stand_in.py with the space separated options for the servers not given\n"
+					  << "  --parse-delay=MS          time the stub Elite Insights takes per log (default: 500)\n"
+					  << "  --parse-ms-per-mb=MS      additional stub time per uncompressed MiB (default: 100)\n"
+					  << "  --parse-failure-rate=F    fraction of logs the stub fails to parse (default: 0)\n"
+					  << "  --timeout=SECONDS         gives up on logs that have not finished by then (default: 1800)\n"
+					  << "  --sample-interval=MS      queue depth and memory sampling interval (default: 1000)\n"
+					  << "  --output=FILE             writes the samples and the summary as json\n"
+					  << "  --verbose                 prints the debug log of the addon" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	ReplayOptions options;
+
+	try
+	{
+		if (!parse_arguments(argc, argv, options))
+			return 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Invalid argument: " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::vector<CorpusLog> corpus;
+
+	try
+	{
+		corpus = read_corpus(options.corpus_directory);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	auto log_count = options.logs > 0 ? options.logs : corpus.size();
+
+	if (log_count > corpus.size())
+	{
+		std::cerr << "The corpus holds " << corpus.size() << " logs, generate a larger one with evtc_generator.py corpus --count" << std::endl;
+		return 1;
+	}
+
+	std::unique_ptr<StandIn> stand_in;
+
+	if (options.stand_in_options.has_value())
+	{
+		try
+		{
+			stand_in = std::make_unique<StandIn>(*options.stand_in_options);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+
+		if (options.dps_report_url.empty())
+			options.dps_report_url = stand_in->get_url();
+
+		if (options.wingman_url.empty())
+			options.wingman_url = stand_in->get_url();
+	}
+
+	EncounterSelection encounters;
+
+	for (const auto& entry : corpus)
+		if (!is_encounter_selected(encounters, entry.trigger_id))
+			encounters.push_back(entry.trigger_id);
+
+	verbose.store(options.verbose);
+
+	set_environment("STUB_ELITE_INSIGHTS_DELAY_MS", options.parse_delay_ms);
+	set_environment("STUB_ELITE_INSIGHTS_MS_PER_MB", options.parse_ms_per_mb);
+	set_environment("STUB_ELITE_INSIGHTS_FAILURE_RATE", options.parse_failure_rate);
+
+	// only the directories the harness creates are replaced, the work directory may be given by the user
+	addons_directory = options.work_directory / "addons";
+	auto logs_directory = options.work_directory / "arcdps.cbtlogs";
+
+	std::filesystem::remove_all(addons_directory);
+	std::filesystem::remove_all(logs_directory);
+
+	load(options, encounters);
+
+	addon::statistics->reset();
+
+	std::cout << "Replaying " << log_count << " logs of " << options.corpus_directory.string() << (options.logs_per_minute > 0 ? std::format(" at {} logs/min", options.logs_per_minute) : "")
+			  << ", dps.report " << (options.dps_report_url.empty() ? "disabled" : options.dps_report_url) << ", Wingman " << (options.wingman_url.empty() ? "disabled" : options.wingman_url)
+			  << std::endl;
+
+	std::vector<std::shared_ptr<Log>> logs;
+	std::vector<Sample> samples;
+
+	auto start_time = std::chrono::steady_clock::now();
+	auto deadline = start_time + options.timeout;
+	auto next_sample_time = start_time;
+	auto arrival_interval = options.logs_per_minute > 0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::ratio<60>>(1.0 / options.logs_per_minute))
+														: std::chrono::steady_clock::duration::zero();
+
+	size_t added = 0;
+	size_t finished = 0;
+
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		// copied into the arcdps log directory first like arcdps writes them, each copy under its own name so the log ids differ
+		while (added < log_count && now >= start_time + arrival_interval * added)
+		{
+			const auto& entry = corpus[added];
+			auto file_path = logs_directory / std::to_string(static_cast<int>(entry.trigger_id)) / std::format("{:05}-{}", added, entry.file_path.filename().string());
+
+			PipelineTimes pipeline_times;
+			addon::statistics->record_stage(pipeline_times, PipelineStage::DETECTED);
+
+			std::filesystem::create_directories(file_path.parent_path());
+			std::filesystem::copy_file(entry.file_path, file_path, std::filesystem::copy_options::overwrite_existing);
+
+			addon::statistics->record_stage(pipeline_times, PipelineStage::FILE_READY);
+
+			if (auto log = addon::log_manager->add_log(file_path, pipeline_times))
+				logs.push_back(log);
+
+			++added;
+		}
+
+		finished = std::count_if(logs.begin(), logs.end(), [&options](const auto& log) { return is_finished(log, options); });
+
+		if (now >= next_sample_time)
+		{
+			Sample sample;
+			sample.time = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time);
+			sample.memory = Statistics::get_memory_usage();
+			sample.finished_logs = finished;
+
+			for (size_t i = 0; i < sample.queue_depths.size(); ++i)
+				sample.queue_depths[i] = addon::statistics->get_queue_depth(static_cast<PipelineQueue>(i)).get_current();
+
+			if (options.verbose || samples.size() % 10 == 0)
+			{
+				std::cout << std::format("{:>8} {:>5}/{} finished, queues", format_duration(sample.time), finished, log_count);
+
+				for (size_t i = 0; i < sample.queue_depths.size(); ++i)
+					std::cout << std::format(" {} {}", Statistics::queue_names[i], sample.queue_depths[i]);
+
+				std::cout << std::format(", {:.1f} MiB working set", to_mebibytes(sample.memory.working_set)) << std::endl;
+			}
+
+			samples.push_back(sample);
+			next_sample_time += options.sample_interval;
+		}
+
+		if (added == log_count && finished == logs.size())
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+	auto memory = Statistics::get_memory_usage();
+	auto timed_out = added < log_count || finished < logs.size();
+
+	size_t parsed_count = 0, dps_report_count = 0, wingman_count = 0;
+	auto parse_rate = get_throughput(logs, PipelineStage::JSON_EXTRACTED, start_time, parsed_count);
+	auto dps_report_rate = get_throughput(logs, PipelineStage::DPS_REPORT_FINISHED, start_time, dps_report_count);
+	auto wingman_rate = get_throughput(logs, PipelineStage::WINGMAN_FINISHED, start_time, wingman_count);
+
+	std::map<std::string, size_t> outcomes;
+
+	for (const auto& log : logs)
+	{
+		std::shared_lock lock(log->mutex);
+
+		++outcomes[log->parser_data.status == ParseStatus::PARSED ? "parsed" : log->parser_data.status == ParseStatus::FAILED ? "parse failed" : "not parsed"];
+
+		if (!options.dps_report_url.empty())
+			++outcomes[log->dps_report_upload.status == UploadStatus::UPLOADED ? "dps.report uploaded" : log->dps_report_upload.status == UploadStatus::SKIPPED ? "dps.report skipped" : "dps.report not uploaded"];
+
+		if (!options.wingman_url.empty())
+			++outcomes[log->wingman_upload.status == UploadStatus::UPLOADED ? "Wingman uploaded" : log->wingman_upload.status == UploadStatus::SKIPPED ? "Wingman skipped" : "Wingman not uploaded"];
+	}
+
+	nlohmann::json summary = { { "logs", logs.size() }, { "elapsed_ms", elapsed.count() }, { "timed_out", timed_out }, { "warnings", warnings.load() }, { "outcomes", outcomes },
+		{ "logs_per_minute", { { "parsed", parse_rate }, { "dps_report", dps_report_rate }, { "wingman", wingman_rate } } } };
+
+	std::cout << "\n"
+			  << (timed_out ? "Timed out after " : "Finished in ") << format_duration(elapsed) << ", " << finished << " of " << log_count << " logs finished, " << warnings.load() << " warnings logged\n";
+
+	for (const auto& [outcome, count] : outcomes)
+		std::cout << std::format("  {:<24} {}\n", outcome, count);
+
+	std::cout << "\nThroughput, logs/min from the first log added to the last one reaching the stage\n";
+	std::cout << std::format("  {:<24} {:>8.1f} ({} logs)\n", "Parsed", parse_rate, parsed_count);
+
+	if (!options.dps_report_url.empty())
+		std::cout << std::format("  {:<24} {:>8.1f} ({} logs)\n", "dps.report", dps_report_rate, dps_report_count);
+
+	if (!options.wingman_url.empty())
+		std::cout << std::format("  {:<24} {:>8.1f} ({} logs)\n", "Wingman", wingman_rate, wingman_count);
+
+	std::cout << "\nLatency in ms                count      p50      p95      max\n";
+
+	for (size_t i = 0; i < Statistics::interval_definitions.size(); ++i)
+	{
+		const auto& histogram = addon::statistics->get_histogram(static_cast<PipelineInterval>(i));
+
+		if (histogram.get_count() == 0)
+			continue;
+
+		std::cout << std::format("  {:<28} {:>5} {:>8} {:>8} {:>8}\n", Statistics::interval_definitions[i].name, histogram.get_count(), histogram.get_percentile(50), histogram.get_percentile(95), histogram.get_max());
+
+		summary["latency_ms"][Statistics::interval_definitions[i].name] = { { "count", histogram.get_count() }, { "p50", histogram.get_percentile(50) }, { "p95", histogram.get_percentile(95) }, { "max", histogram.get_max() } };
+	}
+
+	std::cout << "\nQueue depth                 mean     peak\n";
+
+	for (size_t i = 0; i < Statistics::queue_names.size(); ++i)
+	{
+		double sum = 0;
+
+		for (const auto& sample : samples)
+			sum += static_cast<double>(sample.queue_depths[i]);
+
+		auto mean = samples.empty() ? 0.0 : sum / samples.size();
+		auto peak = addon::statistics->get_queue_depth(static_cast<PipelineQueue>(i)).get_peak();
+
+		std::cout << std::format("  {:<24} {:>7.1f} {:>8}\n", Statistics::queue_names[i], mean, peak);
+
+		summary["queue_depth"][Statistics::queue_names[i]] = { { "mean", mean }, { "peak", peak } };
+	}
+
+	uint64_t peak_private_bytes = 0;
+
+	for (const auto& sample : samples)
+		peak_private_bytes = std::max(peak_private_bytes, sample.memory.private_bytes);
+
+	std::cout << std::format("\nMemory of the addon: {:.1f} MiB working set, {:.1f} MiB peak, {:.1f} MiB private at most\n", to_mebibytes(memory.working_set), to_mebibytes(memory.peak_working_set),
+		to_mebibytes(peak_private_bytes));
+
+	summary["memory"] = { { "working_set", memory.working_set }, { "peak_working_set", memory.peak_working_set }, { "peak_private_bytes", peak_private_bytes } };
+
+	for (const auto& [trigger_id, totals] : addon::statistics->get_parse_resources())
+	{
+		std::cout << std::format("Elite Insights, {}: {} runs, {:.0f} ms wall and {:.0f} ms cpu on average, {:.1f} MiB peak working set\n", totals.name.empty() ? std::to_string(static_cast<int>(trigger_id)) : totals.name,
+			totals.count, static_cast<double>(totals.wall_time.count()) / totals.count, static_cast<double>(totals.cpu_time.count()) / totals.count, to_mebibytes(totals.max_peak_working_set));
+	}
+
+	// every request the uploaders made, retries and prechecks included
+	if (stand_in)
+	{
+		auto stand_in_statistics = stand_in->get_statistics();
+
+		if (stand_in_statistics.contains("endpoints"))
+		{
+			std::cout << "\nUpload stand-in           requests      p50      p99  statuses\n";
+
+			for (const auto& [endpoint, entry] : stand_in_statistics["endpoints"].items())
+			{
+				if (entry.value("requests", 0) == 0)
+					continue;
+
+				std::string statuses;
+
+				for (const auto& [status, count] : entry["statuses"].items())
+					statuses += std::format(" {} x{}", status, count.get<uint64_t>());
+
+				std::cout << std::format("  {:<24} {:>8} {:>8.0f} {:>8.0f} {}\n", endpoint, entry["requests"].get<uint64_t>(), entry.value("p50_ms", 0.0), entry.value("p99_ms", 0.0), statuses);
+			}
+
+			summary["stand_in"] = stand_in_statistics["endpoints"];
+		}
+	}
+
+	if (!options.output_file.empty())
+	{
+		nlohmann::json output = { { "summary", summary } };
+
+		for (const auto& sample : samples)
+		{
+			nlohmann::json entry = { { "time_ms", sample.time.count() }, { "finished_logs", sample.finished_logs }, { "working_set", sample.memory.working_set }, { "private_bytes", sample.memory.private_bytes } };
+
+			for (size_t i = 0; i < sample.queue_depths.size(); ++i)
+				entry["queue_depths"][Statistics::queue_names[i]] = sample.queue_depths[i];
+
+			output["samples"].push_back(entry);
+		}
+
+		std::ofstream(options.output_file) << output.dump(2);
+		std::cout << "Written to " << options.output_file.string() << std::endl;
+	}
+
+	logs.clear();
+	unload();
+
+	return timed_out ? 2 : 0;
+}
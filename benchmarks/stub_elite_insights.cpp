@@ -0,0 +1,150 @@
+#include "evtc.h"
+#include "evtc_parser.h"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// stands in for GuildWars2EliteInsights-CLI in the replay harness, invoked the same way: -c <settings file> <evtc file>.
+// reads the log with EVTCParser, waits as long as STUB_ELITE_INSIGHTS_DELAY_MS plus STUB_ELITE_INSIGHTS_MS_PER_MB per uncompressed MiB,
+// then writes json and html reports and prints the lines the addon scans the output for.
+// STUB_ELITE_INSIGHTS_FAILURE_RATE fails that fraction of logs, picked by their content hash so a replay fails the same logs every time
+
+namespace
+{
+struct StubSettings
+{
+	std::filesystem::path out_location;
+	bool save_html = false;
+};
+
+StubSettings read_settings(const std::filesystem::path& settings_file)
+{
+	StubSettings settings;
+	std::ifstream file(settings_file);
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		if (line.starts_with("OutLocation="))
+		{
+			// backslashes are escaped in the settings file
+			std::string location;
+
+			for (size_t i = std::string("OutLocation=").size(); i < line.size(); ++i)
+			{
+				if (line[i] == '\\' && i + 1 < line.size() && line[i + 1] == '\\')
+					++i;
+
+				location += line[i];
+			}
+
+			settings.out_location = location;
+		}
+		else if (line.starts_with("SaveOutHTML="))
+			settings.save_html = line.ends_with("true");
+	}
+
+	return settings;
+}
+
+double get_environment(const char* name, double default_value)
+{
+	auto value = std::getenv(name);
+	return value ? std::atof(value) : default_value;
+}
+
+std::string format_time(std::chrono::system_clock::time_point time) { return std::format("{:%F %T} +00:00", std::chrono::floor<std::chrono::seconds>(time)); }
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc != 4 || std::string(argv[1]) != "-c")
+	{
+		std::cerr << "Usage: " << argv[0] << " -c <settings file> <evtc file>" << std::endl;
+		return 1;
+	}
+
+	auto settings = read_settings(argv[2]);
+	std::filesystem::path evtc_file_path = argv[3];
+
+	if (settings.out_location.empty())
+	{
+		std::cout << "Parsing Failure - " << evtc_file_path.filename().string() << ": Settings: OutLocation missing" << std::endl;
+		return 0;
+	}
+
+	EVTCParserData data;
+
+	try
+	{
+		data = addon::evtc_parser->parse(evtc_file_path);
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "Parsing Failure - " << evtc_file_path.filename().string() << ": Parser: " << e.what() << std::endl;
+		return 0;
+	}
+
+	auto name_it = EncounterNames.find(data.trigger_id);
+	auto fight_name = name_it != EncounterNames.end() ? name_it->second : "Unknown Encounter";
+
+	auto delay = get_environment("STUB_ELITE_INSIGHTS_DELAY_MS", 0) + get_environment("STUB_ELITE_INSIGHTS_MS_PER_MB", 0) * data.evtc_size / (1024.0 * 1024.0);
+	std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay));
+
+	auto failure_rate = get_environment("STUB_ELITE_INSIGHTS_FAILURE_RATE", 0);
+
+	if (failure_rate > 0 && static_cast<double>(data.content_hash % 10000) < failure_rate * 10000)
+	{
+		std::cout << "Parsing Failure - " << evtc_file_path.filename().string() << ": " << fight_name << ": Stub failure" << std::endl;
+		return 0;
+	}
+
+	auto start_time = data.log_start_time.value_or(data.evtc_file_time);
+	auto duration = std::chrono::minutes(5);
+
+	nlohmann::json report;
+
+	report["eliteInsightsVersion"] = "1.0.0.0";
+	report["triggerID"] = static_cast<int>(data.trigger_id);
+	report["fightName"] = fight_name;
+	report["recordedAccountBy"] = data.player_accounts.empty() ? "" : data.player_accounts.front();
+	report["timeStartStd"] = format_time(start_time);
+	report["timeEndStd"] = format_time(start_time + duration);
+	report["durationMS"] = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+	report["success"] = true;
+	report["isCM"] = false;
+	report["isLegendaryCM"] = false;
+	report["targets"] = nlohmann::json::array({ { { "id", static_cast<int>(data.trigger_id) }, { "name", fight_name }, { "healthPercentBurned", 100.0 } } });
+
+	for (const auto& account : data.player_accounts)
+		report["players"].push_back({ { "account", account } });
+
+	std::error_code ec;
+	std::filesystem::create_directories(settings.out_location, ec);
+
+	auto stem = evtc_file_path.stem().string() + "_stub_kill";
+	auto json_file_path = settings.out_location / (stem + ".json");
+	auto html_file_path = settings.out_location / (stem + ".html");
+
+	std::ofstream(json_file_path) << report.dump();
+
+	if (settings.save_html)
+		std::ofstream(html_file_path) << "<!DOCTYPE html><html><head><title>" << fight_name << "</title></head><body><script>const logData = " << report.dump() << ";</script></body></html>";
+
+	std::cout << "Parsing Successful - " << evtc_file_path.filename().string() << ": " << fight_name << " - Success\n";
+	std::cout << "Generated: " << json_file_path.string() << "\n";
+
+	if (settings.save_html)
+		std::cout << "Generated: " << html_file_path.string() << "\n";
+
+	std::cout << "Completed for " << evtc_file_path.filename().string() << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "benchmarks.h"
+#include "subprocess.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+int write_subprocess_output(uint64_t bytes)
+{
+	std::string chunk(64 * 1024, 'x');
+
+	while (bytes > 0)
+	{
+		auto size = std::min<uint64_t>(bytes, chunk.size());
+
+		if (std::fwrite(chunk.data(), 1, size, stdout) != size)
+			return 1;
+
+		bytes -= size;
+	}
+
+	return std::fflush(stdout) == 0 ? 0 : 1;
+}
+
+void register_subprocess_benchmarks(const std::filesystem::path& executable_file)
+{
+	// starting, draining and reaping a child the way Elite Insights is run, the benchmarks executable itself is the child
+	benchmark::RegisterBenchmark("Subprocess::wait",
+		[executable_file](benchmark::State& state) {
+			auto bytes = static_cast<uint64_t>(state.range(0));
+
+			for (auto _ : state)
+			{
+				Subprocess process(executable_file, { L"--write-output=" + std::to_wstring(bytes) });
+
+				uint64_t received = 0;
+				auto result = process.wait(std::chrono::steady_clock::now() + std::chrono::minutes(1), [&received](std::string_view output) { received += output.size(); });
+
+				if (result.exit_code != 0 || received != bytes)
+				{
+					state.SkipWithError("child failed or its output was cut short");
+					break;
+				}
+			}
+
+			state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+		})
+		->ArgName("bytes")
+		->Arg(0)
+		->Arg(1 << 20)
+		->Arg(64 << 20)
+		->UseRealTime()
+		->Unit(benchmark::kMillisecond);
+}
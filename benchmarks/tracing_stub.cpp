@@ -0,0 +1,14 @@
+#include "tracing.h"
+
+#include <memory>
+
+// the benchmarks run with tracing disabled, spans are never recorded and the tracer needs none of the addon
+IMPLEMENT_MODULE(Tracer, tracer)
+
+void Tracer::set_thread_name(const char* name) {}
+
+void Tracer::record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {}
+
+void Tracer::clear() {}
+
+std::filesystem::path Tracer::export_to_file() { return {}; }
@@ -0,0 +1,6 @@
+#include "ui.h"
+
+#include <memory>
+
+// the replay harness renders nothing, logs are only added to the table that is never drawn
+IMPLEMENT_MODULE(UI, ui)
@@ -1,6 +1,9 @@
 #include "addon.h"
 
 #include <mutex>
+#include <thread>
+
+#define LOG_BUFFER_SIZE 1024 // power of two
 
 namespace addon
 {
@@ -8,17 +11,172 @@ std::filesystem::path directory;
 AddonAPI_t* api = nullptr;
 Mumble::Data* mumble = nullptr;
 
+std::atomic<LogLevel> log_level = LOGLEVEL_TRACE;
+
 static std::mutex log_mutex;
 
-void log(const std::string& message, LogLevel level)
+// bounded multi producer single consumer ring buffer, a slot is free for the producer at position p when its sequence is p and readable for the consumer when it is p + 1
+struct LogSlot
+{
+	std::atomic<uint64_t> sequence = 0;
+	LogLevel level = LOGLEVEL_INFO;
+	std::string message;
+};
+
+static LogSlot log_buffer[LOG_BUFFER_SIZE];
+static std::atomic<uint64_t> log_write_position = 0;
+static uint64_t log_read_position = 0;
+
+static std::atomic<uint32_t> log_pending = 0;
+static std::atomic<uint64_t> log_dropped = 0;
+static std::atomic<bool> log_sink_running = false;
+
+// producers that saw the sink running and may still write to the buffer, counted before they check it
+static std::atomic<uint32_t> log_producers = 0;
+static std::thread log_sink_thread;
+
+static void write_log(const std::string& message, LogLevel level)
 {
 	std::lock_guard lock(log_mutex);
 	if (api)
 		api->Log(static_cast<ELogLevel>(level), ADDON_LOG_CHANNEL, message.c_str());
 }
 
+static bool enqueue_log(std::string& message, LogLevel level)
+{
+	auto position = log_write_position.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		auto& slot = log_buffer[position & (LOG_BUFFER_SIZE - 1)];
+		auto difference = static_cast<int64_t>(slot.sequence.load(std::memory_order_acquire) - position);
+
+		if (difference == 0)
+		{
+			if (log_write_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				slot.level = level;
+				slot.message = std::move(message);
+				slot.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			// the consumer fell a full buffer behind
+			return false;
+		}
+		else
+		{
+			position = log_write_position.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+// only called by the sink thread, or after it has been joined
+static bool dequeue_log(std::string& message, LogLevel& level)
+{
+	auto& slot = log_buffer[log_read_position & (LOG_BUFFER_SIZE - 1)];
+
+	if (slot.sequence.load(std::memory_order_acquire) != log_read_position + 1)
+		return false;
+
+	level = slot.level;
+	message = std::move(slot.message);
+	slot.sequence.store(log_read_position + LOG_BUFFER_SIZE, std::memory_order_release);
+	++log_read_position;
+
+	return true;
+}
+
+static void flush_log()
+{
+	std::string message;
+	LogLevel level;
+
+	while (dequeue_log(message, level))
+		write_log(message, level);
+
+	if (auto dropped = log_dropped.exchange(0); dropped > 0)
+		write_log(std::to_string(dropped) + " log messages dropped, the log buffer was full", LOGLEVEL_WARNING);
+}
+
+void start_log_sink()
+{
+	if (log_sink_running.load())
+		return;
+
+	// positions continue where the previous run stopped, each slot expects the next position that maps to it
+	for (uint64_t i = 0; i < LOG_BUFFER_SIZE; ++i)
+		log_buffer[(log_read_position + i) & (LOG_BUFFER_SIZE - 1)].sequence.store(log_read_position + i);
+
+	log_write_position.store(log_read_position);
+	log_sink_running.store(true);
+
+	log_sink_thread = std::thread([] {
+		while (log_sink_running.load())
+		{
+			log_pending.wait(0);
+
+			// reset before flushing, messages committed afterwards set it again and wake the next iteration
+			log_pending.store(0);
+			flush_log();
+		}
+	});
+}
+
+void stop_log_sink()
+{
+	// closes the buffer, producers arriving from now on log directly
+	if (!log_sink_running.exchange(false))
+		return;
+
+	// those that got in before it was closed finish their message before the buffer is drained
+	while (log_producers.load() != 0)
+		std::this_thread::yield();
+
+	// wake the sink thread so it notices it has been stopped
+	log_pending.store(1);
+	log_pending.notify_one();
+
+	if (log_sink_thread.joinable())
+		log_sink_thread.join();
+
+	flush_log();
+	log_pending.store(0);
+}
+
+void log(std::string message, LogLevel level)
+{
+	if (level > log_level.load(std::memory_order_relaxed))
+		return;
+
+	// sequentially consistent with closing the buffer, either stop_log_sink sees this producer or this producer sees the buffer closed
+	log_producers.fetch_add(1);
+
+	if (!log_sink_running.load())
+	{
+		log_producers.fetch_sub(1);
+		write_log(message, level);
+		return;
+	}
+
+	if (enqueue_log(message, level))
+	{
+		log_pending.store(1, std::memory_order_release);
+		log_pending.notify_one();
+	}
+	else
+		log_dropped.fetch_add(1, std::memory_order_relaxed);
+
+	log_producers.fetch_sub(1, std::memory_order_release);
+}
+
 void log(const char* message, LogLevel level)
 {
+	if (level > log_level.load(std::memory_order_relaxed))
+		return;
+
 	log(std::string(message), level);
 }
 
@@ -35,10 +193,11 @@ std::filesystem::path get_log_directory()
 
 	if (!std::filesystem::exists(ini_path))
 	{
-		addon::log("arcdps.ini not found at " + ini_path.string() + ", using default log path", LOGLEVEL_DEBUG);
+		addon::log(LOGLEVEL_DEBUG, "arcdps.ini not found at {}, using default log path", ini_path.string());
 		return {};
 	}
 
+#ifdef _WIN32
 	auto ini_wpath = ini_path.wstring();
 	wchar_t buffer[MAX_PATH] = {};
 	GetPrivateProfileStringW(L"session", L"boss_encounter_path", L"", buffer, MAX_PATH, ini_wpath.c_str());
@@ -47,6 +206,10 @@ std::filesystem::path get_log_directory()
 		GetPrivateProfileStringW(L"main", L"boss_encounter_path", L"", buffer, MAX_PATH, ini_wpath.c_str());
 
 	std::wstring boss_path(buffer);
+#else
+	// arcdps only runs on Windows, elsewhere the ini is never read
+	std::wstring boss_path;
+#endif
 
 	if (boss_path.empty())
 	{
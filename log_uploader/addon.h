@@ -3,9 +3,14 @@
 #include <Mumble.h>
 #include <Nexus.h>
 
+#include <atomic>
 #include <filesystem>
+#include <format>
 #include <string>
+
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #define ADDON_VERSION_MAJOR 1
 #define ADDON_VERSION_MINOR 2
@@ -32,7 +37,23 @@ extern std::filesystem::path directory;
 extern AddonAPI_t* api;
 extern Mumble::Data* mumble;
 
-void log(const std::string& message, LogLevel level);
+// messages above this level are dropped before they are formatted or queued
+extern std::atomic<LogLevel> log_level;
+
+// messages are queued without locking and passed to Nexus by a background thread while the sink runs, otherwise they are logged directly
+void start_log_sink();
+void stop_log_sink();
+
+void log(std::string message, LogLevel level);
 void log(const char* message, LogLevel level);
+
+template <typename... Args> void log(LogLevel level, std::format_string<Args...> format, Args&&... args)
+{
+	if (level > log_level.load(std::memory_order_relaxed))
+		return;
+
+	log(std::format(format, std::forward<Args>(args)...), level);
+}
+
 std::filesystem::path get_log_directory();
 } // namespace addon
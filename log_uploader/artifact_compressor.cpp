@@ -0,0 +1,141 @@
+#include "artifact_compressor.h"
+#include "addon.h"
+#include "compression.h"
+#include "retention_manager.h"
+#include "statistics.h"
+#include "wingman_uploader.h"
+
+IMPLEMENT_MODULE(ArtifactCompressor, artifact_compressor)
+
+void ArtifactCompressor::initialize()
+{
+	initialized.store(true);
+
+	compressor_thread = std::thread(&ArtifactCompressor::run, this);
+}
+
+void ArtifactCompressor::release()
+{
+	initialized.store(false);
+
+	{
+		std::lock_guard lock(compressor_queue_mutex);
+		std::queue<std::shared_ptr<Log>> empty;
+		std::swap(compressor_queue, empty);
+		addon::statistics->set_queue_depth(PipelineQueue::ARTIFACT_COMPRESSOR, 0);
+	}
+
+	compressor_cv.notify_all();
+
+	if (compressor_thread.joinable())
+		compressor_thread.join();
+}
+
+void ArtifactCompressor::add_log(std::shared_ptr<Log> log)
+{
+	if (!initialized.load())
+	{
+		addon::wingman_uploader->process_auto_upload(log);
+		return;
+	}
+
+	{
+		std::lock_guard lock(compressor_queue_mutex);
+		compressor_queue.push(log);
+		addon::statistics->set_queue_depth(PipelineQueue::ARTIFACT_COMPRESSOR, compressor_queue.size());
+	}
+
+	compressor_cv.notify_one();
+}
+
+void ArtifactCompressor::run()
+{
+	addon::log("Starting artifact compressor", LOGLEVEL_DEBUG);
+
+	while (true)
+	{
+		std::unique_lock compressor_queue_lock(compressor_queue_mutex);
+
+		compressor_cv.wait(compressor_queue_lock, [this] { return !initialized.load() || !compressor_queue.empty(); });
+
+		if (!initialized.load())
+			break;
+
+		auto log = compressor_queue.front();
+		compressor_queue.pop();
+		addon::statistics->set_queue_depth(PipelineQueue::ARTIFACT_COMPRESSOR, compressor_queue.size());
+
+		compressor_queue_lock.unlock();
+
+		std::shared_lock lock(log->mutex);
+
+		auto id = log->id;
+		auto parser_data = log->parser_data;
+
+		lock.unlock();
+
+		if (parser_data.status == ParseStatus::PARSED)
+		{
+			try
+			{
+				auto compressed_json_file_path = parser_data.json_file_path;
+				compressed_json_file_path += ".gz";
+
+				gzip_file(parser_data.json_file_path, compressed_json_file_path);
+
+				// logs parsed in json mode have no html report until it is generated on demand
+				std::filesystem::path compressed_html_file_path;
+
+				if (!parser_data.html_file_path.empty())
+				{
+					compressed_html_file_path = parser_data.html_file_path;
+					compressed_html_file_path += ".gz";
+
+					gzip_file(parser_data.html_file_path, compressed_html_file_path);
+				}
+
+				auto remove_reports = addon::settings->read([](const SettingsData& s) { return s.parser.compress_reports; });
+
+				{
+					std::unique_lock log_lock(log->mutex);
+					log->parser_data.compressed_json_file_path = compressed_json_file_path;
+					if (!compressed_html_file_path.empty())
+						log->parser_data.compressed_html_file_path = compressed_html_file_path;
+
+					// a manual Wingman upload may already be reading the uncompressed reports, they are then left to the retention manager
+					remove_reports = remove_reports && log->wingman_upload.status != UploadStatus::QUEUED && log->wingman_upload.status != UploadStatus::UPLOADING;
+
+					if (remove_reports)
+					{
+						log->parser_data.json_file_path.clear();
+						log->parser_data.html_file_path.clear();
+					}
+				}
+
+				if (remove_reports)
+				{
+					std::error_code ec;
+					std::filesystem::remove(parser_data.json_file_path, ec);
+					addon::retention_manager->forget(parser_data.json_file_path);
+
+					if (!parser_data.html_file_path.empty())
+					{
+						std::filesystem::remove(parser_data.html_file_path, ec);
+						addon::retention_manager->forget(parser_data.html_file_path);
+					}
+				}
+
+				addon::retention_manager->touch_log(log);
+				addon::log(LOGLEVEL_DEBUG, "Compressed artifacts of {}", id);
+			}
+			catch (const std::exception& e)
+			{
+				addon::log("Failed to compress artifacts of " + id + ". Exception: " + e.what(), LOGLEVEL_WARNING);
+			}
+		}
+
+		addon::wingman_uploader->process_auto_upload(log);
+	}
+
+	addon::log("Stopping artifact compressor", LOGLEVEL_DEBUG);
+}
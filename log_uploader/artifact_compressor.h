@@ -0,0 +1,33 @@
+#pragma once
+
+#include "log.h"
+#include "module.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+// gzips the Elite Insights json and html of parsed logs, Wingman uploads send them compressed and with compressed reports enabled only the gzip copies are kept
+class ArtifactCompressor
+{
+public:
+	void initialize();
+	void release();
+
+	// compresses the artifacts of a parsed log, auto upload to Wingman is processed once done
+	void add_log(std::shared_ptr<Log> log);
+
+private:
+	std::condition_variable compressor_cv;
+	std::mutex compressor_queue_mutex;
+	std::queue<std::shared_ptr<Log>> compressor_queue;
+	std::thread compressor_thread;
+
+	std::atomic<bool> initialized = false;
+
+	void run();
+};
+
+DECLARE_MODULE(ArtifactCompressor, artifact_compressor)
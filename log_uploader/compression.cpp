@@ -0,0 +1,496 @@
+#include "compression.h"
+
+#include <miniz/miniz.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#define CHUNK_SIZE (256 * 1024)
+#define PARALLEL_CHUNK_SIZE (1024 * 1024)
+
+#define LOCAL_HEADER_SIGNATURE 0x04034b50
+#define CENTRAL_HEADER_SIGNATURE 0x02014b50
+
+namespace
+{
+void write_le16(std::ofstream& output, uint16_t value)
+{
+	const char bytes[2] = { static_cast<char>(value & 0xff), static_cast<char>((value >> 8) & 0xff) };
+	output.write(bytes, sizeof(bytes));
+}
+
+void write_le32(std::ofstream& output, uint32_t value)
+{
+	const char bytes[4] = { static_cast<char>(value & 0xff), static_cast<char>((value >> 8) & 0xff), static_cast<char>((value >> 16) & 0xff), static_cast<char>((value >> 24) & 0xff) };
+	output.write(bytes, sizeof(bytes));
+}
+
+// modification time in the ms-dos format of zip headers, local time with two second resolution
+void get_dos_time(uint16_t& dos_time, uint16_t& dos_date)
+{
+	auto time = std::time(nullptr);
+	std::tm tm{};
+
+#ifdef _WIN32
+	localtime_s(&tm, &time);
+#else
+	localtime_r(&time, &tm);
+#endif
+
+	dos_time = static_cast<uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+	dos_date = static_cast<uint16_t>(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+}
+
+// the local and the central header of a deflated entry share their fields, the central one adds those describing the entry within the archive
+void write_zip_header(std::ofstream& output, uint32_t signature, uint16_t dos_time, uint16_t dos_date, uint32_t crc, uint32_t compressed_size, uint32_t size, const std::string& name)
+{
+	write_le32(output, signature);
+
+	if (signature == CENTRAL_HEADER_SIGNATURE)
+		write_le16(output, 20); // made by version 2.0
+
+	write_le16(output, 20); // version 2.0 needed to extract deflate
+	write_le16(output, 0);
+	write_le16(output, MZ_DEFLATED);
+	write_le16(output, dos_time);
+	write_le16(output, dos_date);
+	write_le32(output, crc);
+	write_le32(output, compressed_size);
+	write_le32(output, size);
+	write_le16(output, static_cast<uint16_t>(name.size()));
+	write_le16(output, 0);
+
+	// no comment, starts on the first disk, no attributes and the local header at the start of the archive
+	if (signature == CENTRAL_HEADER_SIGNATURE)
+	{
+		write_le16(output, 0);
+		write_le16(output, 0);
+		write_le16(output, 0);
+		write_le32(output, 0);
+		write_le32(output, 0);
+	}
+
+	output.write(name.data(), name.size());
+}
+
+// raw deflates a chunk, all but the last chunk end on a sync flush so the compressed chunks can be concatenated into one stream
+std::vector<unsigned char> deflate_chunk(const unsigned char* data, size_t size, bool last)
+{
+	mz_stream stream{};
+
+	if (mz_deflateInit2(&stream, MZ_DEFAULT_LEVEL, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK)
+		throw std::runtime_error("Failed to initialize deflate stream");
+
+	std::vector<unsigned char> output(mz_deflateBound(&stream, static_cast<mz_ulong>(size)) + 16);
+
+	stream.next_in = data;
+	stream.avail_in = static_cast<unsigned int>(size);
+	stream.next_out = output.data();
+	stream.avail_out = static_cast<unsigned int>(output.size());
+
+	auto status = mz_deflate(&stream, last ? MZ_FINISH : MZ_SYNC_FLUSH);
+
+	mz_deflateEnd(&stream);
+
+	if (last ? status != MZ_STREAM_END : status != MZ_OK)
+		throw std::runtime_error("Failed to compress chunk");
+
+	output.resize(output.size() - stream.avail_out);
+
+	return output;
+}
+
+// inflates the gzip file at input_path and passes the output to write in chunks, the crc and size of the trailer are verified
+void gunzip(const std::filesystem::path& input_path, const std::function<void(const char*, size_t)>& write)
+{
+	std::ifstream input(input_path, std::ios::binary);
+
+	if (!input.is_open())
+		throw std::runtime_error("Failed to open file: " + input_path.string());
+
+	unsigned char header[10];
+
+	if (!input.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != 0x1f || header[1] != 0x8b || header[2] != 8)
+		throw std::runtime_error("Invalid gzip header: " + input_path.string());
+
+	auto flags = header[3];
+
+	// optional header fields, none of them are written by gzip_file
+	if (flags & 0x04)
+	{
+		unsigned char extra_length[2];
+		input.read(reinterpret_cast<char*>(extra_length), sizeof(extra_length));
+		input.ignore(extra_length[0] | (extra_length[1] << 8));
+	}
+	if (flags & 0x08)
+		input.ignore(std::numeric_limits<std::streamsize>::max(), '\0');
+	if (flags & 0x10)
+		input.ignore(std::numeric_limits<std::streamsize>::max(), '\0');
+	if (flags & 0x02)
+		input.ignore(2);
+
+	if (!input)
+		throw std::runtime_error("Invalid gzip header: " + input_path.string());
+
+	mz_stream stream{};
+
+	if (mz_inflateInit2(&stream, -MZ_DEFAULT_WINDOW_BITS) != MZ_OK)
+		throw std::runtime_error("Failed to initialize inflate stream");
+
+	std::vector<unsigned char> in_buffer(CHUNK_SIZE);
+	std::vector<unsigned char> out_buffer(CHUNK_SIZE);
+
+	mz_ulong crc = MZ_CRC32_INIT;
+	uint32_t size = 0;
+	int status = MZ_OK;
+
+	// more input is only read once the pending output of the previous call was written
+	auto needs_input = true;
+
+	while (status != MZ_STREAM_END)
+	{
+		if (needs_input)
+		{
+			input.read(reinterpret_cast<char*>(in_buffer.data()), in_buffer.size());
+
+			if (input.gcount() == 0)
+			{
+				mz_inflateEnd(&stream);
+				throw std::runtime_error("Truncated gzip file: " + input_path.string());
+			}
+
+			stream.next_in = in_buffer.data();
+			stream.avail_in = static_cast<unsigned int>(input.gcount());
+		}
+
+		stream.next_out = out_buffer.data();
+		stream.avail_out = static_cast<unsigned int>(out_buffer.size());
+
+		status = mz_inflate(&stream, MZ_NO_FLUSH);
+
+		if (status != MZ_OK && status != MZ_STREAM_END && (status != MZ_BUF_ERROR || stream.avail_in != 0))
+		{
+			mz_inflateEnd(&stream);
+			throw std::runtime_error("Failed to decompress file: " + input_path.string());
+		}
+
+		auto bytes_written = out_buffer.size() - stream.avail_out;
+
+		crc = mz_crc32(crc, out_buffer.data(), bytes_written);
+		size += static_cast<uint32_t>(bytes_written);
+
+		write(reinterpret_cast<const char*>(out_buffer.data()), bytes_written);
+
+		needs_input = stream.avail_in == 0 && stream.avail_out != 0;
+	}
+
+	mz_inflateEnd(&stream);
+
+	// the trailer follows the deflate stream, part of it may still be in the input buffer
+	unsigned char trailer[8];
+	auto buffered = std::min<size_t>(stream.avail_in, sizeof(trailer));
+	std::memcpy(trailer, stream.next_in, buffered);
+
+	if (buffered < sizeof(trailer) && !input.read(reinterpret_cast<char*>(trailer + buffered), sizeof(trailer) - buffered))
+		throw std::runtime_error("Truncated gzip file: " + input_path.string());
+
+	auto read_le32 = [](const unsigned char* bytes) { return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) | (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24); };
+
+	if (read_le32(trailer) != static_cast<uint32_t>(crc) || read_le32(trailer + 4) != size)
+		throw std::runtime_error("Corrupt gzip file: " + input_path.string());
+}
+} // namespace
+
+void gzip_file(const std::filesystem::path& input_path, const std::filesystem::path& output_path)
+{
+	std::ifstream input(input_path, std::ios::binary);
+
+	if (!input.is_open())
+		throw std::runtime_error("Failed to open file: " + input_path.string());
+
+	auto temp_path = output_path;
+	temp_path += ".tmp";
+
+	{
+		std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+
+		if (!output.is_open())
+			throw std::runtime_error("Failed to create file: " + temp_path.string());
+
+		// deflate, no flags, no modification time, unknown os
+		static const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+		output.write(header, sizeof(header));
+
+		mz_stream stream{};
+
+		if (mz_deflateInit2(&stream, MZ_DEFAULT_LEVEL, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK)
+			throw std::runtime_error("Failed to initialize deflate stream");
+
+		std::vector<unsigned char> in_buffer(CHUNK_SIZE);
+		std::vector<unsigned char> out_buffer(CHUNK_SIZE);
+
+		mz_ulong crc = MZ_CRC32_INIT;
+		uint32_t size = 0;
+		int flush = MZ_NO_FLUSH;
+
+		do
+		{
+			input.read(reinterpret_cast<char*>(in_buffer.data()), in_buffer.size());
+			auto bytes_read = static_cast<size_t>(input.gcount());
+
+			if (input.bad())
+			{
+				mz_deflateEnd(&stream);
+				throw std::runtime_error("Failed to read file: " + input_path.string());
+			}
+
+			crc = mz_crc32(crc, in_buffer.data(), bytes_read);
+			size += static_cast<uint32_t>(bytes_read);
+
+			flush = input.eof() ? MZ_FINISH : MZ_NO_FLUSH;
+
+			stream.next_in = in_buffer.data();
+			stream.avail_in = static_cast<unsigned int>(bytes_read);
+
+			do
+			{
+				stream.next_out = out_buffer.data();
+				stream.avail_out = static_cast<unsigned int>(out_buffer.size());
+
+				if (mz_deflate(&stream, flush) == MZ_STREAM_ERROR)
+				{
+					mz_deflateEnd(&stream);
+					throw std::runtime_error("Failed to compress file: " + input_path.string());
+				}
+
+				output.write(reinterpret_cast<const char*>(out_buffer.data()), out_buffer.size() - stream.avail_out);
+			} while (stream.avail_out == 0);
+		} while (flush != MZ_FINISH);
+
+		mz_deflateEnd(&stream);
+
+		write_le32(output, static_cast<uint32_t>(crc));
+		write_le32(output, size); // size modulo 2^32 as required by the format
+
+		if (!output)
+			throw std::runtime_error("Failed to write file: " + temp_path.string());
+	}
+
+	std::filesystem::rename(temp_path, output_path);
+}
+
+void gunzip_file(const std::filesystem::path& input_path, const std::filesystem::path& output_path)
+{
+	auto temp_path = output_path;
+	temp_path += ".tmp";
+
+	{
+		std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+
+		if (!output.is_open())
+			throw std::runtime_error("Failed to create file: " + temp_path.string());
+
+		gunzip(input_path, [&output](const char* data, size_t size) { output.write(data, size); });
+
+		if (!output)
+			throw std::runtime_error("Failed to write file: " + temp_path.string());
+	}
+
+	std::filesystem::rename(temp_path, output_path);
+}
+
+std::string gunzip_to_string(const std::filesystem::path& input_path)
+{
+	std::string output;
+	gunzip(input_path, [&output](const char* data, size_t size) { output.append(data, size); });
+	return output;
+}
+
+void zip_file(const std::filesystem::path& input_path, const std::filesystem::path& output_path, const std::string& entry_name)
+{
+	std::error_code ec;
+	auto input_size = std::filesystem::file_size(input_path, ec);
+
+	if (ec)
+		throw std::runtime_error("Failed to open file: " + input_path.string());
+
+	// without zip64 records sizes are limited to 32 bits
+	if (input_size >= std::numeric_limits<uint32_t>::max())
+		throw std::runtime_error("File too large for zip archive: " + input_path.string());
+
+	const auto chunk_count = std::max<size_t>(1, (input_size + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE);
+	const auto worker_count = std::min<size_t>(chunk_count, std::max(1u, std::thread::hardware_concurrency()));
+
+	// workers only read ahead of the writer by this many chunks, memory stays bounded by the window instead of the file size
+	const auto window_size = worker_count * 2;
+
+	struct Chunk
+	{
+		std::vector<unsigned char> data;
+		std::vector<unsigned char> compressed;
+	};
+
+	std::mutex chunks_mutex;
+	std::condition_variable chunks_cv;
+	std::map<size_t, Chunk> finished_chunks;
+	size_t next_chunk = 0;
+	size_t written_chunks = 0;
+	bool stopped = false;
+
+	auto compress_chunks = [&]() {
+		std::ifstream input(input_path, std::ios::binary);
+
+		try
+		{
+			if (!input.is_open())
+				throw std::runtime_error("Failed to open file: " + input_path.string());
+
+			while (true)
+			{
+				std::unique_lock lock(chunks_mutex);
+				chunks_cv.wait(lock, [&]() { return stopped || next_chunk >= chunk_count || next_chunk < written_chunks + window_size; });
+
+				if (stopped || next_chunk >= chunk_count)
+					return;
+
+				auto i = next_chunk++;
+				lock.unlock();
+
+				auto offset = i * PARALLEL_CHUNK_SIZE;
+
+				Chunk chunk;
+				chunk.data.resize(std::min<size_t>(PARALLEL_CHUNK_SIZE, input_size - offset));
+
+				input.seekg(static_cast<std::streamoff>(offset));
+
+				if (!input.read(reinterpret_cast<char*>(chunk.data.data()), chunk.data.size()))
+					throw std::runtime_error("Failed to read file: " + input_path.string());
+
+				chunk.compressed = deflate_chunk(chunk.data.data(), chunk.data.size(), i + 1 == chunk_count);
+
+				lock.lock();
+				finished_chunks.emplace(i, std::move(chunk));
+				chunks_cv.notify_all();
+			}
+		}
+		catch (...)
+		{
+			// the writer stops waiting for chunks once a worker failed
+			std::lock_guard lock(chunks_mutex);
+			stopped = true;
+			chunks_cv.notify_all();
+			throw;
+		}
+	};
+
+	auto temp_path = output_path;
+	temp_path += ".tmp";
+
+	std::vector<std::future<void>> workers;
+
+	auto stop_workers = [&]() {
+		{
+			std::lock_guard lock(chunks_mutex);
+			stopped = true;
+			chunks_cv.notify_all();
+		}
+
+		// those already collected rethrew their exception
+		for (auto& worker : workers)
+			if (worker.valid())
+				worker.wait();
+	};
+
+	mz_ulong crc = MZ_CRC32_INIT;
+	uint64_t compressed_size = 0;
+
+	try
+	{
+		std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+
+		if (!output.is_open())
+			throw std::runtime_error("Failed to create zip archive: " + temp_path.string());
+
+		for (size_t i = 0; i < worker_count; ++i)
+			workers.push_back(std::async(std::launch::async, compress_chunks));
+
+		// the crc and sizes are patched into the local header once all chunks are written
+		uint16_t dos_time, dos_date;
+		get_dos_time(dos_time, dos_date);
+
+		write_zip_header(output, LOCAL_HEADER_SIGNATURE, dos_time, dos_date, 0, 0, 0, entry_name);
+
+		// each chunk is written as soon as it and all chunks before it are compressed
+		for (size_t i = 0; i < chunk_count; ++i)
+		{
+			std::unique_lock lock(chunks_mutex);
+			chunks_cv.wait(lock, [&]() { return stopped || finished_chunks.contains(i); });
+
+			if (!finished_chunks.contains(i))
+				break;
+
+			auto chunk = std::move(finished_chunks.extract(i).mapped());
+			++written_chunks;
+			chunks_cv.notify_all();
+			lock.unlock();
+
+			crc = mz_crc32(crc, chunk.data.data(), chunk.data.size());
+			compressed_size += chunk.compressed.size();
+
+			output.write(reinterpret_cast<const char*>(chunk.compressed.data()), chunk.compressed.size());
+		}
+
+		// rethrows the exception of a failed worker
+		for (auto& worker : workers)
+			worker.get();
+
+		workers.clear();
+
+		if (compressed_size >= std::numeric_limits<uint32_t>::max())
+			throw std::runtime_error("File too large for zip archive: " + input_path.string());
+
+		auto central_directory_offset = static_cast<uint32_t>(output.tellp());
+
+		write_zip_header(output, CENTRAL_HEADER_SIGNATURE, dos_time, dos_date, static_cast<uint32_t>(crc), static_cast<uint32_t>(compressed_size), static_cast<uint32_t>(input_size), entry_name);
+
+		auto central_directory_size = static_cast<uint32_t>(output.tellp()) - central_directory_offset;
+
+		// end of central directory: a single entry on a single disk, no comment
+		write_le32(output, 0x06054b50);
+		write_le16(output, 0);
+		write_le16(output, 0);
+		write_le16(output, 1);
+		write_le16(output, 1);
+		write_le32(output, central_directory_size);
+		write_le32(output, central_directory_offset);
+		write_le16(output, 0);
+
+		output.seekp(14);
+		write_le32(output, static_cast<uint32_t>(crc));
+		write_le32(output, static_cast<uint32_t>(compressed_size));
+		write_le32(output, static_cast<uint32_t>(input_size));
+
+		if (!output.flush())
+			throw std::runtime_error("Failed to write zip archive: " + temp_path.string());
+	}
+	catch (...)
+	{
+		stop_workers();
+
+		std::filesystem::remove(temp_path, ec);
+		throw;
+	}
+
+	std::filesystem::rename(temp_path, output_path);
+}
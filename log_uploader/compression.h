@@ -0,0 +1,15 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+// streams input_path into a gzip file at output_path, the output only appears once it is complete
+void gzip_file(const std::filesystem::path& input_path, const std::filesystem::path& output_path);
+
+// decompresses the gzip file at input_path into output_path, the output only appears once it is complete
+void gunzip_file(const std::filesystem::path& input_path, const std::filesystem::path& output_path);
+
+std::string gunzip_to_string(const std::filesystem::path& input_path);
+
+// stores input_path deflated as the single entry of a zip archive at output_path, chunks are compressed in parallel and written in order as they finish
+void zip_file(const std::filesystem::path& input_path, const std::filesystem::path& output_path, const std::string& entry_name);
@@ -1,5 +1,7 @@
 #include "directory_monitor.h"
 #include "log_manager.h"
+#include "statistics.h"
+#include "tracing.h"
 #include "addon.h"
 
 #include <ShlObj.h>
@@ -56,6 +58,8 @@ void DirectoryMonitor::release()
 
 void DirectoryMonitor::run()
 {
+	TRACE_THREAD("Directory monitor");
+
 	if (monitor_directory.empty() || !std::filesystem::exists(monitor_directory))
 	{
 		addon::log("Directory monitor not started: path does not exist: " + monitor_directory.string(), LOGLEVEL_WARNING);
@@ -82,7 +86,7 @@ void DirectoryMonitor::run()
 		return;
 	}
 
-	addon::log("Started monitoring: " + monitor_directory.string(), LOGLEVEL_DEBUG);
+	addon::log(LOGLEVEL_DEBUG, "Started monitoring: {}", monitor_directory.string());
 
 	while (true)
 	{
@@ -105,6 +109,8 @@ void DirectoryMonitor::run()
 
 			if (GetOverlappedResult(directory_handle, &monitor_overlapped, &bytes_transferred, TRUE))
 			{
+				TRACE_SCOPE("DirectoryMonitor::process_changes");
+
 				ResetEvent(monitor_overlapped.hEvent);
 
 				auto* fni = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(buffer.data());
@@ -120,6 +126,9 @@ void DirectoryMonitor::run()
 						if (extension == ".evtc" || extension == ".zevtc")
 						{
 							{
+								PipelineTimes pipeline_times;
+								addon::statistics->record_stage(pipeline_times, PipelineStage::DETECTED);
+
 								static const auto is_file_openable = [](const std::filesystem::path& log_path) -> bool {
 									std::ifstream file_stream(log_path);
 									return file_stream.is_open();
@@ -137,9 +146,11 @@ void DirectoryMonitor::run()
 
 								if (log_available)
 								{
-									addon::log("New evtc file detected: " + file_path.string(), LOGLEVEL_DEBUG);
+									addon::statistics->record_stage(pipeline_times, PipelineStage::FILE_READY);
+
+									addon::log(LOGLEVEL_DEBUG, "New evtc file detected: {}", file_path.string());
 
-									addon::log_manager->add_log(file_path);
+									addon::log_manager->add_log(file_path, pipeline_times);
 								}
 								else
 									addon::log("Evtc file unavailable: " + file_path.string(), LOGLEVEL_WARNING);
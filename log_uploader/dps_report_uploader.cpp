@@ -1,13 +1,21 @@
 #include "dps_report_uploader.h"
 #include "addon.h"
+#include "encounter_signatures.h"
+#include "fingerprint_index.h"
 #include "settings.h"
+#include "statistics.h"
+#include "tracing.h"
+#include "upload_archives.h"
+#include "upload_journal.h"
 
 #include <cpr/cpr.h>
 
 IMPLEMENT_MODULE(DPSReportUploader, dps_report_uploader)
 
-#define CPR_PARAMETERS cpr::Timeout(std::chrono::seconds(60))
-#define UPLOAD_CONTENT_URL "https://dps.report/uploadContent"
+// uploads throttled by the bandwidth cap take as long as they take, only a transfer that stalls or a response that does not come is given up on
+#define CONNECT_TIMEOUT cpr::ConnectTimeout(std::chrono::seconds(30))
+#define STALL_TIMEOUT cpr::LowSpeed(1, 60)
+#define UPLOAD_CONTENT_PATH "/uploadContent"
 
 void DPSReportUploader::add_log(std::shared_ptr<Log> log)
 {
@@ -23,18 +31,52 @@ void DPSReportUploader::add_log(std::shared_ptr<Log> log)
 	}
 
 	log->dps_report_upload.status = UploadStatus::QUEUED;
+	log->dps_report_upload.attempts = 0;
+	log->dps_report_upload.error_message.reset();
+	log->dps_report_cancellation = std::stop_source();
+	log->dps_report_upload.next_retry_time.reset();
+	addon::statistics->record_stage(log->pipeline_times, PipelineStage::DPS_REPORT_QUEUED);
 	log->update_view();
 
+	addon::upload_journal->record_queued(UploadService::DPS_REPORT, log->evtc_file_path);
+
 	{
 		std::unique_lock upload_queue_lock(upload_queue_mutex);
-		this->upload_queue.push(log);
+		this->upload_queue.push(UploadJob{ log, log->dps_report_cancellation });
+		update_queue_depth();
 		this->upload_cv.notify_one();
 	}
 }
 
+void DPSReportUploader::cancel(std::shared_ptr<Log> log)
+{
+	std::unique_lock lock(log->mutex);
+
+	auto status = log->dps_report_upload.status;
+
+	if (status != UploadStatus::QUEUED && status != UploadStatus::UPLOADING)
+		return;
+
+	log->dps_report_cancellation.request_stop();
+
+	// running uploads are reset by their worker once the transfer was aborted
+	if (status == UploadStatus::UPLOADING)
+		return;
+
+	log->dps_report_upload.status = UploadStatus::AVAILABLE;
+	log->dps_report_upload.next_retry_time.reset();
+	log->dps_report_upload.error_message = "Cancelled";
+	log->update_view();
+
+	lock.unlock();
+
+	addon::upload_journal->record_completed(UploadService::DPS_REPORT, log->evtc_file_path);
+	addon::upload_archives->release_log(log);
+}
+
 void DPSReportUploader::process_auto_upload(std::shared_ptr<Log> log)
 {
-	auto settings = addon::settings->get().dps_report;
+	auto settings = addon::settings->read([](const SettingsData& s) { return s.dps_report; });
 
 	if (!settings.auto_upload)
 		return;
@@ -50,9 +92,7 @@ void DPSReportUploader::process_auto_upload(std::shared_ptr<Log> log)
 	auto log_trigger_id = log->trigger_id;
 	lock.unlock();
 
-	bool is_in_filter = std::find(settings.auto_upload_encounters.begin(), settings.auto_upload_encounters.end(), log_trigger_id) != settings.auto_upload_encounters.end();
-
-	if (is_in_filter)
+	if (is_encounter_selected(settings.auto_upload_encounters, log_trigger_id))
 		this->add_log(log);
 }
 
@@ -60,44 +100,96 @@ void DPSReportUploader::run()
 {
 	addon::log("Starting dps.report uploader", LOGLEVEL_DEBUG);
 
-	while (initialized.load())
+	TRACE_THREAD("dps.report uploader");
+
+	// one session per worker keeps the connection to dps.report alive between uploads
+	cpr::Session session;
+
+	while (true)
 	{
-		std::unique_lock upload_queue_lock(upload_queue_mutex);
-		upload_cv.wait(upload_queue_lock, [&]() { return !upload_queue.empty() || !initialized.load(); });
+		// duplicates are resolved without a request, only an actual upload waits for a token
+		auto job = this->acquire_log(false);
 
-		if (!initialized.load())
+		if (!job)
 			break;
 
-		auto log = upload_queue.front();
-		upload_queue.pop();
-		upload_queue_lock.unlock();
+		TRACE_SCOPE("DPSReportUploader::run");
+
+		const auto& log = job.log;
 
-		std::unique_lock lock(log->mutex);
-		if (log->dps_report_upload.status != UploadStatus::QUEUED)
+		std::unique_lock lock(log->mutex, std::defer_lock);
+		traced_lock(lock, "DPSReportUploader::run wait log");
+
+		// cancelled while queued, cancel already made the log available and completed its journal entry. a log queued again has its own entry
+		if (!job.is_current(log->dps_report_cancellation) || log->dps_report_upload.status != UploadStatus::QUEUED)
 		{
-			addon::log("Log unavailable for dps.report upload: " + log->id, LOGLEVEL_WARNING);
+			lock.unlock();
+			this->release_log();
 			continue;
 		}
 
 		log->dps_report_upload.status = UploadStatus::UPLOADING;
+		log->dps_report_upload.next_retry_time.reset();
+		addon::statistics->record_stage(log->pipeline_times, PipelineStage::DPS_REPORT_STARTED);
 		log->update_view();
 
 		auto id = log->id;
 		auto evtc_file_path = log->evtc_file_path;
+		auto fingerprint = log->get_fingerprint();
+		auto evtc_data = static_cast<EVTCParserData>(*log);
+		auto attempts = log->dps_report_upload.attempts + 1;
+		auto cancel_token = log->dps_report_cancellation.get_token();
 		lock.unlock();
 
 		DpsReportUpload upload;
+		std::optional<std::chrono::milliseconds> retry_delay;
+		auto cancelled = false;
+
 		try
 		{
-			upload = this->upload(evtc_file_path);
-			addon::log("Uploaded " + id + " to dps.report: " + upload.url, LOGLEVEL_INFO);
+			if (auto existing_upload = addon::fingerprint_index->find_dps_report_upload(fingerprint); existing_upload.has_value())
+			{
+				upload = existing_upload.value();
+				addon::log("Resolved " + id + " to existing dps.report upload: " + upload.url, LOGLEVEL_INFO);
+			}
+			else if (auto squad_upload = addon::encounter_signatures->find_dps_report_upload(evtc_data); squad_upload.has_value())
+			{
+				upload = squad_upload.value();
+				addon::log("Resolved " + id + " to dps.report upload of the same encounter by a squad member: " + upload.url, LOGLEVEL_INFO);
+				addon::fingerprint_index->record_dps_report_upload(fingerprint, upload);
+			}
+			else
+			{
+				// released while waiting, the upload stays in the journal
+				if (!this->acquire_token())
+					throw UploadCancelled();
+
+				throw_if_cancelled(cancel_token);
+
+				upload = this->upload(session, addon::upload_archives->get_upload_file_path(evtc_file_path), make_progress_callback(log, [](Log& l) -> Upload& { return l.dps_report_upload; }, cancel_token), cancel_token);
+				this->record_success();
+				addon::log("Uploaded " + id + " to dps.report: " + upload.url, LOGLEVEL_INFO);
+				addon::fingerprint_index->record_dps_report_upload(fingerprint, upload);
+				addon::encounter_signatures->record_dps_report_upload(evtc_data, upload);
+			}
 
-			if (addon::settings->get().dps_report.user_token.empty() && !upload.user_token.empty())
+			if (!upload.user_token.empty())
 			{
-				addon::settings->write([&](auto& s) { s.dps_report.user_token = upload.user_token; });
-				addon::log("dps.report user token acquired: " + upload.user_token, LOGLEVEL_INFO);
+				auto token_acquired = addon::settings->write([&](auto& s) {
+					if (!s.dps_report.user_token.empty())
+						return false;
+					s.dps_report.user_token = upload.user_token;
+					return true;
+				});
+
+				if (token_acquired)
+				{
+					addon::log("dps.report user token acquired: " + upload.user_token, LOGLEVEL_INFO);
+					upload_cv.notify_all();
+				}
 			}
 
+#ifdef _WIN32
 			if (addon::settings->get().dps_report.auto_upload_copy_url_to_clipboard)
 			{
 				if (OpenClipboard(nullptr))
@@ -120,6 +212,31 @@ void DPSReportUploader::run()
 					CloseClipboard();
 				}
 			}
+#endif
+		}
+		catch (const UploadCancelled& e)
+		{
+			upload.status = UploadStatus::AVAILABLE;
+			upload.error_message = e.what();
+			cancelled = true;
+			addon::log("dps.report upload cancelled: " + id, LOGLEVEL_INFO);
+		}
+		catch (const TransientUploadError& e)
+		{
+			upload.error_message = e.what();
+			retry_delay = this->record_transient_failure(attempts, e.retry_after);
+
+			if (retry_delay.has_value())
+			{
+				upload.status = UploadStatus::QUEUED;
+				upload.next_retry_time = std::chrono::system_clock::now() + retry_delay.value();
+				addon::log("dps.report upload attempt " + std::to_string(attempts) + " failed for " + id + ", retrying in " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(retry_delay.value()).count()) + "s. Error: " + e.what(), LOGLEVEL_INFO);
+			}
+			else
+			{
+				upload.status = UploadStatus::FAILED;
+				addon::log("dps.report upload failed for " + id + " after " + std::to_string(attempts) + " attempts. Error: " + e.what(), LOGLEVEL_WARNING);
+			}
 		}
 		catch (const std::exception& e)
 		{
@@ -128,17 +245,46 @@ void DPSReportUploader::run()
 			addon::log("dps.report upload failed for " + id + ". Error: " + e.what(), LOGLEVEL_WARNING);
 		}
 
+		upload.attempts = attempts;
+
 		lock.lock();
 		log->dps_report_upload = upload;
+		if (upload.status == UploadStatus::UPLOADED)
+			addon::statistics->record_stage(log->pipeline_times, PipelineStage::DPS_REPORT_FINISHED);
 		log->update_view();
+		lock.unlock();
+
+		if (retry_delay.has_value())
+		{
+			this->schedule_retry(job, retry_delay.value());
+		}
+		// uploads interrupted by releasing the uploader stay in the journal and resume on the next start
+		else if (!cancelled || cancel_token.stop_requested())
+		{
+			addon::upload_journal->record_completed(UploadService::DPS_REPORT, evtc_file_path);
+			addon::upload_archives->release_log(log);
+		}
+
+		this->release_log();
 	}
 
 	addon::log("Stopping dps.report uploader", LOGLEVEL_DEBUG);
 }
 
-DpsReportUpload DPSReportUploader::upload(std::filesystem::path evtc_file_path)
+size_t DPSReportUploader::get_concurrency_limit() const
+{
+	// evaluated on every wake of acquire_log, reads the two fields instead of copying the settings
+	return addon::settings->read([](const SettingsData& settings) -> size_t {
+		// uploads without a user token would each be assigned a new one, so wait for the first token before going parallel
+		if (settings.dps_report.user_token.empty())
+			return 1;
+
+		return static_cast<size_t>(std::clamp(settings.dps_report.concurrent_uploads, 1, static_cast<int>(max_concurrent_uploads)));
+	});
+}
+
+DpsReportUpload DPSReportUploader::upload(cpr::Session& session, std::filesystem::path evtc_file_path, cpr::ProgressCallback progress_callback, std::stop_token cancel_token)
 {
-	cpr::Url url(UPLOAD_CONTENT_URL);
 	cpr::Parameters parameters{};
 	cpr::Multipart multipart{ { "file", cpr::File(evtc_file_path.string(), evtc_file_path.filename().string()) }, { "json", "1" } };
 
@@ -151,7 +297,23 @@ DpsReportUpload DPSReportUploader::upload(std::filesystem::path evtc_file_path)
 	if (settings.detailed_wvw)
 		parameters.Add({ "detailedwvw", "true" });
 
-	auto response = cpr::Post(url, parameters, multipart, CPR_PARAMETERS);
+	session.SetUrl(cpr::Url(settings.server_url + UPLOAD_CONTENT_PATH));
+	session.SetParameters(parameters);
+	session.SetMultipart(multipart);
+	session.SetOption(CONNECT_TIMEOUT);
+	session.SetOption(STALL_TIMEOUT);
+
+	// the file part is read from disk in chunks while sending, the callback reports how far it got
+	Transfer transfer;
+	session.SetOption(transfer.get_limit_rate());
+	session.SetOption(progress_callback);
+
+	auto response = session.Post();
+
+	// a log cancelled after the server stored it keeps its url, uploading it again later would create a second report
+	if (response.status_code != 200)
+		throw_if_cancelled(cancel_token);
+
 	DpsReportUpload upload;
 
 	if (response.status_code == 200)
@@ -178,6 +340,13 @@ DpsReportUpload DPSReportUploader::upload(std::filesystem::path evtc_file_path)
 			throw std::runtime_error("Failed to parse response: " + std::string(e.what()));
 		}
 	}
+	else if (is_transient_status(response.status_code))
+	{
+		if (response.status_code == 0)
+			throw TransientUploadError("Connection error: " + response.error.message);
+
+		throw TransientUploadError("Server error: " + std::to_string(response.status_code), parse_retry_after(response));
+	}
 	else if (response.status_code >= 400 && response.status_code < 500)
 	{
 		if (!response.text.empty())
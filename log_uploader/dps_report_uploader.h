@@ -2,16 +2,26 @@
 
 #include "uploader.h"
 
+#include <cpr/cpr.h>
+
 class DPSReportUploader : public Uploader
 {
 public:
+	DPSReportUploader() : Uploader(TokenBucket(10, 0.5), PipelineQueue::DPS_REPORT) {}
+
 	void add_log(std::shared_ptr<Log> log) override;
+	void cancel(std::shared_ptr<Log> log) override;
 	void process_auto_upload(std::shared_ptr<Log> log);
 
+	static constexpr size_t max_concurrent_uploads = 4;
+
 private:
 	void run() override;
 
-	DpsReportUpload upload(std::filesystem::path evtc_file_path);
+	size_t get_worker_count() const override { return max_concurrent_uploads; }
+	size_t get_concurrency_limit() const override;
+
+	DpsReportUpload upload(cpr::Session& session, std::filesystem::path evtc_file_path, cpr::ProgressCallback progress_callback, std::stop_token cancel_token);
 };
 
 DECLARE_MODULE(DPSReportUploader, dps_report_uploader)
\ No newline at end of file
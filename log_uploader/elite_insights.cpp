@@ -1,194 +1,314 @@
 #include "elite_insights.h"
 #include "addon.h"
+#include "elite_insights_report.h"
 #include "settings.h"
+#include "subprocess.h"
+#include "tracing.h"
 
 #include <cpr/cpr.h>
 #include <miniz/miniz.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 #define INSTALLATION_DIRECTORY "elite-insights"
 #define OUTPUT_DIRECTORY "log-data"
 #define EXECUTABLE_FILE "GuildWars2EliteInsights-CLI.exe"
-#define SETTINGS_FILE "Settings" / "settings.conf"
+#define SETTINGS_DIRECTORY "Settings"
+#define JSON_SETTINGS_FILE "settings-json.conf"
+#define HTML_SETTINGS_FILE "settings.conf"
 #define VERSION_FILE ".version"
+#define STAGING_SUFFIX ".staging"
+#define DOWNLOAD_ATTEMPTS 3
+#define MAX_EXTRACTION_THREADS 4
 
 #define CPR_PARAMETERS cpr::Timeout(std::chrono::seconds(30))
+// the download may take longer than the api timeout, it is aborted once it stalls instead
+#define DOWNLOAD_CPR_PARAMETERS cpr::ConnectTimeout(std::chrono::seconds(30)), cpr::LowSpeed(1024, 30)
 #define GITHUB_RELEASES_URL std::string("https://api.github.com/repos/baaron4/GW2-Elite-Insights-Parser/releases/")
 #define WINGMAN_VERSION_URL std::string("https://gw2wingman.nevermindcreations.de/api/EIversion")
 
-namespace {
-struct HandleGuard
+namespace
 {
-	HANDLE handle = INVALID_HANDLE_VALUE;
-	HandleGuard() = default;
-	explicit HandleGuard(HANDLE h) : handle(h) {}
-	~HandleGuard() { close(); }
-	HandleGuard(const HandleGuard&) = delete;
-	HandleGuard& operator=(const HandleGuard&) = delete;
-	void close()
+// aborts the transfer once stop is requested, curl calls it about once per second even while no data moves
+cpr::ProgressCallback make_stop_callback(std::stop_token stop_token)
+{
+	return cpr::ProgressCallback([stop_token](cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t, intptr_t) -> bool { return !stop_token.stop_requested(); });
+}
+
+// streams the file to disk, a partial file left by an interrupted download is resumed with a range request
+void download_file(const std::string& url, const std::filesystem::path& file_path, uint64_t expected_size, std::stop_token stop_token)
+{
+	// partial downloads of other versions are of no use anymore
+	for (const auto& entry : std::filesystem::directory_iterator(file_path.parent_path()))
+		if (entry.path() != file_path && entry.path().filename().string().starts_with(INSTALLATION_DIRECTORY "-") && entry.path().extension() == ".part")
+			std::filesystem::remove(entry.path());
+
+	for (auto attempt = 1; attempt <= DOWNLOAD_ATTEMPTS; ++attempt)
 	{
-		if (handle != INVALID_HANDLE_VALUE && handle != nullptr)
+		std::error_code ec;
+		auto offset = std::filesystem::exists(file_path, ec) ? std::filesystem::file_size(file_path) : 0;
+
+		if (expected_size && offset == expected_size)
+			return;
+
+		if (expected_size && offset > expected_size)
 		{
-			CloseHandle(handle);
-			handle = INVALID_HANDLE_VALUE;
+			std::filesystem::remove(file_path);
+			offset = 0;
 		}
-	}
-};
-} // namespace
 
-ParserData EliteInsights::parse(const std::filesystem::path& evtc_file_path)
-{
-	ParserData data;
+		std::ofstream file(file_path, std::ios::binary | std::ios::app);
 
-	data.status = ParseStatus::FAILED;
+		if (!file.is_open())
+			throw std::runtime_error("Failed to create file: " + file_path.string());
 
-	if (!installed.load())
-	{
-		throw std::runtime_error("Elite Insights is not installed.");
-	}
+		// the download redirects to the file host, only the status of the last response applies to the body
+		long status_code = 0;
+		auto body_started = false;
 
-	if (!std::filesystem::exists(evtc_file_path))
-	{
-		throw std::runtime_error("EVTC file does not exist: " + evtc_file_path.string());
-	}
+		auto header_callback = cpr::HeaderCallback([&status_code](std::string_view header, intptr_t) -> bool {
+			if (header.starts_with("HTTP/"))
+			{
+				auto position = header.find(' ');
+				status_code = position == std::string_view::npos ? 0 : std::strtol(std::string(header.substr(position + 1, 3)).c_str(), nullptr, 10);
+			}
+			return true;
+		});
 
-	SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, TRUE };
-	HANDLE r, w;
-	if (!CreatePipe(&r, &w, &sa, 0))
-		throw std::runtime_error("Failed to create read/write pipe");
-	HandleGuard read_pipe(r), write_pipe(w);
+		auto write_callback = cpr::WriteCallback([&](std::string_view data, intptr_t) -> bool {
+			if (!body_started)
+			{
+				body_started = true;
 
-	STARTUPINFOW si = {};
-	PROCESS_INFORMATION pi = {};
-	si.cb = sizeof(si);
-	si.dwFlags |= STARTF_USESTDHANDLES;
-	si.hStdOutput = write_pipe.handle;
-	si.hStdError = write_pipe.handle;
+				// the server ignored the range, the file starts over
+				if (offset > 0 && status_code == 200)
+				{
+					file.close();
+					file.open(file_path, std::ios::binary | std::ios::trunc);
+				}
+			}
 
-	if (!std::filesystem::exists(output_directory))
-		if (!std::filesystem::create_directories(output_directory))
-			throw std::runtime_error("Failed to create Elite Insights output directory: " + output_directory.string());
+			file.write(data.data(), static_cast<std::streamsize>(data.size()));
+			return file.good();
+		});
 
-	auto command = L"\"" + executable_file.wstring() + L"\" -c \"" + settings_file.wstring() + L"\" \"" + evtc_file_path.wstring() + L"\"";
-	std::vector<wchar_t> command_buffer(command.begin(), command.end());
-	command_buffer.push_back(L'\0');
+		cpr::Header headers;
 
-	if (!CreateProcessW(NULL, command_buffer.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi))
-		throw std::runtime_error("Failed to start Elite Insights");
+		if (offset > 0)
+			headers["Range"] = "bytes=" + std::to_string(offset) + "-";
 
-	HandleGuard process_handle(pi.hProcess), thread_handle(pi.hThread);
-	write_pipe.close();
+		auto response = cpr::Get(cpr::Url{ url }, headers, DOWNLOAD_CPR_PARAMETERS, header_callback, write_callback, make_stop_callback(stop_token));
 
-	constexpr int PARSE_TIMEOUT = 180000;
+		file.close();
 
-	if (WaitForSingleObject(process_handle.handle, PARSE_TIMEOUT) == WAIT_TIMEOUT)
-	{
-		TerminateProcess(process_handle.handle, EXIT_FAILURE);
-		throw std::runtime_error("Elite Insights parser timeout. PID: " + std::to_string(pi.dwProcessId));
+		if (stop_token.stop_requested())
+			throw std::runtime_error("Installation cancelled");
+
+		// the partial file already holds everything the server has
+		if (response.status_code == 416 && !expected_size)
+			return;
+
+		if (response.status_code == 200 || response.status_code == 206)
+		{
+			if (response.error.code == cpr::ErrorCode::OK && (!expected_size || std::filesystem::file_size(file_path) == expected_size))
+				return;
+		}
+		else if (response.status_code != 0)
+		{
+			std::filesystem::remove(file_path, ec);
+
+			if (response.status_code != 416)
+				throw std::runtime_error("Invalid HTTP status code: " + std::to_string(response.status_code));
+		}
+
+		addon::log(LOGLEVEL_DEBUG, "Elite Insights download attempt {} interrupted at {} bytes: {}", attempt, std::filesystem::exists(file_path, ec) ? std::filesystem::file_size(file_path) : 0,
+			response.error.message);
 	}
 
-	CHAR buffer[4096];
-	DWORD bytes_read;
-	std::string output;
+	throw std::runtime_error("Download failed after " + std::to_string(DOWNLOAD_ATTEMPTS) + " attempts: " + url);
+}
+
+// writes the files of the archive straight to disk, several threads each read their own handle of the archive
+void extract_archive(const std::filesystem::path& archive_file, const std::filesystem::path& directory, std::stop_token stop_token)
+{
+	std::vector<std::pair<mz_uint, std::filesystem::path>> files;
 
-	while (ReadFile(read_pipe.handle, buffer, sizeof(buffer) - 1, &bytes_read, NULL))
 	{
-		buffer[bytes_read] = '\0';
-		output += buffer;
-	}
+		mz_zip_archive zip_archive{};
+		if (!mz_zip_reader_init_file(&zip_archive, archive_file.string().c_str(), 0))
+			throw std::runtime_error("Failed to initialize zip archive");
 
-	std::smatch matches;
+		for (mz_uint i = 0; i < mz_zip_reader_get_num_files(&zip_archive); ++i)
+		{
+			mz_zip_archive_file_stat file_stat{};
+			if (!mz_zip_reader_file_stat(&zip_archive, i, &file_stat))
+			{
+				mz_zip_reader_end(&zip_archive);
+				throw std::runtime_error("Failed to get file stat from zip archive: " + std::to_string(i));
+			}
 
-	std::regex json_regex(R"(Generated:\s*(.+\.json)\s*)");
+			if (file_stat.m_is_directory)
+				continue;
 
-	if (std::regex_search(output, matches, json_regex) && matches.size() > 1)
-		data.json_file_path = std::filesystem::path(matches[1].str());
+			auto output_path = (directory / file_stat.m_filename).lexically_normal();
 
-	std::regex html_regex(R"(Generated:\s*(.+\.html)\s*)");
+			// entries must stay inside the installation, compared by path component so a sibling directory sharing its name as prefix does not pass
+			auto relative_path = output_path.lexically_relative(directory.lexically_normal());
+			if (relative_path.empty() || *relative_path.begin() == "..")
+			{
+				mz_zip_reader_end(&zip_archive);
+				throw std::runtime_error("Invalid path in zip archive: " + std::string(file_stat.m_filename));
+			}
 
-	if (std::regex_search(output, matches, html_regex) && matches.size() > 1)
-		data.html_file_path = std::filesystem::path(matches[1].str());
+			files.emplace_back(i, output_path);
+		}
 
-	std::regex success_regex(R"(Parsing Successful)");
-	std::regex failure_regex(R"(Parsing Failure)");
+		mz_zip_reader_end(&zip_archive);
+	}
 
-	const auto valid_output = std::regex_search(output, success_regex) && !std::regex_search(output, failure_regex);
+	// directories are created up front, the threads only write files
+	for (const auto& [index, output_path] : files)
+		std::filesystem::create_directories(output_path.parent_path());
 
-	if (valid_output && std::filesystem::exists(data.json_file_path) && std::filesystem::exists(data.html_file_path))
-	{
-		std::ifstream json_file(data.json_file_path);
+	std::atomic<size_t> next_file = 0;
+	std::mutex error_mutex;
+	std::optional<std::string> error_message;
 
-		if (json_file.is_open())
+	auto extract = [&]() {
+		mz_zip_archive zip_archive{};
+		if (!mz_zip_reader_init_file(&zip_archive, archive_file.string().c_str(), 0))
 		{
-			nlohmann::json json = nlohmann::json::parse(json_file);
+			std::lock_guard lock(error_mutex);
+			error_message = "Failed to initialize zip archive";
+			return;
+		}
 
-			auto trigger_id = 0;
+		for (auto i = next_file.fetch_add(1); i < files.size(); i = next_file.fetch_add(1))
+		{
+			{
+				std::lock_guard lock(error_mutex);
+				if (error_message.has_value() || stop_token.stop_requested())
+					break;
+			}
 
-			if (json.contains("triggerID"))
-				trigger_id = json.at("triggerID").get<int>();
+			const auto& [index, output_path] = files[i];
 
-			if (json.contains("fightName"))
-				data.encounter.name = json.at("fightName").get<std::string>();
+			std::ofstream out_file(output_path, std::ios::binary | std::ios::trunc);
 
-			if (json.contains("recordedAccountBy"))
-				data.encounter.account_name = json.at("recordedAccountBy").get<std::string>();
+			static const auto write = [](void* opaque, mz_uint64, const void* buffer, size_t size) -> size_t {
+				auto& stream = *static_cast<std::ofstream*>(opaque);
+				stream.write(static_cast<const char*>(buffer), static_cast<std::streamsize>(size));
+				return stream.good() ? size : 0;
+			};
 
-			if (json.contains("durationMS"))
-				data.encounter.duration_ms = json.at("durationMS").get<int>();
+			if (!out_file || !mz_zip_reader_extract_to_callback(&zip_archive, index, write, &out_file, 0))
+			{
+				std::lock_guard lock(error_mutex);
+				error_message = "Failed to extract file from zip archive: " + output_path.string();
+				break;
+			}
+		}
 
-			if (json.contains("success"))
-				data.encounter.success = json.at("success").get<bool>();
+		mz_zip_reader_end(&zip_archive);
+	};
 
-			bool cm = false;
+	auto thread_count = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MAX_EXTRACTION_THREADS);
 
-			if (json.contains("isCM"))
-				cm = json.at("isCM").get<bool>();
+	std::vector<std::thread> threads;
 
-			bool lcm = false;
+	for (size_t i = 1; i < thread_count; ++i)
+		threads.emplace_back(extract);
 
-			if (json.contains("isLegendaryCM"))
-				lcm = json.at("isLegendaryCM").get<bool>();
+	extract();
 
-			data.encounter.difficulty = lcm ? EncounterDifficulty::LEGENDARY_CHALLENGE_MODE : cm ? EncounterDifficulty::CHALLENGE_MODE : EncounterDifficulty::NORMAL_MODE;
+	for (auto& thread : threads)
+		thread.join();
 
-			static const auto parse_time = [](const std::string& utc_time_str) -> std::chrono::system_clock::time_point {
-				std::istringstream ss(utc_time_str);
-				std::chrono::system_clock::time_point tp;
-				ss >> std::chrono::parse("%F %T %z", tp);
-				return tp;
-			};
+	if (stop_token.stop_requested())
+		throw std::runtime_error("Installation cancelled");
 
-			if (json.contains("timeStartStd"))
-				data.encounter.start_time = parse_time(json.at("timeStartStd").get<std::string>());
+	if (error_message.has_value())
+		throw std::runtime_error(error_message.value());
+}
+} // namespace
 
-			if (json.contains("timeEndStd"))
-				data.encounter.end_time = parse_time(json.at("timeEndStd").get<std::string>());
+ParserData EliteInsights::parse(const std::filesystem::path& evtc_file_path, ParseMode mode, std::chrono::milliseconds timeout, PipelineTimes& pipeline_times,
+	std::optional<ParseResourceUsage>& resource_usage, std::stop_token cancel_token)
+{
+	TRACE_SCOPE("EliteInsights::parse");
 
-			if (trigger_id && json.contains("targets") && !json.at("targets").empty())
-			{
-				for (auto i = 0; i < json.at("targets").size(); i++)
-				{
-					auto& target = json.at("targets").at(i);
+	ParserData data;
 
-					if (target.contains("id"))
-					{
-						auto id = target.at("id").get<int>();
+	data.status = ParseStatus::FAILED;
 
-						if (id == trigger_id)
-						{
-							if (target.contains("healthPercentBurned"))
-								data.encounter.health_percent_burned = target.at("healthPercentBurned").get<float>();
+	// kept for the whole parse, an update activated meanwhile leaves this version in place until it finished
+	auto installation = this->installation.load();
 
-							data.encounter.has_boss = true;
+	if (!installation)
+	{
+		throw std::runtime_error("Elite Insights is not installed.");
+	}
 
-							break;
-						}
-					}
-				}
-			}
+	if (!std::filesystem::exists(evtc_file_path))
+	{
+		throw std::runtime_error("EVTC file does not exist: " + evtc_file_path.string());
+	}
+
+	if (!std::filesystem::exists(output_directory))
+		if (!std::filesystem::create_directories(output_directory))
+			throw std::runtime_error("Failed to create Elite Insights output directory: " + output_directory.string());
+
+	pipeline_times[PipelineStage::ELITE_INSIGHTS_STARTED] = std::chrono::steady_clock::now();
+
+	const auto& settings_file = mode == ParseMode::JSON_AND_HTML ? installation->html_settings_file : installation->json_settings_file;
+
+	Subprocess process(installation->executable_file, { L"-c", settings_file.wstring(), evtc_file_path.wstring() });
+	std::stop_callback cancel_process(cancel_token, [&process]() { process.cancel(); });
+
+	std::string output;
+
+	// the output is drained while Elite Insights runs, waiting for it to exit first could block it on a full pipe
+	auto result = process.wait(std::chrono::steady_clock::now() + timeout, [&output](std::string_view chunk) { output.append(chunk); });
+
+	// runs that time out are the ones worth looking at, the usage is kept before any of the checks below throw
+	resource_usage = ParseResourceUsage{ std::chrono::duration_cast<std::chrono::milliseconds>(result.wall_time), result.user_time, result.kernel_time, result.peak_working_set,
+		result.peak_committed_memory, result.read_bytes, result.write_bytes };
+	data.resource_usage = resource_usage;
+
+	if (result.cancelled)
+		throw std::runtime_error("Parsing cancelled");
+
+	if (result.timed_out)
+		throw std::runtime_error("Elite Insights parser timeout after " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(timeout).count()) + "s. PID: " + std::to_string(process.get_process_id()));
+
+	pipeline_times[PipelineStage::ELITE_INSIGHTS_FINISHED] = std::chrono::steady_clock::now();
+
+	addon::log(LOGLEVEL_DEBUG, "Elite Insights exited with code {} after {} ms. CPU: {} ms user, {} ms kernel. Peak memory: {} MiB working set, {} MiB committed. I/O: {} MiB read, {} MiB written",
+		result.exit_code, resource_usage->wall_time.count(), result.user_time.count(), result.kernel_time.count(), result.peak_working_set / (1024 * 1024),
+		result.peak_committed_memory / (1024 * 1024), result.read_bytes / (1024 * 1024), result.write_bytes / (1024 * 1024));
+
+	auto scanned_output = EliteInsightsOutput::scan(output);
+
+	data.json_file_path = scanned_output.json_file_path;
+	data.html_file_path = scanned_output.html_file_path;
+
+	const auto html_generated = mode == ParseMode::JSON || std::filesystem::exists(data.html_file_path);
+
+	if (scanned_output.is_valid() && std::filesystem::exists(data.json_file_path) && html_generated)
+	{
+		std::ifstream json_file(data.json_file_path);
+
+		if (json_file.is_open())
+		{
+			data.encounter = read_encounter_report(json_file);
 
 			json_file.close();
+			pipeline_times[PipelineStage::JSON_EXTRACTED] = std::chrono::steady_clock::now();
 			data.status = ParseStatus::PARSED;
 			return data;
 		}
@@ -199,7 +319,9 @@ ParserData EliteInsights::parse(const std::filesystem::path& evtc_file_path)
 	}
 	else
 	{
-		std::regex failure_regex_message(R"(Parsing Failure - .*?: .*?: (.+))");
+		static const std::regex failure_regex_message(R"(Parsing Failure - .*?: .*?: (.+))");
+
+		std::smatch matches;
 
 		if (std::regex_search(output, matches, failure_regex_message) && matches.size() > 1)
 			throw std::runtime_error("Parsing failed: " + matches[1].str());
@@ -208,167 +330,216 @@ ParserData EliteInsights::parse(const std::filesystem::path& evtc_file_path)
 	}
 }
 
-void EliteInsights::install()
+EliteInsightsInstallation::~EliteInsightsInstallation()
+{
+	if (retired.load())
+	{
+		std::error_code ec;
+		std::filesystem::remove_all(directory, ec);
+	}
+}
+
+void EliteInsights::load()
 {
 	installation_directory = addon::directory / INSTALLATION_DIRECTORY;
 	output_directory = addon::directory / OUTPUT_DIRECTORY;
 
-	executable_file = installation_directory / EXECUTABLE_FILE;
-	settings_file = installation_directory / SETTINGS_FILE;
-	version_file = installation_directory / VERSION_FILE;
-
 	if (installation_directory.empty() || output_directory.empty())
 		throw std::runtime_error("Installation or output directory is empty");
 
-	if (!std::filesystem::exists(installation_directory))
-		if (!std::filesystem::create_directory(installation_directory))
+	std::filesystem::create_directories(installation_directory);
+
+	// earlier releases installed straight into the installation directory, that version moves into a directory of its own
+	if (auto legacy_version = get_local_version(installation_directory / VERSION_FILE); legacy_version.is_valid())
+	{
+		auto version_directory = installation_directory / legacy_version.get_tag();
+
+		std::vector<std::filesystem::path> entries;
+		for (const auto& entry : std::filesystem::directory_iterator(installation_directory))
+			entries.push_back(entry.path());
+
+		std::filesystem::create_directory(version_directory);
+
+		for (const auto& entry : entries)
+			std::filesystem::rename(entry, version_directory / entry.filename());
+	}
+
+	std::shared_ptr<EliteInsightsInstallation> newest;
+	std::vector<std::filesystem::path> stale_directories;
+
+	for (const auto& entry : std::filesystem::directory_iterator(installation_directory))
+	{
+		if (!entry.is_directory())
+			continue;
+
+		auto candidate = entry.path().filename().string().ends_with(STAGING_SUFFIX) ? nullptr : open_installation(entry.path());
+
+		if (!candidate)
 		{
-			throw std::runtime_error("Failed to create installation directory: " + installation_directory.string());
+			// interrupted updates
+			stale_directories.push_back(entry.path());
+			continue;
 		}
 
-	auto settings = addon::settings->get().parser;
+		if (newest && !(candidate->version > newest->version))
+		{
+			stale_directories.push_back(entry.path());
+			continue;
+		}
+
+		if (newest)
+			stale_directories.push_back(newest->directory);
+
+		newest = candidate;
+	}
+
+	// no parse ran yet, versions retired by the previous session are not in use anymore
+	for (const auto& directory : stale_directories)
+	{
+		std::error_code ec;
+		std::filesystem::remove_all(directory, ec);
+	}
 
-	auto local_version = get_local_version();
-	auto is_installed = [&] { return local_version.is_valid() && std::filesystem::exists(executable_file) && std::filesystem::exists(settings_file); };
+	if (newest)
+	{
+		activate(newest);
+		addon::log(LOGLEVEL_DEBUG, "Loaded Elite Insights {}", newest->version.get_tag());
+	}
+}
+
+bool EliteInsights::update(std::stop_token stop_token)
+{
+	auto settings = addon::settings->get().parser;
 
-	auto installed = is_installed();
+	auto current = installation.load();
 
-	if (!settings.auto_update && installed)
+	if (!settings.auto_update && current)
 	{
 		addon::log("Parser auto update disabled.", LOGLEVEL_DEBUG);
-		this->installed.store(installed);
-		return;
+		return false;
 	}
 
-	auto latest_version = get_latest_version(settings.update_channel);
+	auto latest_version = get_latest_version(settings.update_channel, stop_token);
 
-	if (latest_version.is_valid() && !latest_version.download_url.empty())
+	if (!latest_version.is_valid() || latest_version.download_url.empty())
 	{
-		if (latest_version > local_version || !installed)
-		{
-			if (installed)
-				addon::log("Updating Elite Insights: " + local_version.get_tag() + " -> " + latest_version.get_tag(), LOGLEVEL_DEBUG);
-			else
-				addon::log("Installing Elite Insights " + latest_version.get_tag(), LOGLEVEL_DEBUG);
+		if (!current)
+			throw std::runtime_error("Failed to determine latest Elite Insights version");
 
-			const auto download = cpr::Get(cpr::Url{ latest_version.download_url }, CPR_PARAMETERS);
+		addon::log("Failed to determine latest Elite Insights version", LOGLEVEL_WARNING);
+		return false;
+	}
 
-			if (download.status_code != 200)
-				throw std::runtime_error("Invalid HTTP status code: " + (download.status_code == 0 ? std::string("timeout") : std::to_string(download.status_code)));
+	if (current && !(latest_version > current->version))
+	{
+		addon::log(LOGLEVEL_DEBUG, "Elite Insights is up to date: {}", current->version.get_tag());
+		return false;
+	}
 
-			mz_zip_archive zip_archive{};
-			mz_zip_zero_struct(&zip_archive);
-			if (!mz_zip_reader_init_mem(&zip_archive, reinterpret_cast<const unsigned char*>(download.text.c_str()), download.text.size(), 0))
-				throw std::runtime_error("Failed to initialize zip archive");
+	if (current)
+		addon::log(LOGLEVEL_DEBUG, "Updating Elite Insights: {} -> {}", current->version.get_tag(), latest_version.get_tag());
+	else
+		addon::log(LOGLEVEL_DEBUG, "Installing Elite Insights {}", latest_version.get_tag());
 
-			if (std::filesystem::exists(installation_directory))
-				std::filesystem::remove_all(installation_directory);
+	auto archive_file = addon::directory / (INSTALLATION_DIRECTORY "-" + latest_version.get_tag() + ".zip.part");
 
-			for (auto i = 0; i < static_cast<int>(mz_zip_reader_get_num_files(&zip_archive)); ++i)
-			{
-				mz_zip_archive_file_stat file_stat{};
-				if (!mz_zip_reader_file_stat(&zip_archive, i, &file_stat))
-				{
-					mz_zip_reader_end(&zip_archive);
-					throw std::runtime_error("Failed to get file stat from zip archive: " + std::to_string(i));
-				}
+	download_file(latest_version.download_url, archive_file, latest_version.download_size, stop_token);
 
-				if (file_stat.m_is_directory)
-					continue;
+	// extracted under a name load() discards, the version directory only ever appears complete
+	auto version_directory = installation_directory / latest_version.get_tag();
+	auto staging_directory = installation_directory / (latest_version.get_tag() + STAGING_SUFFIX);
 
-				const auto output_path = installation_directory / file_stat.m_filename;
+	if (std::filesystem::exists(staging_directory))
+		std::filesystem::remove_all(staging_directory);
 
-				if (output_path.has_parent_path())
-					std::filesystem::create_directories(output_path.parent_path());
+	extract_archive(archive_file, staging_directory, stop_token);
 
-				size_t uncompressed_size = 0;
-				auto uncompressed_data = mz_zip_reader_extract_to_heap(&zip_archive, i, &uncompressed_size, 0);
+	std::ofstream version_file_stream(staging_directory / VERSION_FILE, std::ios::out);
 
-				if (!uncompressed_data)
-				{
-					mz_zip_reader_end(&zip_archive);
-					throw std::runtime_error("Failed to extract file from zip archive: " + output_path.string());
-				}
+	if (version_file_stream)
+	{
+		version_file_stream << latest_version.tag_name;
+		version_file_stream.close();
+	}
+	else
+		throw std::runtime_error("Failed to write version file: " + (staging_directory / VERSION_FILE).string());
 
-				std::ofstream out_file(output_path, std::ios::binary);
+	if (std::filesystem::exists(version_directory))
+		std::filesystem::remove_all(version_directory);
 
-				if (out_file)
-				{
-					out_file.write(reinterpret_cast<const char*>(uncompressed_data), uncompressed_size);
-					out_file.close();
-				}
-				else
-				{
-					mz_free(uncompressed_data);
-					mz_zip_reader_end(&zip_archive);
-					throw std::runtime_error("Failed to write file: " + output_path.string());
-				}
-				mz_free(uncompressed_data);
-			}
+	std::filesystem::rename(staging_directory, version_directory);
 
-			mz_zip_reader_end(&zip_archive);
+	std::error_code ec;
+	std::filesystem::remove(archive_file, ec);
 
-			std::ofstream version_file_stream(version_file, std::ios::out);
+	auto new_installation = open_installation(version_directory);
 
-			if (version_file_stream)
-			{
-				version_file_stream << latest_version.tag_name;
-				version_file_stream.close();
-			}
-			else
-				throw std::runtime_error("Failed to write version file: " + version_file.string());
+	if (!new_installation || new_installation->version != latest_version)
+		throw std::runtime_error("Post install validation failed");
 
-			std::ofstream settings_file_stream(settings_file, std::ios::out);
+	activate(new_installation);
 
-			if (settings_file_stream)
-			{
-				std::stringstream custom_settings;
-				custom_settings << R"(# Custom settings
-SaveOutJSON=true
-IndentJSON=false
-SaveOutHTML=true
-SaveOutTrace=false
-SaveAtOut=false
-ParseCombatReplay=true
-SingleThreaded=false
-OutLocation=)" << std::regex_replace(output_directory.string(), std::regex(R"(\\)"), R"(\\)");
-
-				settings_file_stream << custom_settings.str();
-				settings_file_stream.close();
-			}
-			else
-				throw std::runtime_error("Failed to write settings file: " + settings_file.string());
+	addon::log("Installed Elite Insights " + latest_version.get_tag(), LOGLEVEL_INFO);
+	return true;
+}
 
-			local_version = get_local_version();
+std::shared_ptr<EliteInsightsInstallation> EliteInsights::open_installation(const std::filesystem::path& directory)
+{
+	auto version = get_local_version(directory / VERSION_FILE);
 
-			if (is_installed())
-			{
-				addon::log("Installed Elite Insights " + local_version.get_tag(), LOGLEVEL_INFO);
-				this->installed.store(true);
-				return;
-			}
-			else
-				throw std::runtime_error("Post install validation failed");
-		}
-		else
-		{
-			addon::log("Elite Insights is up to date: " + local_version.get_tag(), LOGLEVEL_DEBUG);
-			this->installed.store(true);
-			return;
-		}
-	}
-	else
-	{
-		addon::log("Failed to determine latest Elite Insights version", LOGLEVEL_WARNING);
+	if (!version.is_valid() || !std::filesystem::exists(directory / EXECUTABLE_FILE))
+		return nullptr;
 
-		if (installed)
-			this->installed.store(true);
-		else
-			throw std::runtime_error("Elite Insights is not installed!");
-	}
+	auto result = std::make_shared<EliteInsightsInstallation>();
+
+	result->version = version;
+	result->directory = directory;
+	result->executable_file = directory / EXECUTABLE_FILE;
+	result->json_settings_file = directory / SETTINGS_DIRECTORY / JSON_SETTINGS_FILE;
+	result->html_settings_file = directory / SETTINGS_DIRECTORY / HTML_SETTINGS_FILE;
+
+	return result;
+}
+
+void EliteInsights::activate(std::shared_ptr<EliteInsightsInstallation> new_installation)
+{
+	write_settings_files(*new_installation);
+
+	auto previous = installation.exchange(new_installation);
+
+	if (previous)
+		previous->retired.store(true);
 }
 
-EliteInsightsVersion EliteInsights::get_local_version()
+void EliteInsights::write_settings_files(const EliteInsightsInstallation& target)
+{
+	std::filesystem::create_directories(target.json_settings_file.parent_path());
+
+	const auto out_location = std::regex_replace(output_directory.string(), std::regex(R"(\\)"), R"(\\)");
+
+	auto write_settings_file = [&out_location](const std::filesystem::path& file_path, bool html) {
+		std::ofstream settings_file_stream(file_path, std::ios::out | std::ios::trunc);
+
+		if (!settings_file_stream)
+			throw std::runtime_error("Failed to write settings file: " + file_path.string());
+
+		// the combat replay is only rendered by the html report, Wingman expects it in the json as well
+		settings_file_stream << "# Custom settings\n"
+							 << "SaveOutJSON=true\n"
+							 << "IndentJSON=false\n"
+							 << "SaveOutHTML=" << (html ? "true" : "false") << "\n"
+							 << "SaveOutTrace=false\n"
+							 << "SaveAtOut=false\n"
+							 << "ParseCombatReplay=" << (html ? "true" : "false") << "\n"
+							 << "SingleThreaded=false\n"
+							 << "OutLocation=" << out_location;
+	};
+
+	write_settings_file(target.json_settings_file, false);
+	write_settings_file(target.html_settings_file, true);
+}
+
+EliteInsightsVersion EliteInsights::get_local_version(const std::filesystem::path& version_file)
 {
 	auto version = EliteInsightsVersion();
 
@@ -389,16 +560,16 @@ EliteInsightsVersion EliteInsights::get_local_version()
 	return version;
 }
 
-EliteInsightsVersion EliteInsights::get_latest_version(ParserUpdateChannel update_channel)
+EliteInsightsVersion EliteInsights::get_latest_version(ParserUpdateChannel update_channel, std::stop_token stop_token)
 {
 	EliteInsightsVersion version;
 
-	auto get_github_version = [this](const std::string& url) -> EliteInsightsVersion {
+	auto get_github_version = [this, &stop_token](const std::string& url) -> EliteInsightsVersion {
 		auto version = EliteInsightsVersion();
 
 		try
 		{
-			auto version_response = cpr::Get(cpr::Url{ url }, CPR_PARAMETERS);
+			auto version_response = cpr::Get(cpr::Url{ url }, CPR_PARAMETERS, make_stop_callback(stop_token));
 
 			if (version_response.status_code != 200)
 				throw std::runtime_error("Invalid http status code");
@@ -409,12 +580,16 @@ EliteInsightsVersion EliteInsights::get_latest_version(ParserUpdateChannel updat
 				throw std::runtime_error("Invalid json response");
 
 			std::string download_url;
+			uint64_t download_size = 0;
 
 			for (const auto& asset : json_response["assets"])
 			{
 				if (asset.contains("name") && asset["name"].is_string() && asset["name"] == "GW2EICLI.zip" && asset.contains("browser_download_url") && asset["browser_download_url"].is_string())
 				{
 					download_url = asset["browser_download_url"].get<std::string>();
+
+					if (asset.contains("size") && asset["size"].is_number_unsigned())
+						download_size = asset["size"].get<uint64_t>();
 					break;
 				}
 			}
@@ -422,6 +597,7 @@ EliteInsightsVersion EliteInsights::get_latest_version(ParserUpdateChannel updat
 				throw std::runtime_error("Asset download url not found");
 
 			version = EliteInsightsVersion(json_response["tag_name"].get<std::string>(), download_url);
+			version.download_size = download_size;
 		}
 		catch (const std::exception& e)
 		{
@@ -433,7 +609,7 @@ EliteInsightsVersion EliteInsights::get_latest_version(ParserUpdateChannel updat
 
 	if (update_channel == ParserUpdateChannel::LATEST_WINGMAN)
 	{
-		const auto version_response = cpr::Get(cpr::Url{ WINGMAN_VERSION_URL }, CPR_PARAMETERS);
+		const auto version_response = cpr::Get(cpr::Url{ WINGMAN_VERSION_URL }, CPR_PARAMETERS, make_stop_callback(stop_token));
 
 		if (version_response.status_code != 200)
 		{
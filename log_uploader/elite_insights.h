@@ -3,9 +3,13 @@
 #include "log.h"
 #include "settings.h"
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <memory>
 #include <regex>
 #include <sstream>
+#include <stop_token>
 #include <string>
 #include <thread>
 
@@ -19,6 +23,9 @@ public:
 	std::string download_url;
 	std::string tag_name;
 
+	// size of the release asset in bytes, 0 if unknown
+	uint64_t download_size = 0;
+
 	EliteInsightsVersion() : v1(0), v2(0), v3(0), v4(0), valid(false) {}
 	EliteInsightsVersion(std::string tag_name, const std::string& download_url = "")
 	{
@@ -62,23 +69,63 @@ public:
 	bool operator>=(const EliteInsightsVersion& other) const { return !(*this < other); }
 };
 
+// JSON skips the html report and the combat replay, Wingman needs both
+enum class ParseMode
+{
+	JSON,
+	JSON_AND_HTML
+};
+
+// a complete version of Elite Insights in its own directory, parses hold on to the one they started with
+class EliteInsightsInstallation
+{
+public:
+	EliteInsightsVersion version;
+
+	std::filesystem::path directory;
+	std::filesystem::path executable_file;
+	std::filesystem::path json_settings_file;
+	std::filesystem::path html_settings_file;
+
+	// set once a newer version replaced it, the directory is removed together with the last reference
+	std::atomic<bool> retired = false;
+
+	~EliteInsightsInstallation();
+};
+
 class EliteInsights
 {
 public:
 	EliteInsights() = default;
 
-	ParserData parse(const std::filesystem::path& evtc_file_path);
-	void install();
+	// records the Elite Insights and json extraction stages in pipeline_times, the process is terminated after timeout or once stop is requested on cancel_token.
+	// resource_usage is set once the process exited, also when the parse fails afterwards
+	ParserData parse(const std::filesystem::path& evtc_file_path, ParseMode mode, std::chrono::milliseconds timeout, PipelineTimes& pipeline_times,
+		std::optional<ParseResourceUsage>& resource_usage, std::stop_token cancel_token);
+
+	// activates the newest complete version on disk and removes the others, without any network access
+	void load();
+
+	// installs a newer version next to the active one and switches to it once validated, returns true if it did
+	bool update(std::stop_token stop_token);
+
+	bool is_installed() const { return installation.load() != nullptr; }
 
 private:
 	std::filesystem::path installation_directory;
 	std::filesystem::path output_directory;
-	std::filesystem::path executable_file;
-	std::filesystem::path settings_file;
-	std::filesystem::path version_file;
 
-	std::atomic<bool> installed = false;
+	std::atomic<std::shared_ptr<EliteInsightsInstallation>> installation;
+
+	// nullptr unless the directory holds a valid version file and the executable
+	std::shared_ptr<EliteInsightsInstallation> open_installation(const std::filesystem::path& directory);
+
+	// parses started after this use the new installation, running ones finish on the previous one
+	void activate(std::shared_ptr<EliteInsightsInstallation> new_installation);
+
+	// one settings file per parse mode, rewritten on activation so existing installations pick up changes
+	void write_settings_files(const EliteInsightsInstallation& target);
 
-	EliteInsightsVersion get_local_version();
-	EliteInsightsVersion get_latest_version(ParserUpdateChannel update_channel);
+	static EliteInsightsVersion get_local_version(const std::filesystem::path& version_file);
+	EliteInsightsVersion get_latest_version(ParserUpdateChannel update_channel, std::stop_token stop_token);
 };
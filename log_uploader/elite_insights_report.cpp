@@ -0,0 +1,133 @@
+#include "elite_insights_report.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cctype>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+
+EliteInsightsOutput EliteInsightsOutput::scan(std::string_view output)
+{
+	EliteInsightsOutput result;
+
+	for (std::string_view remaining = output; !remaining.empty();)
+	{
+		auto line_end = remaining.find('\n');
+		auto line = remaining.substr(0, line_end);
+		remaining = line_end == std::string_view::npos ? std::string_view() : remaining.substr(line_end + 1);
+
+		result.parsing_successful = result.parsing_successful || line.find("Parsing Successful") != std::string_view::npos;
+		result.parsing_failure = result.parsing_failure || line.find("Parsing Failure") != std::string_view::npos;
+
+		static constexpr std::string_view generated = "Generated:";
+
+		if (auto position = line.find(generated); position != std::string_view::npos)
+		{
+			auto file = line.substr(position + generated.size());
+
+			while (!file.empty() && std::isspace(static_cast<unsigned char>(file.front())))
+				file.remove_prefix(1);
+			while (!file.empty() && std::isspace(static_cast<unsigned char>(file.back())))
+				file.remove_suffix(1);
+
+			if (file.ends_with(".json") && result.json_file_path.empty())
+				result.json_file_path = std::filesystem::path(std::string(file));
+			else if (file.ends_with(".html") && result.html_file_path.empty())
+				result.html_file_path = std::filesystem::path(std::string(file));
+		}
+	}
+
+	return result;
+}
+
+Encounter read_encounter_report(std::istream& json_report)
+{
+	// the report holds every skill, buff and player of the fight, only the fields read below are kept while parsing
+	static const auto keep_fields = [](int depth, nlohmann::json::parse_event_t event, nlohmann::json& parsed) {
+		static const std::unordered_set<std::string> top_level_fields = { "triggerID", "fightName", "recordedAccountBy", "durationMS", "success", "isCM", "isLegendaryCM", "timeStartStd", "timeEndStd", "targets" };
+		static const std::unordered_set<std::string> target_fields = { "id", "healthPercentBurned" };
+
+		if (event != nlohmann::json::parse_event_t::key)
+			return true;
+
+		// depth 1 are the report fields, depth 3 the fields of the objects in targets, the only kept array of objects
+		if (depth == 1)
+			return top_level_fields.contains(parsed.get_ref<const std::string&>());
+		if (depth == 3)
+			return target_fields.contains(parsed.get_ref<const std::string&>());
+
+		return true;
+	};
+
+	nlohmann::json json = nlohmann::json::parse(json_report, keep_fields);
+
+	Encounter encounter;
+
+	auto trigger_id = 0;
+
+	if (json.contains("triggerID"))
+		trigger_id = json.at("triggerID").get<int>();
+
+	if (json.contains("fightName"))
+		encounter.name = json.at("fightName").get<std::string>();
+
+	if (json.contains("recordedAccountBy"))
+		encounter.account_name = json.at("recordedAccountBy").get<std::string>();
+
+	if (json.contains("durationMS"))
+		encounter.duration_ms = json.at("durationMS").get<int>();
+
+	if (json.contains("success"))
+		encounter.success = json.at("success").get<bool>();
+
+	bool cm = false;
+
+	if (json.contains("isCM"))
+		cm = json.at("isCM").get<bool>();
+
+	bool lcm = false;
+
+	if (json.contains("isLegendaryCM"))
+		lcm = json.at("isLegendaryCM").get<bool>();
+
+	encounter.difficulty = lcm ? EncounterDifficulty::LEGENDARY_CHALLENGE_MODE : cm ? EncounterDifficulty::CHALLENGE_MODE : EncounterDifficulty::NORMAL_MODE;
+
+	static const auto parse_time = [](const std::string& utc_time_str) -> std::chrono::system_clock::time_point {
+		std::istringstream ss(utc_time_str);
+		std::chrono::system_clock::time_point tp;
+		ss >> std::chrono::parse("%F %T %z", tp);
+		return tp;
+	};
+
+	if (json.contains("timeStartStd"))
+		encounter.start_time = parse_time(json.at("timeStartStd").get<std::string>());
+
+	if (json.contains("timeEndStd"))
+		encounter.end_time = parse_time(json.at("timeEndStd").get<std::string>());
+
+	if (trigger_id && json.contains("targets") && !json.at("targets").empty())
+	{
+		for (auto i = 0; i < json.at("targets").size(); i++)
+		{
+			auto& target = json.at("targets").at(i);
+
+			if (target.contains("id"))
+			{
+				auto id = target.at("id").get<int>();
+
+				if (id == trigger_id)
+				{
+					if (target.contains("healthPercentBurned"))
+						encounter.health_percent_burned = target.at("healthPercentBurned").get<float>();
+
+					encounter.has_boss = true;
+
+					break;
+				}
+			}
+		}
+	}
+
+	return encounter;
+}
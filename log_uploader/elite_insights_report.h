@@ -0,0 +1,27 @@
+#pragma once
+
+#include "log.h"
+
+#include <filesystem>
+#include <istream>
+#include <string_view>
+
+// what Elite Insights printed to stdout about a parse
+class EliteInsightsOutput
+{
+public:
+	bool parsing_successful = false;
+	bool parsing_failure = false;
+
+	// the first json and html report listed as generated
+	std::filesystem::path json_file_path;
+	std::filesystem::path html_file_path;
+
+	bool is_valid() const { return parsing_successful && !parsing_failure; }
+
+	// a single pass over the lines instead of one regex search over the whole output per field
+	static EliteInsightsOutput scan(std::string_view output);
+};
+
+// reads the encounter from an Elite Insights json report, only the fields read are kept while the report is parsed
+Encounter read_encounter_report(std::istream& json_report);
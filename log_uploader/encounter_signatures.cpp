@@ -0,0 +1,158 @@
+#include "encounter_signatures.h"
+#include "addon.h"
+#include "settings.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
+#include <format>
+#include <fstream>
+
+IMPLEMENT_MODULE(EncounterSignatures, encounter_signatures)
+
+#define SIGNATURE_FILE_EXTENSION ".signature"
+// the start times of the same fight recorded by different clients differ by a few seconds
+#define START_TIME_TOLERANCE std::chrono::seconds(30)
+#define MAX_SIGNATURE_AGE std::chrono::days(1)
+
+std::optional<DpsReportUpload> EncounterSignatures::find_dps_report_upload(const EVTCParserData& data)
+{
+	auto signature = get_signature(data);
+	auto shared_directory = get_shared_directory();
+
+	if (!signature.has_value() || shared_directory.empty())
+		return std::nullopt;
+
+	std::error_code ec;
+	auto min_write_time = std::filesystem::file_time_type::clock::now() - MAX_SIGNATURE_AGE;
+
+	for (const auto& entry : std::filesystem::directory_iterator(shared_directory, ec))
+	{
+		if (!entry.is_regular_file(ec) || entry.path().extension() != SIGNATURE_FILE_EXTENSION)
+			continue;
+
+		// old signatures cannot match new logs, whoever sees them first removes them
+		if (entry.last_write_time(ec) < min_write_time)
+		{
+			std::filesystem::remove(entry.path(), ec);
+			continue;
+		}
+
+		auto other = parse_file_name(entry.path().stem().string());
+
+		if (!other.has_value() || other->trigger_id != signature->trigger_id || other->squad_hash != signature->squad_hash ||
+			std::abs(other->start_time - signature->start_time) > START_TIME_TOLERANCE.count())
+			continue;
+
+		try
+		{
+			std::ifstream file(entry.path(), std::ios::binary);
+			auto json = nlohmann::json::parse(file);
+
+			DpsReportUpload upload;
+			upload.status = UploadStatus::UPLOADED;
+			upload.url = json.at("url").get<std::string>();
+			upload.id = json.value("id", "");
+
+			if (!upload.url.empty())
+				return upload;
+		}
+		catch (const std::exception& e)
+		{
+			addon::log(LOGLEVEL_DEBUG, "Failed to read encounter signature: {} Exception: {}", entry.path().string(), e.what());
+		}
+	}
+
+	return std::nullopt;
+}
+
+void EncounterSignatures::record_dps_report_upload(const EVTCParserData& data, const DpsReportUpload& upload)
+{
+	auto signature = get_signature(data);
+	auto shared_directory = get_shared_directory();
+
+	if (!signature.has_value() || shared_directory.empty() || upload.url.empty())
+		return;
+
+	auto file_path = shared_directory / std::format("{}_{}_{:016x}" SIGNATURE_FILE_EXTENSION, static_cast<uint16_t>(signature->trigger_id), signature->start_time, signature->squad_hash);
+
+	// written under a temporary name so other clients never read a partial signature
+	auto temp_file_path = file_path;
+	temp_file_path += ".tmp";
+
+	try
+	{
+		{
+			std::ofstream file(temp_file_path, std::ios::binary | std::ios::trunc);
+
+			if (!file.is_open())
+				throw std::runtime_error("Failed to create file: " + temp_file_path.string());
+
+			file << nlohmann::json{ { "url", upload.url }, { "id", upload.id } }.dump();
+		}
+
+		std::filesystem::rename(temp_file_path, file_path);
+	}
+	catch (const std::exception& e)
+	{
+		addon::log("Failed to write encounter signature: " + file_path.string() + " Exception: " + e.what(), LOGLEVEL_WARNING);
+	}
+}
+
+std::optional<EncounterSignatures::Signature> EncounterSignatures::get_signature(const EVTCParserData& data)
+{
+	if (!data.log_start_time.has_value() || data.player_accounts.empty())
+		return std::nullopt;
+
+	Signature signature;
+	signature.trigger_id = data.trigger_id;
+	signature.start_time = std::chrono::duration_cast<std::chrono::seconds>(data.log_start_time->time_since_epoch()).count();
+
+	// 64 bit FNV-1a over the sorted account names
+	signature.squad_hash = 0xcbf29ce484222325ull;
+
+	for (const auto& account : data.player_accounts)
+	{
+		for (auto c : account + '\n')
+		{
+			signature.squad_hash ^= static_cast<uint8_t>(c);
+			signature.squad_hash *= 0x100000001b3ull;
+		}
+	}
+
+	return signature;
+}
+
+std::optional<EncounterSignatures::Signature> EncounterSignatures::parse_file_name(const std::string& file_name)
+{
+	unsigned int trigger_id = 0;
+	long long start_time = 0;
+	unsigned long long squad_hash = 0;
+
+	if (sscanf(file_name.c_str(), "%u_%lld_%llx", &trigger_id, &start_time, &squad_hash) != 3)
+		return std::nullopt;
+
+	Signature signature;
+	signature.trigger_id = static_cast<TriggerID>(trigger_id);
+	signature.start_time = start_time;
+	signature.squad_hash = squad_hash;
+
+	return signature;
+}
+
+std::filesystem::path EncounterSignatures::get_shared_directory()
+{
+	auto shared_directory = addon::settings->get().general.squad_share_directory;
+
+	if (shared_directory.empty())
+		return {};
+
+	auto path = std::filesystem::path(std::u8string(shared_directory.begin(), shared_directory.end()));
+
+	std::error_code ec;
+
+	if (!std::filesystem::is_directory(path, ec))
+		return {};
+
+	return path;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "log.h"
+#include "module.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+// shares dps.report uploads with the squad through a common drop folder, logs of the same fight recorded by another squad member resolve to their upload
+class EncounterSignatures
+{
+public:
+	// returns the dps.report upload of a matching encounter recorded in the shared folder
+	std::optional<DpsReportUpload> find_dps_report_upload(const EVTCParserData& data);
+
+	void record_dps_report_upload(const EVTCParserData& data, const DpsReportUpload& upload);
+
+private:
+	struct Signature
+	{
+		TriggerID trigger_id = TriggerID::Invalid;
+		int64_t start_time = 0;
+		uint64_t squad_hash = 0;
+	};
+
+	static std::optional<Signature> get_signature(const EVTCParserData& data);
+	static std::optional<Signature> parse_file_name(const std::string& file_name);
+
+	static std::filesystem::path get_shared_directory();
+};
+
+DECLARE_MODULE(EncounterSignatures, encounter_signatures)
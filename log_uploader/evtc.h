@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 enum class TriggerID : uint16_t
@@ -270,8 +271,8 @@ inline const std::vector<EncounterCategory> EncounterCategories = {
 };
 // clang-format on
 
-inline const std::map<TriggerID, std::string> EncounterNames = []() {
-	std::map<TriggerID, std::string> result;
+inline const std::unordered_map<TriggerID, std::string> EncounterNames = []() {
+	std::unordered_map<TriggerID, std::string> result;
 	for (const auto& category : EncounterCategories)
 		for (const auto& instance : category.instances)
 			for (const auto& encounter : instance.encounters)
@@ -1,91 +1,285 @@
 #include "evtc_parser.h"
-#include "addon.h"
+#include "tracing.h"
 
 #include <miniz/miniz.h>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <stdexcept>
 
 IMPLEMENT_MODULE(EVTCParser, evtc_parser)
 
-EVTCParserData EVTCParser::parse(const std::filesystem::path& evtc_file_path)
+#define AGENT_SIZE 96
+#define AGENT_IS_ELITE_OFFSET 12
+#define AGENT_NAME_OFFSET 28
+#define AGENT_NAME_SIZE 64
+#define SKILL_SIZE 68
+#define EVENT_SIZE 64
+#define EVENT_VALUE_OFFSET 24
+#define EVENT_STATECHANGE_OFFSET 56
+#define STATECHANGE_LOG_START 9
+
+namespace
 {
-	std::lock_guard lock(this->parser_mutex);
+// reads the uncompressed evtc in chunks and hashes every byte read, large logs are never held in memory as a whole
+class EVTCStream
+{
+public:
+	explicit EVTCStream(const std::filesystem::path& evtc_file_path)
+	{
+		if (evtc_file_path.extension() == ".zevtc")
+		{
+			mz_zip_zero_struct(&zip_archive);
 
-	EVTCParserData data;
+			if (!mz_zip_reader_init_file(&zip_archive, evtc_file_path.string().c_str(), 0))
+				throw std::runtime_error("Failed to open zip archive");
 
-	if (evtc_file_path.empty())
-		throw std::invalid_argument("evtc_file_path is empty");
+			zip_iterator = mz_zip_reader_extract_iter_new(&zip_archive, 0, 0);
 
-	data.evtc_file_path = evtc_file_path;
+			if (!zip_iterator)
+			{
+				mz_zip_reader_end(&zip_archive);
+				throw std::runtime_error("Failed to extract file from zip archive");
+			}
 
-	data.evtc_file_time = std::chrono::clock_cast<std::chrono::system_clock>(std::filesystem::last_write_time(evtc_file_path));
+			size = zip_iterator->file_stat.m_uncomp_size;
+		}
+		else
+		{
+			file_stream.open(evtc_file_path, std::ios::binary);
+
+			if (!file_stream.is_open())
+				throw std::runtime_error("Failed to open file: " + evtc_file_path.string());
 
-	std::vector<uint8_t> file_data;
+			size = std::filesystem::file_size(evtc_file_path);
+		}
+	}
 
-	if (evtc_file_path.extension() == ".zevtc")
+	// uncompressed size of the evtc
+	uint64_t get_size() const { return size; }
+
+	~EVTCStream()
 	{
-		mz_zip_archive zip_archive{};
+		if (zip_iterator)
+			mz_zip_reader_extract_iter_free(zip_iterator);
 
-		mz_zip_zero_struct(&zip_archive);
+		if (zip_archive.m_pState)
+			mz_zip_reader_end(&zip_archive);
+	}
 
-		if (!mz_zip_reader_init_file(&zip_archive, evtc_file_path.string().c_str(), 0))
-			throw std::runtime_error("Failed to open zip archive");
+	EVTCStream(const EVTCStream&) = delete;
+	EVTCStream& operator=(const EVTCStream&) = delete;
 
-		mz_zip_archive_file_stat file_stat;
+	// reads up to size bytes, fewer only at the end of the evtc
+	size_t read(uint8_t* buffer, size_t size)
+	{
+		size_t bytes_read = 0;
 
-		if (!mz_zip_reader_file_stat(&zip_archive, 0, &file_stat))
+		if (zip_iterator)
 		{
-			mz_zip_reader_end(&zip_archive);
-			throw std::runtime_error("Failed to get file stat from zip archive");
+			bytes_read = mz_zip_reader_extract_iter_read(zip_iterator, buffer, size);
+		}
+		else
+		{
+			file_stream.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size));
+			bytes_read = static_cast<size_t>(file_stream.gcount());
 		}
 
-		file_data.resize(file_stat.m_uncomp_size);
-
-		if (!mz_zip_reader_extract_to_mem(&zip_archive, 0, file_data.data(), file_data.size(), 0))
+		// 64 bit FNV-1a
+		for (size_t i = 0; i < bytes_read; ++i)
 		{
-			mz_zip_reader_end(&zip_archive);
-			throw std::runtime_error("Failed to extract file from zip archive");
+			hash ^= buffer[i];
+			hash *= 0x100000001b3ull;
 		}
 
-		mz_zip_reader_end(&zip_archive);
+		return bytes_read;
 	}
-	else
-	{
-		std::ifstream file_stream(evtc_file_path, std::ios::binary | std::ios::ate);
 
-		if (!file_stream.is_open())
-			throw std::runtime_error("Failed to open file: " + evtc_file_path.string());
+	bool read_exact(void* buffer, size_t size) { return read(reinterpret_cast<uint8_t*>(buffer), size) == size; }
 
-		std::streamsize size = file_stream.tellg();
-		file_data.resize(size);
+	// reads the rest of the evtc so the hash covers all of it, returns the hash
+	uint64_t finish()
+	{
+		std::vector<uint8_t> buffer(1 << 20);
 
-		file_stream.seekg(0, std::ios::beg);
+		while (read(buffer.data(), buffer.size()) == buffer.size())
+		{
+		}
 
-		if (!file_stream.read(reinterpret_cast<char*>(file_data.data()), size))
+		if (zip_iterator)
 		{
-			file_stream.close();
-			throw std::runtime_error("Failed to read file: " + evtc_file_path.string());
+			auto extracted = mz_zip_reader_extract_iter_free(zip_iterator);
+			zip_iterator = nullptr;
+
+			// the crc of the entry is only checked once it was read to the end
+			if (!extracted)
+				throw std::runtime_error("Failed to extract file from zip archive");
 		}
+		else if (file_stream.bad())
+		{
+			throw std::runtime_error("Failed to read file");
+		}
+
+		return hash;
 	}
 
-	if (file_data.size() < 16)
-		throw std::runtime_error("Invalid evtc file size");
+private:
+	std::ifstream file_stream;
+	mz_zip_archive zip_archive{};
+	mz_zip_reader_extract_iter_state* zip_iterator = nullptr;
 
-	uint64_t index = 0;
+	uint64_t size = 0;
+	uint64_t hash = 0xcbf29ce484222325ull;
+};
+} // namespace
+
+EVTCParserData EVTCParser::parse(const std::filesystem::path& evtc_file_path)
+{
+	TRACE_SCOPE("EVTCParser::parse");
+
+	std::unique_lock lock(this->parser_mutex, std::defer_lock);
+	traced_lock(lock, "EVTCParser::parse wait");
 
-	const auto evtc_identifier = std::string(reinterpret_cast<const char*>(file_data.data()), 4);
+	EVTCParserData data;
+
+	if (evtc_file_path.empty())
+		throw std::invalid_argument("evtc_file_path is empty");
+
+	data.evtc_file_path = evtc_file_path;
+
+	data.evtc_file_time = std::chrono::clock_cast<std::chrono::system_clock>(std::filesystem::last_write_time(evtc_file_path));
+
+	EVTCStream stream(evtc_file_path);
+
+	data.evtc_size = stream.get_size();
+
+	uint8_t header[16];
+
+	if (!stream.read_exact(header, sizeof(header)))
+		throw std::runtime_error("Invalid evtc file size");
+
+	const auto evtc_identifier = std::string(reinterpret_cast<const char*>(header), 4);
 
 	if (evtc_identifier != "EVTC")
 		throw std::runtime_error("Invalid evtc file header");
 
+	uint64_t index = 0;
+
 	index += 4; // evtc identifier
 	index += 4; // version
 	index += 1; // revision
 	index += 4; // unknown/reserved
 
-	std::memcpy(&data.trigger_id, file_data.data() + index, sizeof(TriggerID));
-	index += sizeof(TriggerID);
+	const auto revision = header[12]; // follows the 12 byte identifier and build date
+
+	std::memcpy(&data.trigger_id, header + index, sizeof(TriggerID));
+
+	// the event layout below is only known for revision 1
+	if (revision != 1)
+	{
+		data.content_hash = stream.finish();
+		return data;
+	}
+
+	uint32_t agent_count = 0;
+
+	if (!stream.read_exact(&agent_count, sizeof(agent_count)))
+	{
+		data.content_hash = stream.finish();
+		return data;
+	}
+
+	std::vector<std::string> player_accounts;
+	uint8_t agent[AGENT_SIZE];
+	auto agents_complete = true;
+
+	for (uint32_t i = 0; i < agent_count; ++i)
+	{
+		if (!stream.read_exact(agent, sizeof(agent)))
+		{
+			agents_complete = false;
+			break;
+		}
+
+		uint32_t is_elite = 0;
+		std::memcpy(&is_elite, agent + AGENT_IS_ELITE_OFFSET, sizeof(is_elite));
+
+		// gadgets and npcs have is_elite set to 0xffffffff
+		if (is_elite == 0xffffffff)
+			continue;
+
+		// player names are stored as "character\0:account\0subgroup\0"
+		const auto name = reinterpret_cast<const char*>(agent + AGENT_NAME_OFFSET);
+		const auto character_length = strnlen(name, AGENT_NAME_SIZE);
+
+		if (character_length + 1 >= AGENT_NAME_SIZE)
+			continue;
+
+		std::string account(name + character_length + 1, strnlen(name + character_length + 1, AGENT_NAME_SIZE - character_length - 1));
+
+		if (account.starts_with(':'))
+			account.erase(0, 1);
+
+		if (!account.empty())
+			player_accounts.push_back(account);
+	}
+
+	if (!agents_complete)
+	{
+		data.content_hash = stream.finish();
+		return data;
+	}
+
+	std::sort(player_accounts.begin(), player_accounts.end());
+	data.player_accounts = std::move(player_accounts);
+
+	uint32_t skill_count = 0;
+
+	if (!stream.read_exact(&skill_count, sizeof(skill_count)))
+	{
+		data.content_hash = stream.finish();
+		return data;
+	}
+
+	// events are read in blocks, the LogStart event is usually among the first few
+	std::vector<uint8_t> events(1024 * EVENT_SIZE);
+
+	for (uint64_t skipped = 0, skill_bytes = static_cast<uint64_t>(skill_count) * SKILL_SIZE; skipped < skill_bytes;)
+	{
+		auto size = static_cast<size_t>(std::min<uint64_t>(skill_bytes - skipped, events.size()));
+
+		if (!stream.read_exact(events.data(), size))
+		{
+			data.content_hash = stream.finish();
+			return data;
+		}
+
+		skipped += size;
+	}
+
+	while (!data.log_start_time.has_value())
+	{
+		auto bytes_read = stream.read(events.data(), events.size());
+
+		for (size_t offset = 0; offset + EVENT_SIZE <= bytes_read; offset += EVENT_SIZE)
+		{
+			if (events[offset + EVENT_STATECHANGE_OFFSET] != STATECHANGE_LOG_START)
+				continue;
+
+			// value holds the server unix timestamp, unlike the local one it is the same for every account recording the fight
+			int32_t server_time = 0;
+			std::memcpy(&server_time, events.data() + offset + EVENT_VALUE_OFFSET, sizeof(server_time));
+
+			data.log_start_time = std::chrono::system_clock::time_point(std::chrono::seconds(static_cast<uint32_t>(server_time)));
+			break;
+		}
+
+		if (bytes_read < events.size())
+			break;
+	}
+
+	data.content_hash = stream.finish();
 
 	return data;
 }
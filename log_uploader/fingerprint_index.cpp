@@ -0,0 +1,206 @@
+#include "fingerprint_index.h"
+#include "addon.h"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+
+IMPLEMENT_MODULE(FingerprintIndex, fingerprint_index)
+
+#define INDEX_FILE "fingerprints.json"
+#define MAX_ENTRY_AGE std::chrono::days(90)
+#define SAVE_INTERVAL std::chrono::seconds(5)
+
+namespace
+{
+int64_t get_current_time() { return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count(); }
+} // namespace
+
+void FingerprintIndex::initialize()
+{
+	file_path = addon::directory / INDEX_FILE;
+
+	{
+		std::lock_guard lock(entries_mutex);
+
+		try
+		{
+			load();
+		}
+		catch (const std::exception& e)
+		{
+			addon::log("Failed to load fingerprint index: " + file_path.string() + " Exception: " + e.what(), LOGLEVEL_WARNING);
+			entries.clear();
+		}
+	}
+
+	initialized.store(true);
+
+	save_thread = std::thread(&FingerprintIndex::run, this);
+}
+
+void FingerprintIndex::release()
+{
+	initialized.store(false);
+
+	save_cv.notify_all();
+
+	if (save_thread.joinable())
+		save_thread.join();
+
+	save();
+
+	std::lock_guard lock(entries_mutex);
+	entries.clear();
+	dirty = false;
+}
+
+std::optional<DpsReportUpload> FingerprintIndex::find_dps_report_upload(const std::string& fingerprint)
+{
+	if (fingerprint.empty())
+		return std::nullopt;
+
+	std::lock_guard lock(entries_mutex);
+
+	auto it = entries.find(fingerprint);
+
+	if (it == entries.end() || it->second.dps_report_url.empty())
+		return std::nullopt;
+
+	DpsReportUpload upload;
+	upload.status = UploadStatus::UPLOADED;
+	upload.url = it->second.dps_report_url;
+	upload.id = it->second.dps_report_id;
+
+	return upload;
+}
+
+bool FingerprintIndex::contains_wingman_upload(const std::string& fingerprint)
+{
+	if (fingerprint.empty())
+		return false;
+
+	std::lock_guard lock(entries_mutex);
+
+	auto it = entries.find(fingerprint);
+
+	return it != entries.end() && it->second.wingman;
+}
+
+void FingerprintIndex::record_dps_report_upload(const std::string& fingerprint, const DpsReportUpload& upload)
+{
+	if (fingerprint.empty() || upload.url.empty())
+		return;
+
+	std::lock_guard lock(entries_mutex);
+
+	auto& entry = entries[fingerprint];
+	entry.dps_report_url = upload.url;
+	entry.dps_report_id = upload.id;
+	entry.time = get_current_time();
+
+	dirty = true;
+}
+
+void FingerprintIndex::record_wingman_upload(const std::string& fingerprint)
+{
+	if (fingerprint.empty())
+		return;
+
+	std::lock_guard lock(entries_mutex);
+
+	auto& entry = entries[fingerprint];
+
+	if (entry.wingman)
+		return;
+
+	entry.wingman = true;
+	entry.time = get_current_time();
+
+	dirty = true;
+}
+
+void FingerprintIndex::load()
+{
+	entries.clear();
+
+	if (!std::filesystem::exists(file_path))
+		return;
+
+	std::ifstream file(file_path, std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open fingerprint index file");
+
+	auto json = nlohmann::json::parse(file);
+
+	auto min_time = get_current_time() - std::chrono::duration_cast<std::chrono::seconds>(MAX_ENTRY_AGE).count();
+
+	for (const auto& [fingerprint, value] : json.items())
+	{
+		Entry entry;
+		entry.dps_report_url = value.value("dps_report_url", "");
+		entry.dps_report_id = value.value("dps_report_id", "");
+		entry.wingman = value.value("wingman", false);
+		entry.time = value.value("time", int64_t(0));
+
+		if (entry.time >= min_time)
+			entries.emplace(fingerprint, entry);
+	}
+}
+
+// only called by the save thread and by release once it has stopped, the file is written outside the lock
+void FingerprintIndex::save()
+{
+	nlohmann::json json = nlohmann::json::object();
+
+	{
+		std::lock_guard lock(entries_mutex);
+
+		if (!dirty)
+			return;
+
+		for (const auto& [fingerprint, entry] : entries)
+			json[fingerprint] = { { "dps_report_url", entry.dps_report_url }, { "dps_report_id", entry.dps_report_id }, { "wingman", entry.wingman }, { "time", entry.time } };
+
+		dirty = false;
+	}
+
+	auto temp_file_path = file_path;
+	temp_file_path += ".tmp";
+
+	try
+	{
+		{
+			std::ofstream file(temp_file_path, std::ios::binary | std::ios::trunc);
+
+			if (!file.is_open())
+				throw std::runtime_error("Failed to create file: " + temp_file_path.string());
+
+			file << json.dump();
+		}
+
+		std::filesystem::rename(temp_file_path, file_path);
+	}
+	catch (const std::exception& e)
+	{
+		addon::log("Failed to save fingerprint index: " + file_path.string() + " Exception: " + e.what(), LOGLEVEL_WARNING);
+
+		// retried with the next interval
+		std::lock_guard lock(entries_mutex);
+		dirty = true;
+	}
+}
+
+void FingerprintIndex::run()
+{
+	while (initialized.load())
+	{
+		{
+			std::unique_lock lock(entries_mutex);
+			save_cv.wait_for(lock, SAVE_INTERVAL, [&]() { return !initialized.load(); });
+		}
+
+		save();
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "log.h"
+#include "module.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// remembers which service already holds a log by its content fingerprint so duplicates are resolved without uploading them again
+class FingerprintIndex
+{
+public:
+	void initialize();
+	void release();
+
+	// returns the existing dps.report upload for the fingerprint
+	std::optional<DpsReportUpload> find_dps_report_upload(const std::string& fingerprint);
+	bool contains_wingman_upload(const std::string& fingerprint);
+
+	void record_dps_report_upload(const std::string& fingerprint, const DpsReportUpload& upload);
+	void record_wingman_upload(const std::string& fingerprint);
+
+private:
+	struct Entry
+	{
+		std::string dps_report_url;
+		std::string dps_report_id;
+		bool wingman = false;
+		int64_t time = 0;
+	};
+
+	std::filesystem::path file_path;
+
+	std::mutex entries_mutex;
+	std::unordered_map<std::string, Entry> entries;
+
+	// changes are saved with a single write per interval
+	std::condition_variable save_cv;
+	bool dirty = false;
+
+	std::thread save_thread;
+	std::atomic<bool> initialized = false;
+
+	void load();
+	void save();
+	void run();
+};
+
+DECLARE_MODULE(FingerprintIndex, fingerprint_index)
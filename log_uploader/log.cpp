@@ -1,13 +1,36 @@
 #include "log.h"
+#include "addon.h"
+#include "compression.h"
 #include "ui.h"
 
+#ifdef _WIN32
 #include <ShlObj.h>
+#endif
+
+#include <format>
+
+namespace
+{
+// hands a file or url to the program registered for it
+void shell_open(const std::filesystem::path& target)
+{
+#ifdef _WIN32
+	ShellExecuteW(nullptr, L"open", target.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
+#else
+	addon::log(LOGLEVEL_DEBUG, "Not opening {}, only supported on Windows", target.string());
+#endif
+}
+} // namespace
 
 Log::Log(EVTCParserData data)
 {
 	trigger_id = data.trigger_id;
 	evtc_file_path = data.evtc_file_path;
 	evtc_file_time = data.evtc_file_time;
+	evtc_size = data.evtc_size;
+	content_hash = data.content_hash;
+	log_start_time = data.log_start_time;
+	player_accounts = data.player_accounts;
 
 	static const auto extract_log_identifier = [](const std::filesystem::path& p) -> std::string {
 		std::vector<std::filesystem::path> parts(p.begin(), p.end());
@@ -28,4 +51,50 @@ Log::Log(EVTCParserData data)
 
 Log::~Log() {}
 
-void DpsReportUpload::open() { ShellExecuteA(nullptr, "open", url.c_str(), nullptr, nullptr, SW_SHOWNORMAL); }
+std::string EVTCParserData::get_fingerprint() const
+{
+	if (content_hash == 0)
+		return {};
+
+	auto start_time = log_start_time.has_value() ? std::chrono::duration_cast<std::chrono::seconds>(log_start_time->time_since_epoch()).count() : 0;
+
+	return std::format("{:016x}-{}-{}", content_hash, static_cast<uint16_t>(trigger_id), start_time);
+}
+
+void ParserData::open_report() const
+{
+	auto report_file_path = html_file_path;
+
+	if (report_file_path.empty() && !compressed_html_file_path.empty())
+	{
+		// named like the report, the decompressed copy is reused when the report is opened again
+		report_file_path = get_report_directory() / compressed_html_file_path.stem();
+
+		try
+		{
+			if (!std::filesystem::exists(report_file_path))
+			{
+				std::filesystem::create_directories(report_file_path.parent_path());
+				gunzip_file(compressed_html_file_path, report_file_path);
+			}
+			else
+			{
+				// copies are removed by their age, a reused one starts over
+				std::error_code ec;
+				std::filesystem::last_write_time(report_file_path, std::filesystem::file_time_type::clock::now(), ec);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			addon::log("Failed to decompress report: " + compressed_html_file_path.string() + " Exception: " + e.what(), LOGLEVEL_WARNING);
+			return;
+		}
+	}
+
+	if (!report_file_path.empty())
+		shell_open(report_file_path);
+}
+
+std::filesystem::path ParserData::get_report_directory() { return std::filesystem::temp_directory_path() / "log-uploader-reports"; }
+
+void DpsReportUpload::open() { shell_open(std::filesystem::path(url)); }
@@ -2,10 +2,15 @@
 
 #include "evtc.h"
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <optional>
 #include <shared_mutex>
+#include <stop_token>
+#include <string>
+#include <vector>
 
 enum class ParseStatus
 {
@@ -32,6 +37,12 @@ class Upload
 {
 public:
 	std::optional<std::string> error_message;
+
+	int attempts = 0;
+	std::optional<std::chrono::system_clock::time_point> next_retry_time;
+
+	uint64_t bytes_sent = 0;
+	uint64_t bytes_total = 0;
 };
 
 enum class UploadStatus
@@ -85,7 +96,38 @@ public:
 	std::filesystem::path evtc_file_path;
 	std::chrono::system_clock::time_point evtc_file_time;
 
+	// uncompressed size in bytes, what the Elite Insights parse time scales with
+	uint64_t evtc_size = 0;
+
+	// hash of the uncompressed evtc and the server time of its LogStart event, identify the log regardless of its file path
+	uint64_t content_hash = 0;
+	std::optional<std::chrono::system_clock::time_point> log_start_time;
+
+	// sorted account names of the players in the log
+	std::vector<std::string> player_accounts;
+
 	bool is_valid() const { return trigger_id != TriggerID::Invalid && !evtc_file_path.empty(); }
+
+	// empty if the content hash is unknown
+	std::string get_fingerprint() const;
+};
+
+// resources used by an Elite Insights run, cpu time, committed memory and i/o include the processes it started
+class ParseResourceUsage
+{
+public:
+	std::chrono::milliseconds wall_time{};
+	std::chrono::milliseconds user_time{};
+	std::chrono::milliseconds kernel_time{};
+	uint64_t peak_working_set = 0;
+	uint64_t peak_committed_memory = 0;
+	uint64_t read_bytes = 0;
+	uint64_t write_bytes = 0;
+
+	std::chrono::milliseconds get_cpu_time() const { return user_time + kernel_time; }
+
+	// average number of cores kept busy while it ran
+	double get_cores() const { return wall_time.count() > 0 ? static_cast<double>(get_cpu_time().count()) / wall_time.count() : 0.0; }
 };
 
 class ParserData
@@ -94,15 +136,61 @@ public:
 	std::filesystem::path html_file_path;
 	std::filesystem::path json_file_path;
 
+	// gzip compressed reports, sent to Wingman as they are. once they are kept at rest the uncompressed reports are removed and their paths cleared
+	std::filesystem::path compressed_html_file_path;
+	std::filesystem::path compressed_json_file_path;
+
 	std::optional<std::string> error_message;
 
 	Encounter encounter = Encounter();
 
+	// set while Elite Insights runs again for the html report of a log parsed without one
+	bool report_queued = false;
+
+	// of the last Elite Insights run for the log, whether it succeeded or not
+	std::optional<ParseResourceUsage> resource_usage;
+
 	bool is_success() const { return status == ParseStatus::PARSED && encounter.success; }
 
+	bool has_report() const { return !html_file_path.empty() || !compressed_html_file_path.empty(); }
+
+	// opens the html report in the browser, a compressed report is decompressed into a temporary file first. blocks meanwhile, the ui goes through Parser::open_report
+	void open_report() const;
+
+	// temporary directory of the decompressed reports opened in the browser, the parser removes copies once they are old
+	static std::filesystem::path get_report_directory();
+
 	ParseStatus status = ParseStatus::UNPARSED;
 };
 
+enum class PipelineStage
+{
+	DETECTED,
+	FILE_READY,
+	HEADER_PARSED,
+	PARSE_QUEUED,
+	ELITE_INSIGHTS_STARTED,
+	ELITE_INSIGHTS_FINISHED,
+	JSON_EXTRACTED,
+	DPS_REPORT_QUEUED,
+	DPS_REPORT_STARTED,
+	DPS_REPORT_FINISHED,
+	WINGMAN_QUEUED,
+	WINGMAN_STARTED,
+	WINGMAN_FINISHED,
+	COUNT
+};
+
+// time each pipeline stage of a log was reached, stages before the log was added are unset for logs that were not detected by the directory monitor
+class PipelineTimes
+{
+public:
+	std::array<std::optional<std::chrono::steady_clock::time_point>, static_cast<size_t>(PipelineStage::COUNT)> times;
+
+	std::optional<std::chrono::steady_clock::time_point>& operator[](PipelineStage stage) { return times[static_cast<size_t>(stage)]; }
+	const std::optional<std::chrono::steady_clock::time_point>& operator[](PipelineStage stage) const { return times[static_cast<size_t>(stage)]; }
+};
+
 using EncounterLogID = std::string;
 
 class LogData : public EVTCParserData
@@ -113,6 +201,8 @@ public:
 	ParserData parser_data = ParserData();
 	DpsReportUpload dps_report_upload = DpsReportUpload();
 	WingmanUpload wingman_upload = WingmanUpload();
+
+	PipelineTimes pipeline_times = PipelineTimes();
 };
 
 class Log : public LogData
@@ -130,4 +220,9 @@ public:
 	std::atomic<bool> view_updated_required = true;
 
 	mutable std::shared_mutex mutex;
+
+	// cancel the current parse and uploads of the log, replaced whenever the job is queued, guarded by mutex
+	std::stop_source parse_cancellation;
+	std::stop_source dps_report_cancellation;
+	std::stop_source wingman_cancellation;
 };
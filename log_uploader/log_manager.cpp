@@ -2,6 +2,8 @@
 #include "dps_report_uploader.h"
 #include "evtc_parser.h"
 #include "parser.h"
+#include "retention_manager.h"
+#include "statistics.h"
 #include "addon.h"
 #include "ui.h"
 #include "wingman_uploader.h"
@@ -10,7 +12,7 @@
 
 IMPLEMENT_MODULE(LogManager, log_manager)
 
-LogManager::~LogManager()
+void LogManager::release()
 {
 	try
 	{
@@ -22,24 +24,29 @@ LogManager::~LogManager()
 
 			if (log->parser_data.status == ParseStatus::PARSED)
 			{
-				std::error_code ec;
+				for (const auto& file_path : { log->parser_data.html_file_path, log->parser_data.json_file_path, log->parser_data.compressed_html_file_path, log->parser_data.compressed_json_file_path })
+				{
+					if (file_path.empty())
+						continue;
 
-				if (std::filesystem::exists(log->parser_data.html_file_path, ec))
-					std::filesystem::remove(log->parser_data.html_file_path, ec);
-
-				if (std::filesystem::exists(log->parser_data.json_file_path, ec))
-					std::filesystem::remove(log->parser_data.json_file_path, ec);
+					std::error_code ec;
+					std::filesystem::remove(file_path, ec);
+					addon::retention_manager->forget(file_path);
+				}
 			}
 		}
 
 		logs.clear();
+
+		std::error_code ec;
+		std::filesystem::remove_all(ParserData::get_report_directory(), ec);
 	}
 	catch (...)
 	{
 	}
 }
 
-void LogManager::add_log(std::filesystem::path evtc_file_path)
+std::shared_ptr<Log> LogManager::add_log(std::filesystem::path evtc_file_path, PipelineTimes pipeline_times)
 {
 	try
 	{
@@ -47,7 +54,10 @@ void LogManager::add_log(std::filesystem::path evtc_file_path)
 
 		if (data.is_valid())
 		{
+			addon::statistics->record_stage(pipeline_times, PipelineStage::HEADER_PARSED);
+
 			auto log = std::make_shared<Log>(data);
+			log->pipeline_times = pipeline_times;
 
 			{
 				std::unique_lock lock(logs_mutex);
@@ -62,6 +72,8 @@ void LogManager::add_log(std::filesystem::path evtc_file_path)
 			addon::ui->logs_table.add_log(log);
 
 			addon::log("Log added: " + log->id, LOGLEVEL_INFO);
+
+			return log;
 		}
 		else
 			throw std::runtime_error("Invalid evtc data");
@@ -70,4 +82,6 @@ void LogManager::add_log(std::filesystem::path evtc_file_path)
 	{
 		addon::log("Failed to add log: Evtc parsing failed. File: \"" + evtc_file_path.string() + "\" Exception: " + e.what(), LOGLEVEL_WARNING);
 	}
+
+	return nullptr;
 }
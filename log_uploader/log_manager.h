@@ -10,9 +10,11 @@ class LogManager
 {
 public:
 	LogManager() {}
-	~LogManager();
 
-	void add_log(std::filesystem::path evtc_file_path);
+	// removes the reports of the parsed logs and the temporary copies opened in the browser, called on unload once nothing reads them anymore
+	void release();
+
+	std::shared_ptr<Log> add_log(std::filesystem::path evtc_file_path, PipelineTimes pipeline_times = PipelineTimes());
 
 	std::deque<std::shared_ptr<Log>> logs;
 	std::shared_mutex logs_mutex;
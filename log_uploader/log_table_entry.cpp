@@ -0,0 +1,94 @@
+#include "log_table_entry.h"
+
+#include <chrono>
+#include <format>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+// current_zone queries the tz database on every call, the zone is resolved once per session
+static const std::chrono::time_zone* get_time_zone()
+{
+	static const auto time_zone = std::chrono::current_zone();
+	return time_zone;
+}
+
+void LogTableEntry::update_view()
+{
+	if (data.parser_data.status == ParseStatus::PARSED)
+	{
+		auto& encounter = data.parser_data.encounter;
+
+		auto time = std::chrono::clock_cast<std::chrono::system_clock>(encounter.end_time);
+		std::chrono::zoned_time local_time = { get_time_zone(), time };
+
+		view.time = std::format("{:%H:%M}", local_time);
+		view.name = encounter.name;
+		view.result = encounter.success ? "Success" : encounter.has_boss ? std::format("{:.2f}%", 100.f - encounter.health_percent_burned)
+		                                                                 : "Failure";
+
+		auto minutes = encounter.duration_ms / (60 * 1000);
+		auto seconds = (encounter.duration_ms / 1000) % 60;
+		auto milliseconds = encounter.duration_ms % 1000;
+
+		view.duration = minutes > 0 ? std::format("{}m {}s {}ms", minutes, seconds, milliseconds) : std::format("{}s {}ms", seconds, milliseconds);
+	}
+	else
+	{
+		auto time = std::chrono::clock_cast<std::chrono::system_clock>(data.evtc_file_time);
+		std::chrono::zoned_time local_time = { get_time_zone(), time };
+
+		view.time = std::format("{:%H:%M}", local_time);
+
+		auto it = EncounterNames.find(data.trigger_id);
+
+		if (it != EncounterNames.end())
+			view.name = it->second;
+		else
+			view.name = "Undefined";
+	}
+}
+
+void LogTableEntry::refresh_time_ago()
+{
+	auto get_time_ago = [](const std::chrono::system_clock::time_point& timepoint) {
+		auto sys_time = std::chrono::clock_cast<std::chrono::system_clock>(timepoint);
+		auto sys_time_trunc = std::chrono::floor<std::chrono::seconds>(sys_time);
+
+		std::chrono::zoned_time local_time{ get_time_zone(), sys_time_trunc };
+
+		std::string formatted_time = std::format("{:%d %B %Y, %H:%M:%S}", local_time);
+
+		std::ostringstream timestamp_stream;
+
+		timestamp_stream << formatted_time;
+
+		auto now = std::chrono::system_clock::now();
+
+		auto diff = now - timepoint;
+
+		std::vector<std::pair<int64_t, std::string>> components = { { std::chrono::duration_cast<std::chrono::years>(diff).count(), "y" }, { std::chrono::duration_cast<std::chrono::months>(diff % std::chrono::years(1)).count(), "M" },
+			{ std::chrono::duration_cast<std::chrono::days>(diff % std::chrono::months(1)).count(), "d" }, { std::chrono::duration_cast<std::chrono::hours>(diff % std::chrono::days(1)).count(), "h" }, { std::chrono::duration_cast<std::chrono::minutes>(diff % std::chrono::hours(1)).count(), "m" },
+			{ std::chrono::duration_cast<std::chrono::seconds>(diff % std::chrono::minutes(1)).count(), "s" } };
+
+		std::ostringstream ago_stream;
+		bool first = true;
+		for (const auto& [value, unit] : components)
+		{
+			if (value > 0)
+			{
+				ago_stream << value << unit + " ";
+				first = false;
+			}
+		}
+
+		if (first)
+			ago_stream << "now";
+		else
+			ago_stream << "ago";
+
+		return timestamp_stream.str() + " (" + ago_stream.str() + ")";
+	};
+
+	view.time_ago = get_time_ago(data.parser_data.status != ParseStatus::PARSED ? data.evtc_file_time : data.parser_data.encounter.end_time);
+}
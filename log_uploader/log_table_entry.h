@@ -0,0 +1,45 @@
+#pragma once
+
+#include "log.h"
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+
+struct LogView
+{
+	bool selected = false;
+
+	std::string name;
+	std::string time;
+	std::string result;
+	std::string duration;
+	std::string time_ago;
+};
+
+class LogTableEntry
+{
+public:
+	std::shared_ptr<Log> ptr;
+	LogData data;
+	LogView view;
+
+	LogTableEntry(std::shared_ptr<Log> ptr) { this->ptr = ptr; }
+
+	void update()
+	{
+		auto view_update_required = false;
+
+		{
+			std::shared_lock lock(ptr->mutex);
+			if (view_update_required = ptr->view_updated_required.exchange(false))
+				this->data = ptr->get_data();
+		}
+
+		if (view_update_required)
+			update_view();
+	}
+
+	void update_view();
+	void refresh_time_ago();
+};
@@ -1,6 +1,7 @@
 #include "logs_table.h"
 #include "dps_report_uploader.h"
 #include "parser.h"
+#include "tracing.h"
 #include "addon.h"
 #include "ui.h"
 #include "ui_elements.h"
@@ -11,11 +12,18 @@
 
 void LogsTable::render()
 {
+	TRACE_THREAD("Render");
+	TRACE_SCOPE("LogsTable::render");
+
 	std::lock_guard lock(mutex);
 
-	update_logs();
+	{
+		TRACE_SCOPE("LogsTable::update_logs");
+		update_logs();
+	}
 
-	auto display_settings = addon::settings->get().display.log_table;
+	// rendered every frame, copy only the table settings
+	auto display_settings = addon::settings->read([](const SettingsData& settings) { return settings.display.log_table; });
 
 	auto open = this->open;
 
@@ -116,6 +124,15 @@ void LogsTable::render()
 		columns.push_back(Columns::RESULT);
 		columns.push_back(Columns::DURATION);
 
+		// queried once per frame, the parser keeps the order of its queue until it changes
+		ParserEtas etas;
+
+		if (display_settings.eta_column)
+		{
+			columns.push_back(Columns::ETA);
+			etas = addon::parser->get_etas();
+		}
+
 		if (display_settings.parser_column)
 			columns.push_back(Columns::PARSER);
 
@@ -146,6 +163,9 @@ void LogsTable::render()
 				case Columns::DURATION:
 					ImGui::TableSetupColumn("Duration", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize, std::max(ImGui::CalcTextSize("Duration").x, ImGui::CalcTextSize("00m 00s 000ms").x));
 					break;
+				case Columns::ETA:
+					ImGui::TableSetupColumn("ETA", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize, std::max(ImGui::CalcTextSize("ETA").x, ImGui::CalcTextSize("~00m 00s").x));
+					break;
 				case Columns::PARSER:
 					ImGui::TableSetupColumn("Report", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize, std::max(ImGui::CalcTextSize("Unavailable").x, ImGui::CalcTextSize("dps.report").x));
 					break;
@@ -224,6 +244,17 @@ void LogsTable::render()
 					case Columns::DURATION:
 						ImGui::TextUnformatted(view.duration.c_str());
 						break;
+					case Columns::ETA:
+						if (auto eta = etas.find(entry.ptr))
+						{
+							auto seconds = std::chrono::duration_cast<std::chrono::seconds>(*eta).count();
+
+							if (seconds >= 60)
+								ImGui::Text("~%lldm %02llds", seconds / 60, seconds % 60);
+							else
+								ImGui::Text("~%llds", seconds);
+						}
+						break;
 					case Columns::PARSER:
 						ImGui::ButtonParser(entry.ptr, entry.data);
 						break;
@@ -322,6 +353,7 @@ void LogsTable::draw_context_menu()
 					UPLOAD_TO_DPS_REPORT,
 					COPY_DPS_REPORT_URLS,
 					UPLOAD_TO_WINGMAN,
+					CANCEL,
 					COUNT
 				};
 
@@ -330,7 +362,9 @@ void LogsTable::draw_context_menu()
 				auto fill_action_logs = [&](LogTableEntry& e) {
 					if (e.data.parser_data.status == ParseStatus::PARSED)
 					{
-						action_logs[static_cast<size_t>(LogAction::OPEN_REPORTS)].push_back(e);
+						// missing reports are generated when opened
+						if (!e.data.parser_data.report_queued)
+							action_logs[static_cast<size_t>(LogAction::OPEN_REPORTS)].push_back(e);
 
 						if (e.data.wingman_upload.status == UploadStatus::AVAILABLE || e.data.wingman_upload.status == UploadStatus::FAILED)
 						{
@@ -351,6 +385,13 @@ void LogsTable::draw_context_menu()
 					{
 						action_logs[static_cast<size_t>(LogAction::COPY_DPS_REPORT_URLS)].push_back(e);
 					}
+
+					static const auto is_pending = [](UploadStatus status) { return status == UploadStatus::QUEUED || status == UploadStatus::UPLOADING; };
+
+					if (e.data.parser_data.status == ParseStatus::QUEUED || e.data.parser_data.status == ParseStatus::PARSING || e.data.parser_data.report_queued || is_pending(e.data.dps_report_upload.status) || is_pending(e.data.wingman_upload.status))
+					{
+						action_logs[static_cast<size_t>(LogAction::CANCEL)].push_back(e);
+					}
 				};
 
 				if (is_all)
@@ -391,7 +432,7 @@ void LogsTable::draw_context_menu()
 						if (ImGui::MenuItem(("Open reports (" + std::to_string(logs_for_open.size()) + ")").c_str()))
 						{
 							for (auto& entry : logs_for_open)
-								ShellExecuteW(nullptr, L"open", entry.get().data.parser_data.html_file_path.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
+								addon::parser->open_report(entry.get().ptr);
 						}
 					}
 				}
@@ -468,6 +509,27 @@ void LogsTable::draw_context_menu()
 					}
 				}
 
+				{
+					auto& logs_for_cancel = action_logs[static_cast<size_t>(LogAction::CANCEL)];
+
+					if (!logs_for_cancel.empty())
+					{
+						any_option = true;
+
+						if (ImGui::MenuItem(("Cancel (" + std::to_string(logs_for_cancel.size()) + ")").c_str()))
+						{
+							// each cancel only affects jobs of the log that are queued or running
+							for (auto& entry : logs_for_cancel)
+							{
+								addon::parser->cancel(entry.get().ptr);
+								addon::dps_report_uploader->cancel(entry.get().ptr);
+								addon::wingman_uploader->cancel(entry.get().ptr);
+							}
+						}
+						ImGui::HoverTooltip("Cancel the queued and running parses and uploads of these logs");
+					}
+				}
+
 				if (!any_option)
 					ImGui::TextDisabled("No options available");
 			}
@@ -481,94 +543,4 @@ void LogsTable::draw_context_menu()
 	ImGui::Separator();
 	addon::ui->render_context_menu();
 	ImGui::EndPopup();
-}
-
-void LogTableEntry::update_view()
-{
-	if (data.parser_data.status == ParseStatus::PARSED)
-	{
-		auto& encounter = data.parser_data.encounter;
-
-		auto time = std::chrono::clock_cast<std::chrono::system_clock>(encounter.end_time);
-		std::chrono::zoned_time local_time = { std::chrono::current_zone(), time };
-
-		view.time = std::format("{:%H:%M}", local_time);
-		view.name = encounter.name;
-		view.result = encounter.success ? "Success" : encounter.has_boss ? std::format("{:.2f}%", 100.f - encounter.health_percent_burned)
-		                                                                 : "Failure";
-
-		auto update_duration = [&]() {
-			auto minutes = encounter.duration_ms / (60 * 1000);
-			auto seconds = (encounter.duration_ms / 1000) % 60;
-			auto milliseconds = encounter.duration_ms % 1000;
-
-			std::ostringstream oss;
-			if (minutes > 0)
-				oss << std::setfill('0') << std::setw(1) << minutes << "m ";
-			oss << std::setfill('0') << std::setw(1) << seconds << "s ";
-			oss << std::setfill('0') << std::setw(1) << milliseconds << "ms";
-
-			view.duration = oss.str();
-		};
-
-		update_duration();
-	}
-	else
-	{
-		auto time = std::chrono::clock_cast<std::chrono::system_clock>(data.evtc_file_time);
-		std::chrono::zoned_time local_time = { std::chrono::current_zone(), time };
-
-		view.time = std::format("{:%H:%M}", local_time);
-
-		auto it = EncounterNames.find(data.trigger_id);
-
-		if (it != EncounterNames.end())
-			view.name = it->second;
-		else
-			view.name = "Undefined";
-	}
-}
-
-void LogTableEntry::refresh_time_ago()
-{
-	auto get_time_ago = [](const std::chrono::system_clock::time_point& timepoint) {
-		auto sys_time = std::chrono::clock_cast<std::chrono::system_clock>(timepoint);
-		auto sys_time_trunc = std::chrono::floor<std::chrono::seconds>(sys_time);
-
-		std::chrono::zoned_time local_time{ std::chrono::current_zone(), sys_time_trunc };
-
-		std::string formatted_time = std::format("{:%d %B %Y, %H:%M:%S}", local_time);
-
-		std::ostringstream timestamp_stream;
-
-		timestamp_stream << formatted_time;
-
-		auto now = std::chrono::system_clock::now();
-
-		auto diff = now - timepoint;
-
-		std::vector<std::pair<int64_t, std::string>> components = { { std::chrono::duration_cast<std::chrono::years>(diff).count(), "y" }, { std::chrono::duration_cast<std::chrono::months>(diff % std::chrono::years(1)).count(), "M" },
-			{ std::chrono::duration_cast<std::chrono::days>(diff % std::chrono::months(1)).count(), "d" }, { std::chrono::duration_cast<std::chrono::hours>(diff % std::chrono::days(1)).count(), "h" }, { std::chrono::duration_cast<std::chrono::minutes>(diff % std::chrono::hours(1)).count(), "m" },
-			{ std::chrono::duration_cast<std::chrono::seconds>(diff % std::chrono::minutes(1)).count(), "s" } };
-
-		std::ostringstream ago_stream;
-		bool first = true;
-		for (const auto& [value, unit] : components)
-		{
-			if (value > 0)
-			{
-				ago_stream << value << unit + " ";
-				first = false;
-			}
-		}
-
-		if (first)
-			ago_stream << "now";
-		else
-			ago_stream << "ago";
-
-		return timestamp_stream.str() + " (" + ago_stream.str() + ")";
-	};
-
-	view.time_ago = get_time_ago(data.parser_data.status != ParseStatus::PARSED ? data.evtc_file_time : data.parser_data.encounter.end_time);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "log.h"
+#include "log_table_entry.h"
 
 #include <imgui.h>
 
@@ -10,44 +11,6 @@
 #include <string>
 #include <unordered_map>
 
-struct LogView
-{
-	bool selected = false;
-
-	std::string name;
-	std::string time;
-	std::string result;
-	std::string duration;
-	std::string time_ago;
-};
-
-class LogTableEntry
-{
-public:
-	std::shared_ptr<Log> ptr;
-	LogData data;
-	LogView view;
-
-	LogTableEntry(std::shared_ptr<Log> ptr) { this->ptr = ptr; }
-
-	void update()
-	{
-		auto view_update_required = false;
-
-		{
-			std::shared_lock lock(ptr->mutex);
-			if (view_update_required = ptr->view_updated_required.exchange(false))
-				this->data = ptr->get_data();
-		}
-
-		if (view_update_required)
-			update_view();
-	}
-
-	void update_view();
-	void refresh_time_ago();
-};
-
 class LogsTable
 {
 public:
@@ -109,6 +72,7 @@ private:
 		NAME,
 		RESULT,
 		DURATION,
+		ETA,
 		PARSER,
 		DPS_REPORT,
 		WINGMAN,
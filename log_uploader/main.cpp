@@ -1,12 +1,18 @@
 #include "addon.h"
 
+#include "artifact_compressor.h"
 #include "directory_monitor.h"
 #include "dps_report_uploader.h"
+#include "fingerprint_index.h"
 #include "log_manager.h"
+#include "parse_cost_model.h"
 #include "parser.h"
 #include "resource.h"
+#include "retention_manager.h"
 #include "settings.h"
 #include "ui.h"
+#include "upload_archives.h"
+#include "upload_journal.h"
 #include "wingman_uploader.h"
 
 #include <Nexus.h>
@@ -65,6 +71,13 @@ void load(AddonAPI_t* addon_api)
 	ImGui::SetAllocatorFunctions((void* (*)(size_t, void*))addon::api->ImguiMalloc, (void (*)(void*, void*))addon::api->ImguiFree);
 
 	addon::settings->initialize();
+	addon::log_level.store(static_cast<LogLevel>(addon::settings->get().general.log_level));
+	addon::start_log_sink();
+
+	addon::upload_journal->initialize();
+	addon::fingerprint_index->initialize();
+	addon::parse_cost_model->initialize();
+	addon::upload_archives->initialize();
 
 	addon::api->GUI_Register(RT_Render, render);
 	addon::api->GUI_Register(RT_OptionsRender, render_options);
@@ -72,8 +85,12 @@ void load(AddonAPI_t* addon_api)
 	addon::parser->initialize();
 	addon::dps_report_uploader->initialize();
 	addon::wingman_uploader->initialize();
+	addon::artifact_compressor->initialize();
+	addon::retention_manager->initialize();
 
 	addon::directory_monitor->initialize();
+
+	addon::upload_journal->restore();
 }
 
 void unload()
@@ -86,10 +103,21 @@ void unload()
 	addon::api->GUI_Deregister(render);
 	addon::api->GUI_Deregister(render_options);
 
+	addon::upload_journal->stop_restore();
 	addon::directory_monitor->release();
 	addon::parser->release();
+	addon::artifact_compressor->release();
 	addon::dps_report_uploader->release();
 	addon::wingman_uploader->release();
+	addon::log_manager->release();
+	addon::retention_manager->release();
+
+	addon::upload_archives->release();
+	addon::parse_cost_model->release();
+	addon::fingerprint_index->release();
+	addon::upload_journal->release();
+
+	addon::stop_log_sink();
 }
 
 AddonDefinition_t addon_definition;
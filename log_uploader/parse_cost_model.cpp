@@ -0,0 +1,205 @@
+#include "parse_cost_model.h"
+#include "addon.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+IMPLEMENT_MODULE(ParseCostModel, parse_cost_model)
+
+#define COST_MODEL_FILE "parse_costs.json"
+#define DECAY 0.95
+#define MIN_SAMPLES 3
+
+// used until the first parses were recorded, generous enough for large WvW logs
+#define DEFAULT_OVERHEAD_MS 10000.0
+#define DEFAULT_MS_PER_MB 2000.0
+
+#define DEADLINE_FACTOR 4
+#define DEADLINE_MARGIN std::chrono::seconds(30)
+#define MIN_DEADLINE std::chrono::seconds(60)
+#define MAX_DEADLINE std::chrono::minutes(30)
+#define DEFAULT_DEADLINE std::chrono::milliseconds(180000)
+
+namespace
+{
+std::string get_key(std::optional<TriggerID> trigger_id, ParseMode mode)
+{
+	auto mode_name = mode == ParseMode::JSON_AND_HTML ? "html" : "json";
+	return (trigger_id.has_value() ? std::to_string(static_cast<uint16_t>(trigger_id.value())) : std::string("all")) + "/" + mode_name;
+}
+
+double to_megabytes(uint64_t size) { return static_cast<double>(size) / (1024.0 * 1024.0); }
+} // namespace
+
+void ParseCostModel::Fit::add(double x, double y)
+{
+	weight = weight * DECAY + 1.0;
+	sum_x = sum_x * DECAY + x;
+	sum_y = sum_y * DECAY + y;
+	sum_xx = sum_xx * DECAY + x * x;
+	sum_xy = sum_xy * DECAY + x * y;
+	++count;
+}
+
+std::optional<double> ParseCostModel::Fit::predict(double x) const
+{
+	if (count < MIN_SAMPLES || weight <= 0.0)
+		return std::nullopt;
+
+	auto mean_x = sum_x / weight;
+	auto mean_y = sum_y / weight;
+	auto variance_x = sum_xx / weight - mean_x * mean_x;
+
+	// logs of one encounter are often about the same size, the fit then degenerates to the mean time per byte
+	if (variance_x > 1e-6 * std::max(mean_x * mean_x, 1e-6))
+	{
+		auto slope = (sum_xy / weight - mean_x * mean_y) / variance_x;
+		auto intercept = mean_y - slope * mean_x;
+
+		if (slope >= 0.0 && intercept >= 0.0)
+			return intercept + slope * x;
+	}
+
+	if (mean_x <= 0.0)
+		return mean_y;
+
+	return mean_y / mean_x * x;
+}
+
+void ParseCostModel::initialize()
+{
+	file_path = addon::directory / COST_MODEL_FILE;
+
+	std::lock_guard lock(fits_mutex);
+
+	try
+	{
+		load();
+	}
+	catch (const std::exception& e)
+	{
+		addon::log("Failed to load parse cost model: " + file_path.string() + " Exception: " + e.what(), LOGLEVEL_WARNING);
+		fits.clear();
+	}
+}
+
+void ParseCostModel::release()
+{
+	std::lock_guard lock(fits_mutex);
+	fits.clear();
+}
+
+std::optional<std::chrono::milliseconds> ParseCostModel::predict(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size)
+{
+	auto x = to_megabytes(evtc_size);
+
+	std::lock_guard lock(fits_mutex);
+
+	for (auto key : { get_key(trigger_id, mode), get_key(std::nullopt, mode) })
+	{
+		auto it = fits.find(key);
+
+		if (it == fits.end())
+			continue;
+
+		if (auto prediction = it->second.predict(x); prediction.has_value())
+			return std::chrono::milliseconds(static_cast<int64_t>(std::max(prediction.value(), 1.0)));
+	}
+
+	return std::nullopt;
+}
+
+std::chrono::milliseconds ParseCostModel::estimate(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size)
+{
+	if (auto prediction = predict(trigger_id, mode, evtc_size); prediction.has_value())
+		return prediction.value();
+
+	return std::chrono::milliseconds(static_cast<int64_t>(DEFAULT_OVERHEAD_MS + DEFAULT_MS_PER_MB * to_megabytes(evtc_size)));
+}
+
+std::chrono::milliseconds ParseCostModel::get_deadline(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size)
+{
+	auto prediction = predict(trigger_id, mode, evtc_size);
+
+	// without any history the fixed timeout of earlier versions applies, raised for logs the default estimate expects to take longer
+	if (!prediction.has_value())
+		return std::clamp<std::chrono::milliseconds>(DEADLINE_FACTOR * estimate(trigger_id, mode, evtc_size), DEFAULT_DEADLINE, MAX_DEADLINE);
+
+	return std::clamp<std::chrono::milliseconds>(DEADLINE_FACTOR * prediction.value() + DEADLINE_MARGIN, MIN_DEADLINE, MAX_DEADLINE);
+}
+
+void ParseCostModel::record(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size, std::chrono::milliseconds duration)
+{
+	if (evtc_size == 0 || duration.count() <= 0)
+		return;
+
+	auto x = to_megabytes(evtc_size);
+	auto y = static_cast<double>(duration.count());
+
+	std::lock_guard lock(fits_mutex);
+
+	fits[get_key(trigger_id, mode)].add(x, y);
+	fits[get_key(std::nullopt, mode)].add(x, y);
+
+	save();
+}
+
+void ParseCostModel::load()
+{
+	fits.clear();
+
+	if (!std::filesystem::exists(file_path))
+		return;
+
+	std::ifstream file(file_path, std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open parse cost model file");
+
+	auto json = nlohmann::json::parse(file);
+
+	for (const auto& [key, value] : json.items())
+	{
+		Fit fit;
+		fit.weight = value.value("weight", 0.0);
+		fit.sum_x = value.value("sum_x", 0.0);
+		fit.sum_y = value.value("sum_y", 0.0);
+		fit.sum_xx = value.value("sum_xx", 0.0);
+		fit.sum_xy = value.value("sum_xy", 0.0);
+		fit.count = value.value("count", uint64_t(0));
+
+		fits.emplace(key, fit);
+	}
+}
+
+void ParseCostModel::save()
+{
+	nlohmann::json json = nlohmann::json::object();
+
+	for (const auto& [key, fit] : fits)
+		json[key] = { { "weight", fit.weight }, { "sum_x", fit.sum_x }, { "sum_y", fit.sum_y }, { "sum_xx", fit.sum_xx }, { "sum_xy", fit.sum_xy }, { "count", fit.count } };
+
+	auto temp_file_path = file_path;
+	temp_file_path += ".tmp";
+
+	try
+	{
+		{
+			std::ofstream file(temp_file_path, std::ios::binary | std::ios::trunc);
+
+			if (!file.is_open())
+				throw std::runtime_error("Failed to create file: " + temp_file_path.string());
+
+			file << json.dump();
+		}
+
+		std::filesystem::rename(temp_file_path, file_path);
+	}
+	catch (const std::exception& e)
+	{
+		addon::log("Failed to save parse cost model: " + file_path.string() + " Exception: " + e.what(), LOGLEVEL_WARNING);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "elite_insights.h"
+#include "log.h"
+#include "module.h"
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// learns how long Elite Insights takes per encounter and per uncompressed evtc byte from completed parses, the predictions set parse deadlines and the parser queue order
+class ParseCostModel
+{
+public:
+	void initialize();
+	void release();
+
+	// expected Elite Insights run time, from the encounter if enough of its logs were parsed, otherwise from all logs or a conservative default
+	std::chrono::milliseconds estimate(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size);
+
+	// time after which a parse is considered stuck and terminated
+	std::chrono::milliseconds get_deadline(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size);
+
+	void record(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size, std::chrono::milliseconds duration);
+
+private:
+	// exponentially weighted least squares fit of duration_ms = a + b * size_mb, recent parses count most as Elite Insights and the hardware change
+	struct Fit
+	{
+		double weight = 0.0;
+		double sum_x = 0.0;
+		double sum_y = 0.0;
+		double sum_xx = 0.0;
+		double sum_xy = 0.0;
+		uint64_t count = 0;
+
+		void add(double x, double y);
+		std::optional<double> predict(double x) const;
+	};
+
+	std::filesystem::path file_path;
+
+	std::mutex fits_mutex;
+	std::unordered_map<std::string, Fit> fits;
+
+	std::optional<std::chrono::milliseconds> predict(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size);
+
+	void load();
+	void save();
+};
+
+DECLARE_MODULE(ParseCostModel, parse_cost_model)
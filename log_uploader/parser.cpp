@@ -1,22 +1,52 @@
 #include "parser.h"
+#include "artifact_compressor.h"
 #include "dps_report_uploader.h"
 #include "log_manager.h"
+#include "parse_cost_model.h"
+#include "retention_manager.h"
+#include "statistics.h"
+#include "tracing.h"
 #include "addon.h"
 #include "ui.h"
 #include "wingman_uploader.h"
 
+#include <algorithm>
+
 IMPLEMENT_MODULE(Parser, parser)
 
+#define UPDATE_INTERVAL std::chrono::hours(6)
+#define INSTALL_RETRY_INTERVAL std::chrono::minutes(5)
+#define SHORTEST_JOB_FIRST_DEPTH 4
+#define MAX_JOB_WAIT std::chrono::minutes(10)
+#define REPORT_COPY_LIFETIME std::chrono::minutes(30)
+
+namespace
+{
+// successful runs teach the cost model, failed and cancelled ones say little about the time a parse takes
+void record_cost(TriggerID trigger_id, ParseMode mode, uint64_t evtc_size, const PipelineTimes& pipeline_times)
+{
+	auto started = pipeline_times[PipelineStage::ELITE_INSIGHTS_STARTED];
+	auto finished = pipeline_times[PipelineStage::ELITE_INSIGHTS_FINISHED];
+
+	if (started.has_value() && finished.has_value())
+		addon::parse_cost_model->record(trigger_id, mode, evtc_size, std::chrono::duration_cast<std::chrono::milliseconds>(finished.value() - started.value()));
+}
+} // namespace
+
 void Parser::initialize()
 {
+	stop_source = std::stop_source();
 	loaded.store(true);
 
 	parser_thread = std::thread(&Parser::run, this);
+	updater_thread = std::thread(&Parser::run_updater, this);
+	opener_thread = std::thread(&Parser::run_opener, this);
 }
 
 void Parser::release()
 {
 	loaded.store(false);
+	stop_source.request_stop();
 
 	clear_parser_queue();
 
@@ -24,6 +54,19 @@ void Parser::release()
 
 	if (parser_thread.joinable())
 		parser_thread.join();
+
+	if (updater_thread.joinable())
+		updater_thread.join();
+
+	{
+		std::lock_guard opener_queue_lock(opener_queue_mutex);
+		opener_queue.clear();
+	}
+
+	opener_cv.notify_all();
+
+	if (opener_thread.joinable())
+		opener_thread.join();
 }
 
 void Parser::add_log(std::shared_ptr<Log> log)
@@ -31,6 +74,8 @@ void Parser::add_log(std::shared_ptr<Log> log)
 	if (!loaded.load())
 		return;
 
+	auto mode = get_parse_mode(log);
+
 	std::unique_lock lock(log->mutex);
 
 	if (log->parser_data.status != ParseStatus::UNPARSED)
@@ -40,73 +85,574 @@ void Parser::add_log(std::shared_ptr<Log> log)
 	}
 
 	log->parser_data.status = ParseStatus::QUEUED;
+	log->parse_cancellation = std::stop_source();
+	addon::statistics->record_stage(log->pipeline_times, PipelineStage::PARSE_QUEUED);
+
+	ParserJob job{ log };
+	job.mode = mode;
+	job.cancellation = log->parse_cancellation;
+	estimate_job(job);
 
 	{
 		std::unique_lock parser_queue_lock(parser_queue_mutex);
-		parser_queue.push(log);
+		parser_queue.push_back(job);
+		eta_offsets.reset();
+		addon::statistics->set_queue_depth(PipelineQueue::PARSER, parser_queue.size());
 		parser_cv.notify_one();
 	}
 }
 
-void Parser::run()
+bool Parser::generate_report(std::shared_ptr<Log> log, bool open)
 {
-	addon::log("Starting parser", LOGLEVEL_DEBUG);
+	if (!loaded.load())
+		return false;
+
+	std::unique_lock lock(log->mutex);
+
+	if (log->parser_data.status != ParseStatus::PARSED)
+		return false;
+
+	// a queued generation serves every request for the report
+	if (log->parser_data.report_queued)
+		return true;
+
+	log->parser_data.report_queued = true;
+	log->parse_cancellation = std::stop_source();
+	log->update_view();
+
+	ParserJob job{ log, true, open, ParseMode::JSON_AND_HTML };
+	job.cancellation = log->parse_cancellation;
+	estimate_job(job);
+
+	{
+		std::unique_lock parser_queue_lock(parser_queue_mutex);
+		parser_queue.push_back(job);
+		eta_offsets.reset();
+		addon::statistics->set_queue_depth(PipelineQueue::PARSER, parser_queue.size());
+		parser_cv.notify_one();
+	}
+
+	return true;
+}
+
+void Parser::open_report(std::shared_ptr<Log> log)
+{
+	std::shared_lock lock(log->mutex);
+	auto parser_data = log->parser_data;
+	lock.unlock();
+
+	if (parser_data.status != ParseStatus::PARSED)
+		return;
+
+	if (!parser_data.has_report())
+	{
+		generate_report(log, true);
+		return;
+	}
+
+	if (!loaded.load())
+		return;
+
+	{
+		std::lock_guard opener_queue_lock(opener_queue_mutex);
+		opener_queue.push_back(log);
+	}
+
+	opener_cv.notify_one();
+}
+
+void Parser::cancel(std::shared_ptr<Log> log)
+{
+	std::unique_lock lock(log->mutex);
+
+	auto status = log->parser_data.status;
+
+	if (status == ParseStatus::PARSED && log->parser_data.report_queued)
+	{
+		// queued generations are skipped, a running one terminates Elite Insights and keeps the previous report paths
+		log->parse_cancellation.request_stop();
+		log->parser_data.report_queued = false;
+		log->update_view();
+
+		remove_queued_jobs(log);
+
+		lock.unlock();
+
+		addon::wingman_uploader->report_ready(log, "Report generation cancelled");
+		return;
+	}
+
+	if (status != ParseStatus::QUEUED && status != ParseStatus::PARSING)
+		return;
+
+	log->parse_cancellation.request_stop();
+
+	// running parses are reset by the parser thread once Elite Insights was terminated, queued ones are dropped
+	if (status == ParseStatus::QUEUED)
+	{
+		log->parser_data.status = ParseStatus::UNPARSED;
+		log->update_view();
+
+		remove_queued_jobs(log);
+
+		lock.unlock();
+
+		addon::wingman_uploader->drop_resumed_upload(log);
+	}
+}
+
+void Parser::remove_queued_jobs(const std::shared_ptr<Log>& log)
+{
+	std::unique_lock parser_queue_lock(parser_queue_mutex);
+
+	// the job taken by the parser thread already is skipped there, its cancellation is no longer current
+	auto removed = std::erase_if(parser_queue, [&log](const ParserJob& job) { return job.log == log && !job.is_current(log->parse_cancellation); });
+
+	if (removed > 0)
+	{
+		eta_offsets.reset();
+		addon::statistics->set_queue_depth(PipelineQueue::PARSER, parser_queue.size());
+	}
+}
+
+void Parser::run_opener()
+{
+	TRACE_THREAD("Report opener");
+
+	auto stop_token = stop_source.get_token();
+
+	// copies left behind by a previous session that did not unload cleanly
+	remove_stale_report_copies(REPORT_COPY_LIFETIME);
+
+	while (true)
+	{
+		std::unique_lock opener_queue_lock(opener_queue_mutex);
+
+		if (!opener_cv.wait(opener_queue_lock, stop_token, [this] { return !opener_queue.empty(); }))
+			break;
+
+		auto log = opener_queue.front();
+		opener_queue.pop_front();
+
+		opener_queue_lock.unlock();
+
+		TRACE_SCOPE("Parser::run_opener");
+
+		std::shared_lock lock(log->mutex);
+		auto parser_data = log->parser_data;
+		lock.unlock();
+
+		// the compressor or the retention manager may have removed the report since it was requested
+		if (parser_data.status != ParseStatus::PARSED)
+			continue;
+
+		if (!parser_data.has_report())
+		{
+			generate_report(log, true);
+			continue;
+		}
+
+		remove_stale_report_copies(REPORT_COPY_LIFETIME);
+
+		parser_data.open_report();
+		addon::retention_manager->touch_log(log);
+	}
+}
+
+void Parser::remove_stale_report_copies(std::chrono::minutes max_age)
+{
+	std::error_code ec;
+	auto now = std::filesystem::file_time_type::clock::now();
+
+	for (const auto& entry : std::filesystem::directory_iterator(ParserData::get_report_directory(), ec))
+	{
+		auto last_write_time = entry.last_write_time(ec);
+
+		if (!ec && now - last_write_time > max_age)
+			std::filesystem::remove(entry.path(), ec);
+	}
+}
+
+void Parser::run_updater()
+{
+	TRACE_THREAD("Elite Insights updater");
+
+	auto stop_token = stop_source.get_token();
+
+	auto notify_parser = [this]() {
+		std::lock_guard parser_queue_lock(parser_queue_mutex);
+		parser_cv.notify_all();
+	};
 
 	try
 	{
-		elite_insights.install();
+		elite_insights.load();
+		notify_parser();
 	}
 	catch (const std::exception& e)
 	{
-		addon::log("Failed to install Elite Insights: " + std::string(e.what()), LOGLEVEL_CRITICAL);
-		loaded.store(false);
-		return;
+		addon::log("Failed to load Elite Insights: " + std::string(e.what()), LOGLEVEL_WARNING);
 	}
 
+	while (!stop_token.stop_requested())
+	{
+		try
+		{
+			if (elite_insights.update(stop_token))
+				notify_parser();
+		}
+		catch (const std::exception& e)
+		{
+			if (stop_token.stop_requested())
+			{
+				addon::log("Elite Insights installation cancelled", LOGLEVEL_DEBUG);
+				break;
+			}
+
+			if (elite_insights.is_installed())
+				addon::log("Failed to update Elite Insights: " + std::string(e.what()), LOGLEVEL_WARNING);
+			else
+				addon::log("Failed to install Elite Insights: " + std::string(e.what()), LOGLEVEL_CRITICAL);
+		}
+
+		// without any installation parses are waiting, the next attempt comes sooner
+		auto interval = elite_insights.is_installed() ? UPDATE_INTERVAL : INSTALL_RETRY_INTERVAL;
+
+		std::unique_lock updater_lock(updater_mutex);
+		updater_cv.wait_for(updater_lock, stop_token, interval, [] { return false; });
+	}
+}
+
+void Parser::run()
+{
+	addon::log("Starting parser", LOGLEVEL_DEBUG);
+
+	TRACE_THREAD("Parser");
+
 	while (true)
 	{
 		std::unique_lock parser_queue_lock(parser_queue_mutex);
 
-		parser_cv.wait(parser_queue_lock, [this] { return !loaded.load() || !parser_queue.empty(); });
+		{
+			// queued logs wait for the first installation, updates are installed alongside and never block parsing
+			TRACE_SCOPE("Parser::run wait queue");
+			parser_cv.wait(parser_queue_lock, [this] { return !loaded.load() || (!parser_queue.empty() && elite_insights.is_installed()); });
+		}
 
 		if (!loaded.load())
 			break;
 
-		auto log = parser_queue.front();
-		parser_queue.pop();
+		auto index = get_next_job_index(parser_queue, std::chrono::steady_clock::now());
+
+		auto job = parser_queue[index];
+		parser_queue.erase(parser_queue.begin() + index);
+		addon::statistics->set_queue_depth(PipelineQueue::PARSER, parser_queue.size());
+
+		running_log = job.log;
+		running_expected_end = std::chrono::steady_clock::now() + job.estimated_cost;
+		eta_offsets.reset();
 
 		parser_queue_lock.unlock();
 
-		std::unique_lock log_lock(log->mutex);
+		if (job.generate_report)
+			process_report_job(job);
+		else
+			process_parse_job(job);
 
-		auto evtc_file_path = log->evtc_file_path;
+		parser_queue_lock.lock();
+		running_log.reset();
+		eta_offsets.reset();
+	}
+}
 
-		log->parser_data.status = ParseStatus::PARSING;
+void Parser::estimate_job(ParserJob& job)
+{
+	job.estimated_cost = addon::parse_cost_model->estimate(job.log->trigger_id, job.mode, job.log->evtc_size);
+	job.deadline = addon::parse_cost_model->get_deadline(job.log->trigger_id, job.mode, job.log->evtc_size);
+	job.queued_time = std::chrono::steady_clock::now();
+}
 
-		log->update_view();
+size_t Parser::get_next_job_index(const std::deque<ParserJob>& queue, std::chrono::steady_clock::time_point now)
+{
+	if (queue.size() < SHORTEST_JOB_FIRST_DEPTH)
+		return 0;
 
-		log_lock.unlock();
+	// the front is the oldest job, once it waited too long it goes first regardless of its cost so large logs are not starved
+	if (now - queue.front().queued_time >= MAX_JOB_WAIT)
+		return 0;
+
+	auto shortest = std::min_element(queue.begin(), queue.end(), [](const ParserJob& a, const ParserJob& b) { return a.estimated_cost < b.estimated_cost; });
+
+	return static_cast<size_t>(std::distance(queue.begin(), shortest));
+}
+
+void Parser::update_eta_offsets(std::chrono::steady_clock::time_point now)
+{
+	auto offsets = std::make_shared<std::unordered_map<std::shared_ptr<Log>, std::chrono::milliseconds>>();
+
+	if (running_log)
+		offsets->emplace(running_log, std::chrono::milliseconds(0));
+
+	eta_offsets_expiry = std::chrono::steady_clock::time_point::max();
+
+	for (const auto& job : parser_queue)
+		if (job.queued_time + MAX_JOB_WAIT > now)
+			eta_offsets_expiry = std::min(eta_offsets_expiry, job.queued_time + MAX_JOB_WAIT);
+
+	auto queue = parser_queue;
+	std::chrono::milliseconds offset{};
+
+	while (!queue.empty())
+	{
+		auto index = get_next_job_index(queue, now);
+
+		offset += queue[index].estimated_cost;
+		offsets->try_emplace(queue[index].log, offset);
+
+		queue.erase(queue.begin() + index);
+	}
+
+	eta_offsets = std::move(offsets);
+}
+
+ParserEtas Parser::get_etas()
+{
+	std::lock_guard parser_queue_lock(parser_queue_mutex);
+
+	auto now = std::chrono::steady_clock::now();
+
+	if (!eta_offsets || now >= eta_offsets_expiry)
+		update_eta_offsets(now);
+
+	ParserEtas etas;
+	etas.offsets = eta_offsets;
+
+	// a parse running over its estimate is expected to finish any moment
+	if (running_log)
+		etas.queue_start = std::chrono::duration_cast<std::chrono::milliseconds>(std::max(running_expected_end, now) - now);
+
+	return etas;
+}
+
+ParseMode Parser::get_parse_mode(std::shared_ptr<Log> log)
+{
+	if (addon::settings->read([](const SettingsData& s) { return s.parser.always_generate_html; }))
+		return ParseMode::JSON_AND_HTML;
+
+	// generating the html with the parse saves a second Elite Insights run for logs Wingman uploads anyway
+	return addon::wingman_uploader->needs_report(log) ? ParseMode::JSON_AND_HTML : ParseMode::JSON;
+}
+
+void Parser::process_parse_job(const ParserJob& job)
+{
+	TRACE_SCOPE("Parser::process_parse_job");
+
+	const auto& log = job.log;
+
+	std::unique_lock log_lock(log->mutex, std::defer_lock);
+	traced_lock(log_lock, "Parser::run wait log");
+
+	// cancelled while queued, or queued again after that and this job is not the one the log waits for
+	if (log->parser_data.status != ParseStatus::QUEUED || !job.is_current(log->parse_cancellation))
+		return;
+
+	auto evtc_file_path = log->evtc_file_path;
+	auto cancel_source = job.cancellation;
+
+	log->parser_data.status = ParseStatus::PARSING;
+
+	log->update_view();
+
+	log_lock.unlock();
+
+	// releasing the parser cancels the running parse like the user would
+	std::stop_callback cancel_on_release(stop_source.get_token(), [&cancel_source]() { cancel_source.request_stop(); });
+
+	// set once Elite Insights exited, recorded after the job whether it succeeded or not
+	std::optional<ParseResourceUsage> resource_usage;
+	auto parsed = false;
+	std::string encounter_name;
+
+	try
+	{
+		PipelineTimes pipeline_times;
+		auto parser_data = elite_insights.parse(evtc_file_path, job.mode, job.deadline, pipeline_times, resource_usage, cancel_source.get_token());
+
+		parsed = parser_data.status == ParseStatus::PARSED;
+		encounter_name = parser_data.encounter.name;
+
+		if (parsed)
+			record_cost(log->trigger_id, job.mode, log->evtc_size, pipeline_times);
 
-		try
 		{
-			auto parser_data = elite_insights.parse(evtc_file_path);
+			std::unique_lock lock(log->mutex);
+			log->parser_data = parser_data;
 
-			{
-				std::unique_lock lock(log->mutex);
-				log->parser_data = parser_data;
-				log->update_view();
-			}
+			for (auto stage : { PipelineStage::ELITE_INSIGHTS_STARTED, PipelineStage::ELITE_INSIGHTS_FINISHED, PipelineStage::JSON_EXTRACTED })
+				if (pipeline_times[stage].has_value())
+					addon::statistics->record_stage(log->pipeline_times, stage, pipeline_times[stage].value());
 
-			addon::dps_report_uploader->process_auto_upload(log);
+			log->update_view();
+		}
+
+		addon::retention_manager->touch_log(log);
+		addon::dps_report_uploader->process_auto_upload(log);
+
+		if (addon::settings->read([](const SettingsData& s) { return s.parser.compress_reports || s.wingman.compress_uploads; }))
+			addon::artifact_compressor->add_log(log);
+		else
 			addon::wingman_uploader->process_auto_upload(log);
+	}
+	catch (const std::exception& e)
+	{
+		std::unique_lock lock(log->mutex);
+
+		if (resource_usage.has_value())
+			log->parser_data.resource_usage = resource_usage;
+
+		if (cancel_source.stop_requested())
+		{
+			log->parser_data.status = ParseStatus::UNPARSED;
+			log->parser_data.error_message.reset();
+			addon::log("Parsing cancelled: " + log->id, LOGLEVEL_INFO);
 		}
-		catch (const std::exception& e)
+		else
 		{
-			std::unique_lock lock(log->mutex);
 			log->parser_data.status = ParseStatus::FAILED;
 			log->parser_data.error_message = e.what();
 			addon::log("Failed to parse log with Elite Insights: " + log->id + " Exception: " + e.what(), LOGLEVEL_WARNING);
-			log->update_view();
 		}
+
+		log->update_view();
+	}
+
+	// a failed or cancelled parse leaves nothing for a restored upload, unless the parser was released and it is restored again on the next load
+	if (!parsed && !stop_source.stop_requested())
+		addon::wingman_uploader->drop_resumed_upload(log);
+
+	if (resource_usage.has_value())
+		addon::statistics->record_parse_resources(log->trigger_id, resource_usage.value(), parsed, encounter_name);
+}
+
+void Parser::process_report_job(const ParserJob& job)
+{
+	TRACE_SCOPE("Parser::process_report_job");
+
+	const auto& log = job.log;
+
+	std::unique_lock log_lock(log->mutex, std::defer_lock);
+	traced_lock(log_lock, "Parser::run wait log");
+
+	// cancelled while queued, or requested again after that and this job is not the one the log waits for
+	if (log->parser_data.status != ParseStatus::PARSED || !log->parser_data.report_queued || !job.is_current(log->parse_cancellation))
+		return;
+
+	auto evtc_file_path = log->evtc_file_path;
+	auto cancel_source = job.cancellation;
+	auto previous_parser_data = log->parser_data;
+
+	log_lock.unlock();
+
+	std::stop_callback cancel_on_release(stop_source.get_token(), [&cancel_source]() { cancel_source.request_stop(); });
+
+	std::optional<std::string> error_message;
+	std::optional<ParseResourceUsage> resource_usage;
+	auto parsed = false;
+	std::string encounter_name;
+
+	auto compress = addon::settings->read([](const SettingsData& s) { return s.parser.compress_reports || s.wingman.compress_uploads; });
+
+	try
+	{
+		// the encounter was read by the first parse, report generation is left out of the pipeline statistics
+		PipelineTimes pipeline_times;
+		auto parser_data = elite_insights.parse(evtc_file_path, job.mode, job.deadline, pipeline_times, resource_usage, cancel_source.get_token());
+
+		parsed = parser_data.status == ParseStatus::PARSED;
+		encounter_name = parser_data.encounter.name;
+
+		if (!parsed)
+			throw std::runtime_error("Elite Insights did not generate a report");
+
+		record_cost(log->trigger_id, job.mode, log->evtc_size, pipeline_times);
+
+		log_lock.lock();
+
+		// the json of the first parse lacks the combat replay, compressed copies of it are replaced by the compressor
+		log->parser_data.json_file_path = parser_data.json_file_path;
+		log->parser_data.html_file_path = parser_data.html_file_path;
+		log->parser_data.compressed_json_file_path.clear();
+		log->parser_data.compressed_html_file_path.clear();
+		log->parser_data.error_message.reset();
+		log->parser_data.resource_usage = resource_usage;
+
+		// a cancelled generation may have been requested again in the meantime
+		if (log->parse_cancellation == cancel_source)
+			log->parser_data.report_queued = false;
+
+		auto report = log->parser_data;
+
+		log->update_view();
+
+		log_lock.unlock();
+
+		std::error_code ec;
+
+		for (const auto& file_path : { previous_parser_data.json_file_path, previous_parser_data.compressed_json_file_path, previous_parser_data.compressed_html_file_path })
+			if (!file_path.empty() && file_path != report.json_file_path && file_path != report.html_file_path)
+			{
+				std::filesystem::remove(file_path, ec);
+				addon::retention_manager->forget(file_path);
+			}
+
+		addon::retention_manager->touch_log(log);
+
+		if (job.open_report)
+		{
+			// the compressor may remove the report before the browser read it, the browser gets a temporary copy instead
+			if (compress)
+			{
+				auto report_file_path = ParserData::get_report_directory() / report.html_file_path.filename();
+
+				std::filesystem::create_directories(report_file_path.parent_path(), ec);
+
+				if (std::filesystem::copy_file(report.html_file_path, report_file_path, std::filesystem::copy_options::overwrite_existing, ec))
+					report.html_file_path = report_file_path;
+			}
+
+			report.open_report();
+		}
+
+		addon::log("Generated report: " + log->id, LOGLEVEL_DEBUG);
 	}
+	catch (const std::exception& e)
+	{
+		error_message = cancel_source.stop_requested() ? "Report generation cancelled" : e.what();
+
+		log_lock.lock();
+
+		if (resource_usage.has_value())
+			log->parser_data.resource_usage = resource_usage;
+
+		if (log->parse_cancellation == cancel_source)
+			log->parser_data.report_queued = false;
+
+		if (!cancel_source.stop_requested())
+		{
+			log->parser_data.error_message = "Failed to generate report: " + std::string(e.what());
+			addon::log("Failed to generate report: " + log->id + " Exception: " + e.what(), LOGLEVEL_WARNING);
+		}
+
+		log->update_view();
+
+		log_lock.unlock();
+	}
+
+	if (resource_usage.has_value())
+		addon::statistics->record_parse_resources(log->trigger_id, resource_usage.value(), parsed, encounter_name);
+
+	addon::wingman_uploader->report_ready(log, error_message);
+
+	if (!error_message.has_value() && compress)
+		addon::artifact_compressor->add_log(log);
 }
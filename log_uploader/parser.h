@@ -3,11 +3,40 @@
 #include "elite_insights.h"
 #include "log.h"
 #include "module.h"
+#include "statistics.h"
 
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
 #include <thread>
+#include <unordered_map>
+
+// expected time until the parses of the queued and running logs finish, cheap to copy and query every frame
+class ParserEtas
+{
+public:
+	// time until the running parse is expected to finish, the queued ones start after it
+	std::chrono::milliseconds queue_start{};
+
+	// of the running log zero, of the queued logs the time from queue_start until their parse finishes
+	std::shared_ptr<const std::unordered_map<std::shared_ptr<Log>, std::chrono::milliseconds>> offsets;
+
+	std::optional<std::chrono::milliseconds> find(const std::shared_ptr<Log>& log) const
+	{
+		if (!offsets)
+			return std::nullopt;
+
+		auto it = offsets->find(log);
+
+		if (it == offsets->end())
+			return std::nullopt;
+
+		return queue_start + it->second;
+	}
+};
 
 class Parser
 {
@@ -17,23 +46,106 @@ public:
 
 	void add_log(std::shared_ptr<Log> log);
 
+	// queues Elite Insights for the html report of a parsed log that has none, returns false if the parser is unavailable or the log is not parsed
+	bool generate_report(std::shared_ptr<Log> log, bool open);
+
+	// opens the html report of a parsed log off the calling thread, a compressed one is decompressed first and a missing one is generated and opened once done
+	void open_report(std::shared_ptr<Log> log);
+
+	// cancels a queued or running parse of the log, the log becomes unparsed again. a report generation is cancelled the same way but the log stays parsed
+	void cancel(std::shared_ptr<Log> log);
+
+	// expected time until the parses of the queued and running logs finish, following the order the queue is worked off in
+	ParserEtas get_etas();
+
 private:
+	struct ParserJob
+	{
+		std::shared_ptr<Log> log;
+
+		// runs Elite Insights in html mode for a parsed log, only its report paths are updated
+		bool generate_report = false;
+		bool open_report = false;
+
+		ParseMode mode = ParseMode::JSON;
+
+		// predicted by the cost model when queued, along with the uncompressed evtc size it is based on
+		std::chrono::milliseconds estimated_cost{};
+		std::chrono::milliseconds deadline{};
+		std::chrono::steady_clock::time_point queued_time;
+
+		// the cancellation of the log when the job was queued, cancelling or queueing the log again makes the job stale
+		std::stop_source cancellation;
+
+		// called with the current cancellation of the log while holding its mutex
+		bool is_current(const std::stop_source& current_cancellation) const { return cancellation == current_cancellation && !cancellation.stop_requested(); }
+	};
+
 	std::condition_variable_any parser_cv;
 	std::mutex parser_queue_mutex;
-	std::queue<std::shared_ptr<Log>> parser_queue;
+	std::deque<ParserJob> parser_queue;
 	std::thread parser_thread;
 
+	// the job Elite Insights currently runs for and when it is expected to finish, guarded by parser_queue_mutex
+	std::shared_ptr<Log> running_log;
+	std::chrono::steady_clock::time_point running_expected_end;
+
+	// walking the queue in the order it is worked off is quadratic, the result is kept until the queue or the running job change and reset then, guarded by parser_queue_mutex
+	std::shared_ptr<const std::unordered_map<std::shared_ptr<Log>, std::chrono::milliseconds>> eta_offsets;
+
+	// the order changes without the queue changing once a job waited too long
+	std::chrono::steady_clock::time_point eta_offsets_expiry;
+
+	// checks for Elite Insights updates while the installed version keeps parsing
+	std::condition_variable_any updater_cv;
+	std::mutex updater_mutex;
+	std::thread updater_thread;
+
+	// opens existing reports without waiting for Elite Insights, decompressing one takes too long for the render thread
+	std::condition_variable_any opener_cv;
+	std::mutex opener_queue_mutex;
+	std::deque<std::shared_ptr<Log>> opener_queue;
+	std::thread opener_thread;
+
 	void clear_parser_queue()
 	{
 		std::unique_lock lock(this->parser_queue_mutex);
-		while (!this->parser_queue.empty())
-			this->parser_queue.pop();
+		this->parser_queue.clear();
+		this->eta_offsets.reset();
+		addon::statistics->set_queue_depth(PipelineQueue::PARSER, 0);
 	}
 
 	EliteInsights elite_insights;
 
 	std::atomic<bool> loaded = false;
 
+	// requested by release, terminates a running Elite Insights process and aborts its installation
+	std::stop_source stop_source;
+
+	void run_updater();
+	void run_opener();
+
+	// the browser read a temporary copy long before this, copies are removed once they are older
+	static void remove_stale_report_copies(std::chrono::minutes max_age);
+
+	// json only unless the html report is needed right away, by Wingman or the settings
+	ParseMode get_parse_mode(std::shared_ptr<Log> log);
+
+	// fills in the cost estimates of the job, callers hold the mutex of its log
+	static void estimate_job(ParserJob& job);
+
+	// FIFO while the queue is short, shortest job first once it is deep
+	static size_t get_next_job_index(const std::deque<ParserJob>& queue, std::chrono::steady_clock::time_point now);
+
+	// callers hold parser_queue_mutex
+	void update_eta_offsets(std::chrono::steady_clock::time_point now);
+
+	// drops the queued jobs of a cancelled log so they no longer count towards the queue depth and the etas, callers hold the mutex of the log
+	void remove_queued_jobs(const std::shared_ptr<Log>& log);
+
+	void process_parse_job(const ParserJob& job);
+	void process_report_job(const ParserJob& job);
+
 	void run();
 };
 
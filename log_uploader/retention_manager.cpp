@@ -0,0 +1,284 @@
+#include "retention_manager.h"
+#include "addon.h"
+#include "log_manager.h"
+#include "settings.h"
+#include "tracing.h"
+
+#include <algorithm>
+#include <vector>
+
+IMPLEMENT_MODULE(RetentionManager, retention_manager)
+
+#define OUTPUT_DIRECTORY "log-data" // written by Elite Insights, see elite_insights.cpp
+#define ENFORCE_INTERVAL std::chrono::minutes(10)
+
+namespace
+{
+// reports are still needed while the log is being parsed or uploaded, and until Wingman, their only consumer, has it
+bool is_evictable(const Log& log)
+{
+	if (log.parser_data.status == ParseStatus::QUEUED || log.parser_data.status == ParseStatus::PARSING || log.parser_data.report_queued)
+		return false;
+
+	if (log.dps_report_upload.status == UploadStatus::QUEUED || log.dps_report_upload.status == UploadStatus::UPLOADING)
+		return false;
+
+	return log.wingman_upload.status == UploadStatus::UPLOADED || log.wingman_upload.status == UploadStatus::SKIPPED;
+}
+
+std::array<std::filesystem::path*, 4> get_report_paths(Log& log)
+{
+	auto& parser_data = log.parser_data;
+	return { &parser_data.json_file_path, &parser_data.html_file_path, &parser_data.compressed_json_file_path, &parser_data.compressed_html_file_path };
+}
+} // namespace
+
+void RetentionManager::initialize()
+{
+	directory = addon::directory / OUTPUT_DIRECTORY;
+
+	initialized.store(true);
+
+	retention_thread = std::thread(&RetentionManager::run, this);
+}
+
+void RetentionManager::release()
+{
+	{
+		std::lock_guard lock(entries_mutex);
+		initialized.store(false);
+	}
+
+	retention_cv.notify_all();
+
+	if (retention_thread.joinable())
+		retention_thread.join();
+
+	std::lock_guard lock(entries_mutex);
+	entries.clear();
+	total_size = 0;
+	indexed = false;
+}
+
+void RetentionManager::touch_log(std::shared_ptr<Log> log)
+{
+	std::vector<std::filesystem::path> file_paths;
+
+	{
+		std::shared_lock log_lock(log->mutex);
+
+		for (auto file_path : get_report_paths(*log))
+			if (!file_path->empty())
+				file_paths.push_back(*file_path);
+	}
+
+	auto now = std::chrono::system_clock::now();
+
+	{
+		std::lock_guard lock(entries_mutex);
+
+		for (const auto& file_path : file_paths)
+		{
+			std::error_code ec;
+			auto size = std::filesystem::file_size(file_path, ec);
+
+			if (ec)
+				continue;
+
+			auto& entry = entries[file_path];
+			total_size += size - entry.size;
+			entry.size = size;
+			entry.last_used = now;
+		}
+
+		enforce_requested = true;
+	}
+
+	retention_cv.notify_one();
+}
+
+void RetentionManager::forget(const std::filesystem::path& file_path)
+{
+	std::lock_guard lock(entries_mutex);
+
+	if (auto it = entries.find(file_path); it != entries.end())
+	{
+		total_size -= it->second.size;
+		entries.erase(it);
+	}
+}
+
+void RetentionManager::enforce()
+{
+	{
+		std::lock_guard lock(entries_mutex);
+		enforce_requested = true;
+	}
+
+	retention_cv.notify_one();
+}
+
+DiskUsage RetentionManager::get_disk_usage()
+{
+	std::lock_guard lock(entries_mutex);
+	return { total_size, entries.size(), indexed };
+}
+
+void RetentionManager::run()
+{
+	TRACE_THREAD("Retention");
+
+	index_directory();
+
+	while (true)
+	{
+		std::unique_lock lock(entries_mutex);
+
+		retention_cv.wait_for(lock, ENFORCE_INTERVAL, [this] { return enforce_requested || !initialized.load(); });
+
+		if (!initialized.load())
+			break;
+
+		enforce_requested = false;
+
+		lock.unlock();
+
+		try
+		{
+			evict();
+		}
+		catch (const std::exception& e)
+		{
+			addon::log("Failed to apply report retention. Exception: " + std::string(e.what()), LOGLEVEL_WARNING);
+		}
+	}
+}
+
+void RetentionManager::index_directory()
+{
+	TRACE_SCOPE("RetentionManager::index_directory");
+
+	std::unordered_map<std::filesystem::path, Entry> scanned_entries;
+
+	std::error_code ec;
+
+	for (auto it = std::filesystem::recursive_directory_iterator(directory, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (!it->is_regular_file(ec))
+			continue;
+
+		Entry entry;
+		entry.size = it->file_size(ec);
+		entry.last_used = std::chrono::clock_cast<std::chrono::system_clock>(it->last_write_time(ec));
+
+		if (!ec)
+			scanned_entries.emplace(it->path(), entry);
+	}
+
+	std::lock_guard lock(entries_mutex);
+
+	// reports touched while the scan was running are already up to date
+	for (auto& [file_path, entry] : scanned_entries)
+		if (entries.emplace(file_path, entry).second)
+			total_size += entry.size;
+
+	indexed = true;
+	enforce_requested = true;
+
+	addon::log(LOGLEVEL_DEBUG, "Indexed {} reports, {} MiB", entries.size(), total_size / (1024 * 1024));
+}
+
+void RetentionManager::evict()
+{
+	TRACE_SCOPE("RetentionManager::evict");
+
+	auto [max_size_mb, max_age_days] = addon::settings->read([](const SettingsData& settings) { return std::pair(settings.parser.retention_max_size_mb, settings.parser.retention_max_age_days); });
+
+	auto max_size = max_size_mb > 0 ? static_cast<uint64_t>(max_size_mb) * 1024 * 1024 : UINT64_MAX;
+	auto min_last_used = max_age_days > 0 ? std::chrono::system_clock::now() - std::chrono::days(max_age_days) : std::chrono::system_clock::time_point::min();
+
+	std::vector<std::pair<std::filesystem::path, Entry>> candidates;
+	uint64_t size = 0;
+
+	{
+		std::lock_guard lock(entries_mutex);
+
+		size = total_size;
+		candidates.assign(entries.begin(), entries.end());
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+
+	if (candidates.empty() || (size <= max_size && candidates.front().second.last_used >= min_last_used))
+		return;
+
+	// reports of logs in the list are only removed once the log no longer needs them, reports of other logs are left over from previous sessions
+	std::unordered_map<std::filesystem::path, std::shared_ptr<Log>> owners;
+
+	{
+		std::shared_lock logs_lock(addon::log_manager->logs_mutex);
+
+		for (const auto& log : addon::log_manager->logs)
+		{
+			std::shared_lock log_lock(log->mutex);
+
+			for (auto file_path : get_report_paths(*log))
+				if (!file_path->empty())
+					owners.emplace(*file_path, log);
+		}
+	}
+
+	size_t removed_files = 0;
+	uint64_t removed_bytes = 0;
+
+	for (const auto& [file_path, entry] : candidates)
+	{
+		// candidates are sorted by last use, once the size fits all remaining ones are within the age budget too
+		if (size <= max_size && entry.last_used >= min_last_used)
+			break;
+
+		if (auto it = owners.find(file_path); it != owners.end())
+		{
+			auto& log = it->second;
+
+			std::unique_lock log_lock(log->mutex);
+
+			if (!is_evictable(*log))
+				continue;
+
+			for (auto report_path : get_report_paths(*log))
+				if (*report_path == file_path)
+					report_path->clear();
+
+			log->update_view();
+		}
+
+		std::error_code ec;
+		auto file_size = std::filesystem::file_size(file_path, ec);
+		if (ec)
+			file_size = 0;
+
+		auto removed = std::filesystem::remove(file_path, ec);
+
+		if (ec && std::filesystem::exists(file_path, ec))
+			continue;
+
+		forget(file_path);
+
+		// the index total, it also drops by the indexed size of reports that were already gone
+		{
+			std::lock_guard lock(entries_mutex);
+			size = total_size;
+		}
+
+		// a report already deleted elsewhere only leaves the index, it frees nothing
+		if (!removed)
+			continue;
+
+		removed_bytes += file_size;
+		++removed_files;
+	}
+
+	if (removed_files > 0)
+		addon::log(LOGLEVEL_DEBUG, "Removed {} reports, {} MiB", removed_files, removed_bytes / (1024 * 1024));
+}
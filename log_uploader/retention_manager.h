@@ -0,0 +1,68 @@
+#pragma once
+
+#include "log.h"
+#include "module.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+struct DiskUsage
+{
+	uint64_t bytes = 0;
+	size_t files = 0;
+
+	// false until the output directory was scanned once after loading
+	bool indexed = false;
+};
+
+// keeps the Elite Insights output directory within the size and age budgets of the parser settings. the directory is scanned once on load, after that the index is kept up to date as reports are written and removed
+class RetentionManager
+{
+public:
+	void initialize();
+	void release();
+
+	// adds the reports of the log to the index, or marks them as recently used if they already are
+	void touch_log(std::shared_ptr<Log> log);
+
+	// removes a report deleted elsewhere from the index, it no longer counts towards the budgets
+	void forget(const std::filesystem::path& file_path);
+
+	// wakes the retention thread to apply the budgets, e.g. after they were changed
+	void enforce();
+
+	DiskUsage get_disk_usage();
+
+private:
+	struct Entry
+	{
+		uint64_t size = 0;
+		std::chrono::system_clock::time_point last_used;
+	};
+
+	std::filesystem::path directory;
+
+	// guards entries, total_size, indexed and enforce_requested
+	std::mutex entries_mutex;
+	std::unordered_map<std::filesystem::path, Entry> entries;
+	uint64_t total_size = 0;
+	bool indexed = false;
+	bool enforce_requested = false;
+
+	std::condition_variable retention_cv;
+	std::atomic<bool> initialized = false;
+	std::thread retention_thread;
+
+	void run();
+	void index_directory();
+
+	// removes the least recently used reports until the budgets are met, reports of logs that may still be uploaded to Wingman are kept
+	void evict();
+};
+
+DECLARE_MODULE(RetentionManager, retention_manager)
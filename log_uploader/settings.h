@@ -6,6 +6,8 @@
 #include <imgui.h>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <mutex>
 #include <shared_mutex>
 
 inline void to_json(nlohmann::json& j, const ImVec2& v) { j = nlohmann::json{ { "x", v.x }, { "y", v.y } }; }
@@ -38,8 +40,25 @@ enum class WindowAlignment
 
 using EncounterSelection = std::vector<TriggerID>;
 
+// whether logs of the encounter pass an auto upload encounter filter
+inline bool is_encounter_selected(const EncounterSelection& selection, TriggerID trigger_id) { return std::find(selection.begin(), selection.end(), trigger_id) != selection.end(); }
+
 struct SettingsData
 {
+	struct General
+	{
+		int upload_rate_limit = 0; // KiB/s shared by all uploads, 0 = unlimited
+
+		bool compress_evtc_uploads = true; // deflate raw .evtc files into a temporary .zevtc before uploading
+
+		std::string squad_share_directory = ""; // utf8, folder shared with the squad to skip duplicate dps.report uploads, empty = disabled
+
+		int log_level = 5; // LogLevel of the most detailed messages passed to Nexus, which filters them by its own level as well, 5 = trace
+
+		NLOHMANN_DEFINE_TYPE_INTRUSIVE(General, upload_rate_limit, compress_evtc_uploads, squad_share_directory, log_level)
+
+	} general;
+
 	struct DPSReport
 	{
 		bool auto_upload = false;
@@ -47,26 +66,35 @@ struct SettingsData
 
 		std::string user_token = "";
 
+		// allows pointing the uploader at a local stand-in of the service, see tools/upload_stand_in.py
+		std::string server_url = "https://dps.report";
+
 		bool anonymize = false;
 		bool detailed_wvw = false;
 
+		int concurrent_uploads = 2;
+
 		AutoUploadFilter auto_upload_filter = AutoUploadFilter::NONE;
 
 		EncounterSelection auto_upload_encounters;
 
-		NLOHMANN_DEFINE_TYPE_INTRUSIVE(DPSReport, auto_upload, auto_upload_copy_url_to_clipboard, user_token, anonymize, detailed_wvw, auto_upload_filter, auto_upload_encounters)
+		NLOHMANN_DEFINE_TYPE_INTRUSIVE(DPSReport, auto_upload, auto_upload_copy_url_to_clipboard, user_token, server_url, anonymize, detailed_wvw, concurrent_uploads, auto_upload_filter, auto_upload_encounters)
 
 	} dps_report;
 
 	struct Wingman
 	{
 		bool auto_upload = false;
+		bool compress_uploads = false;
+
+		// allows pointing the uploader at a local stand-in of the service, see tools/upload_stand_in.py
+		std::string server_url = "https://gw2wingman.nevermindcreations.de";
 
 		AutoUploadFilter auto_upload_filter = AutoUploadFilter::NONE;
 
 		EncounterSelection auto_upload_encounters;
 
-		NLOHMANN_DEFINE_TYPE_INTRUSIVE(Wingman, auto_upload, auto_upload_filter, auto_upload_encounters)
+		NLOHMANN_DEFINE_TYPE_INTRUSIVE(Wingman, auto_upload, compress_uploads, server_url, auto_upload_filter, auto_upload_encounters)
 
 	} wingman;
 
@@ -78,7 +106,14 @@ struct SettingsData
 
 		bool auto_parse = true;
 
-		NLOHMANN_DEFINE_TYPE_INTRUSIVE(Parser, auto_update, update_channel, auto_parse)
+		bool compress_reports = true; // keep the Elite Insights reports gzip compressed on disk
+
+		bool always_generate_html = false; // otherwise the html report is only generated for Wingman uploads and when it is opened
+
+		int retention_max_size_mb = 1024; // total size of the Elite Insights reports kept on disk, 0 = unlimited
+		int retention_max_age_days = 30; // 0 = unlimited
+
+		NLOHMANN_DEFINE_TYPE_INTRUSIVE(Parser, auto_update, update_channel, auto_parse, compress_reports, always_generate_html, retention_max_size_mb, retention_max_age_days)
 
 	} parser;
 
@@ -99,19 +134,20 @@ struct SettingsData
 			bool background = true;
 
 			bool parser_column = true;
+			bool eta_column = true;
 			bool dps_report_column = true;
 			bool wingman_column = true;
 
 			bool hide_in_combat = false;
 
-			NLOHMANN_DEFINE_TYPE_INTRUSIVE(LogTable, fixed_size, fixed_position, clip_to_screen, alternate_row_backgrounds, alignment, position, size, title_bar, background, parser_column, dps_report_column, wingman_column, hide_in_combat)
+			NLOHMANN_DEFINE_TYPE_INTRUSIVE(LogTable, fixed_size, fixed_position, clip_to_screen, alternate_row_backgrounds, alignment, position, size, title_bar, background, parser_column, eta_column, dps_report_column, wingman_column, hide_in_combat)
 
 		} log_table;
 
 		NLOHMANN_DEFINE_TYPE_INTRUSIVE(Display, log_table)
 	} display;
 
-	NLOHMANN_DEFINE_TYPE_INTRUSIVE(SettingsData, dps_report, wingman, parser, display)
+	NLOHMANN_DEFINE_TYPE_INTRUSIVE(SettingsData, general, dps_report, wingman, parser, display)
 };
 
 class Settings
@@ -0,0 +1,292 @@
+#include "statistics.h"
+#include "addon.h"
+
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#include <psapi.h>
+#endif
+
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+IMPLEMENT_MODULE(Statistics, statistics)
+
+#define STATISTICS_FILE "statistics.json"
+
+const std::array<Statistics::IntervalDefinition, static_cast<size_t>(PipelineInterval::COUNT)> Statistics::interval_definitions = { {
+	{ "Detected to file ready", PipelineStage::DETECTED, PipelineStage::FILE_READY },
+	{ "File ready to header parsed", PipelineStage::FILE_READY, PipelineStage::HEADER_PARSED },
+	{ "Parser queue", PipelineStage::PARSE_QUEUED, PipelineStage::ELITE_INSIGHTS_STARTED },
+	{ "Elite Insights", PipelineStage::ELITE_INSIGHTS_STARTED, PipelineStage::ELITE_INSIGHTS_FINISHED },
+	{ "Json extraction", PipelineStage::ELITE_INSIGHTS_FINISHED, PipelineStage::JSON_EXTRACTED },
+	{ "dps.report queue", PipelineStage::DPS_REPORT_QUEUED, PipelineStage::DPS_REPORT_STARTED },
+	{ "dps.report upload", PipelineStage::DPS_REPORT_STARTED, PipelineStage::DPS_REPORT_FINISHED },
+	{ "Detected to dps.report url", PipelineStage::DETECTED, PipelineStage::DPS_REPORT_FINISHED },
+	{ "Wingman queue", PipelineStage::WINGMAN_QUEUED, PipelineStage::WINGMAN_STARTED },
+	{ "Wingman upload", PipelineStage::WINGMAN_STARTED, PipelineStage::WINGMAN_FINISHED },
+	{ "Detected to Wingman upload", PipelineStage::DETECTED, PipelineStage::WINGMAN_FINISHED },
+} };
+
+const std::array<const char*, static_cast<size_t>(PipelineQueue::COUNT)> Statistics::queue_names = {
+	"Parser",
+	"Compressor",
+	"dps.report",
+	"Wingman check",
+	"Wingman",
+};
+
+size_t Histogram::get_bucket_index(uint64_t value)
+{
+	// values below two sub-bucket ranges map to themselves, above that each power of two is split into sub_bucket_count buckets
+	if (value < 2 * sub_bucket_count)
+		return static_cast<size_t>(value);
+
+	auto shift = static_cast<size_t>(std::bit_width(value) - std::bit_width(sub_bucket_count));
+	auto index = shift * sub_bucket_count + static_cast<size_t>(value >> shift);
+
+	return std::min(index, bucket_count - 1);
+}
+
+uint64_t Histogram::get_bucket_upper_bound(size_t index)
+{
+	if (index < 2 * sub_bucket_count)
+		return index;
+
+	auto shift = index / sub_bucket_count - 1;
+	auto top = index % sub_bucket_count + sub_bucket_count;
+
+	return ((top + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+	counts[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(value, std::memory_order_relaxed);
+
+	auto current_max = max.load(std::memory_order_relaxed);
+	while (value > current_max && !max.compare_exchange_weak(current_max, value, std::memory_order_relaxed))
+	{
+	}
+}
+
+void Histogram::reset()
+{
+	for (auto& bucket : counts)
+		bucket.store(0, std::memory_order_relaxed);
+
+	count.store(0, std::memory_order_relaxed);
+	sum.store(0, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
+
+double Histogram::get_mean() const
+{
+	auto total = get_count();
+	return total ? static_cast<double>(sum.load(std::memory_order_relaxed)) / total : 0.0;
+}
+
+uint64_t Histogram::get_percentile(double percentile) const
+{
+	// buckets are read one by one while recording continues, the result is approximate by design
+	uint64_t total = 0;
+
+	for (const auto& bucket : counts)
+		total += bucket.load(std::memory_order_relaxed);
+
+	if (total == 0)
+		return 0;
+
+	auto target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * total));
+	uint64_t seen = 0;
+
+	for (size_t i = 0; i < bucket_count; ++i)
+	{
+		seen += counts[i].load(std::memory_order_relaxed);
+
+		if (seen >= std::max<uint64_t>(target, 1))
+			return std::min(get_bucket_upper_bound(i), get_max());
+	}
+
+	return get_max();
+}
+
+void QueueDepth::set(size_t depth)
+{
+	current.store(depth, std::memory_order_relaxed);
+
+	auto peak_depth = peak.load(std::memory_order_relaxed);
+	while (depth > peak_depth && !peak.compare_exchange_weak(peak_depth, depth, std::memory_order_relaxed))
+	{
+	}
+}
+
+void ParseResourceTotals::add(const ParseResourceUsage& usage)
+{
+	++count;
+	wall_time += usage.wall_time;
+	cpu_time += usage.get_cpu_time();
+	max_wall_time = std::max(max_wall_time, usage.wall_time);
+	max_peak_working_set = std::max(max_peak_working_set, usage.peak_working_set);
+	read_bytes += usage.read_bytes;
+	write_bytes += usage.write_bytes;
+}
+
+void Statistics::record_stage(PipelineTimes& times, PipelineStage stage, std::chrono::steady_clock::time_point time)
+{
+	times[stage] = time;
+
+	for (size_t i = 0; i < interval_definitions.size(); ++i)
+	{
+		const auto& definition = interval_definitions[i];
+
+		if (definition.to != stage || !times[definition.from].has_value())
+			continue;
+
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(time - times[definition.from].value()).count();
+
+		if (duration >= 0)
+			histograms[i].record(static_cast<uint64_t>(duration));
+	}
+}
+
+std::chrono::steady_clock::duration Statistics::get_elapsed() const
+{
+	return std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(reset_time.load(std::memory_order_relaxed));
+}
+
+double Statistics::get_rate_per_minute(PipelineInterval interval) const
+{
+	auto minutes = std::chrono::duration<double, std::ratio<60>>(get_elapsed()).count();
+
+	return minutes > 0.0 ? get_histogram(interval).get_count() / minutes : 0.0;
+}
+
+MemoryUsage Statistics::get_memory_usage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS_EX counters{};
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters)))
+		return {};
+
+	return { counters.WorkingSetSize, counters.PeakWorkingSetSize, counters.PrivateUsage };
+#else
+	// resident set and its peak, private bytes are the anonymous pages whether resident or swapped out
+	std::ifstream status_file("/proc/self/status");
+	std::string line;
+	MemoryUsage usage;
+
+	while (std::getline(status_file, line))
+	{
+		std::istringstream fields(line);
+		std::string name;
+		uint64_t kilobytes = 0;
+
+		if (!(fields >> name >> kilobytes))
+			continue;
+
+		if (name == "VmRSS:")
+			usage.working_set = kilobytes * 1024;
+		else if (name == "VmHWM:")
+			usage.peak_working_set = kilobytes * 1024;
+		else if (name == "RssAnon:" || name == "VmSwap:")
+			usage.private_bytes += kilobytes * 1024;
+	}
+
+	return usage;
+#endif
+}
+
+void Statistics::record_parse_resources(TriggerID trigger_id, const ParseResourceUsage& usage, bool parsed, const std::string& encounter_name)
+{
+	std::lock_guard lock(parse_resources_mutex);
+
+	auto& totals = parse_resources[trigger_id];
+
+	totals.add(usage);
+
+	if (!parsed)
+		++totals.failed;
+	else if (!encounter_name.empty())
+		totals.name = encounter_name;
+}
+
+std::map<TriggerID, ParseResourceTotals> Statistics::get_parse_resources()
+{
+	std::lock_guard lock(parse_resources_mutex);
+	return parse_resources;
+}
+
+void Statistics::reset()
+{
+	for (auto& histogram : histograms)
+		histogram.reset();
+
+	for (auto& queue_depth : queue_depths)
+		queue_depth.reset();
+
+	{
+		std::lock_guard lock(parse_resources_mutex);
+		parse_resources.clear();
+	}
+
+	reset_time.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+std::filesystem::path Statistics::export_to_file()
+{
+	nlohmann::json intervals = nlohmann::json::array();
+
+	for (size_t i = 0; i < histograms.size(); ++i)
+	{
+		const auto& histogram = histograms[i];
+
+		nlohmann::json buckets = nlohmann::json::array();
+
+		for (size_t j = 0; j < Histogram::bucket_count; ++j)
+			if (auto value = histogram.counts[j].load(std::memory_order_relaxed); value > 0)
+				buckets.push_back({ { "upper_bound_ms", Histogram::get_bucket_upper_bound(j) }, { "count", value } });
+
+		intervals.push_back({ { "name", interval_definitions[i].name }, { "count", histogram.get_count() }, { "per_minute", get_rate_per_minute(static_cast<PipelineInterval>(i)) },
+			{ "mean_ms", histogram.get_mean() }, { "p50_ms", histogram.get_percentile(50) }, { "p90_ms", histogram.get_percentile(90) }, { "p99_ms", histogram.get_percentile(99) },
+			{ "max_ms", histogram.get_max() }, { "buckets", buckets } });
+	}
+
+	nlohmann::json queues = nlohmann::json::array();
+
+	for (size_t i = 0; i < queue_depths.size(); ++i)
+		queues.push_back({ { "name", queue_names[i] }, { "depth", queue_depths[i].get_current() }, { "peak_depth", queue_depths[i].get_peak() } });
+
+	nlohmann::json parse_resources_json = nlohmann::json::array();
+
+	for (const auto& [trigger_id, totals] : get_parse_resources())
+		parse_resources_json.push_back({ { "trigger_id", static_cast<uint32_t>(trigger_id) }, { "name", totals.name }, { "count", totals.count }, { "failed", totals.failed },
+			{ "wall_ms", totals.wall_time.count() }, { "cpu_ms", totals.cpu_time.count() }, { "max_wall_ms", totals.max_wall_time.count() },
+			{ "max_peak_working_set", totals.max_peak_working_set }, { "read_bytes", totals.read_bytes }, { "write_bytes", totals.write_bytes } });
+
+	auto memory_usage = get_memory_usage();
+
+	nlohmann::json memory = { { "working_set", memory_usage.working_set }, { "peak_working_set", memory_usage.peak_working_set }, { "private_bytes", memory_usage.private_bytes } };
+
+	auto time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(get_elapsed()).count();
+
+	nlohmann::json json = { { "version", ADDON_VERSION_STRING }, { "time", time }, { "elapsed_s", elapsed }, { "intervals", intervals }, { "queues", queues }, { "parse_resources", parse_resources_json },
+		{ "memory", memory } };
+
+	auto file_path = addon::directory / STATISTICS_FILE;
+
+	std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to create file: " + file_path.string());
+
+	file << json.dump(2);
+
+	return file_path;
+}
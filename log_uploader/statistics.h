@@ -0,0 +1,163 @@
+#pragma once
+
+#include "log.h"
+#include "module.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// log-linear histogram of millisecond durations with 16 sub-buckets per power of two (about 6% precision), recording is lock-free
+class Histogram
+{
+public:
+	static constexpr size_t sub_bucket_count = 16;
+	static constexpr size_t bucket_count = 64 * sub_bucket_count;
+
+	void record(uint64_t value);
+	void reset();
+
+	uint64_t get_count() const { return count.load(std::memory_order_relaxed); }
+	uint64_t get_max() const { return max.load(std::memory_order_relaxed); }
+	double get_mean() const;
+
+	// upper bound of the bucket holding the percentile, 0 if nothing was recorded
+	uint64_t get_percentile(double percentile) const;
+
+	static size_t get_bucket_index(uint64_t value);
+	static uint64_t get_bucket_upper_bound(size_t index);
+
+	std::array<std::atomic<uint64_t>, bucket_count> counts{};
+
+private:
+	std::atomic<uint64_t> count = 0;
+	std::atomic<uint64_t> sum = 0;
+	std::atomic<uint64_t> max = 0;
+};
+
+enum class PipelineInterval
+{
+	FILE_READY,
+	HEADER_PARSED,
+	PARSE_QUEUE,
+	ELITE_INSIGHTS,
+	JSON_EXTRACTION,
+	DPS_REPORT_QUEUE,
+	DPS_REPORT_UPLOAD,
+	DPS_REPORT_TOTAL,
+	WINGMAN_QUEUE,
+	WINGMAN_UPLOAD,
+	WINGMAN_TOTAL,
+	COUNT
+};
+
+enum class PipelineQueue
+{
+	PARSER,
+	ARTIFACT_COMPRESSOR,
+	DPS_REPORT,
+	WINGMAN_PRECHECK,
+	WINGMAN,
+	COUNT
+};
+
+// number of logs waiting in a queue and the highest number since the last reset
+class QueueDepth
+{
+public:
+	void set(size_t depth);
+	void reset() { peak.store(current.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+	size_t get_current() const { return current.load(std::memory_order_relaxed); }
+	size_t get_peak() const { return peak.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<size_t> current = 0;
+	std::atomic<size_t> peak = 0;
+};
+
+struct MemoryUsage
+{
+	uint64_t working_set = 0;
+	uint64_t peak_working_set = 0;
+	uint64_t private_bytes = 0;
+};
+
+// Elite Insights runs of an encounter since the last reset, failed and cancelled runs included
+class ParseResourceTotals
+{
+public:
+	// fight name reported by Elite Insights, empty until a run of the encounter succeeded
+	std::string name;
+
+	uint64_t count = 0;
+	uint64_t failed = 0;
+
+	std::chrono::milliseconds wall_time{};
+	std::chrono::milliseconds cpu_time{};
+	std::chrono::milliseconds max_wall_time{};
+	uint64_t max_peak_working_set = 0;
+	uint64_t read_bytes = 0;
+	uint64_t write_bytes = 0;
+
+	void add(const ParseResourceUsage& usage);
+
+	double get_cores() const { return wall_time.count() > 0 ? static_cast<double>(cpu_time.count()) / wall_time.count() : 0.0; }
+};
+
+class Statistics
+{
+public:
+	struct IntervalDefinition
+	{
+		const char* name;
+		PipelineStage from;
+		PipelineStage to;
+	};
+
+	static const std::array<IntervalDefinition, static_cast<size_t>(PipelineInterval::COUNT)> interval_definitions;
+	static const std::array<const char*, static_cast<size_t>(PipelineQueue::COUNT)> queue_names;
+
+	// records the stage and adds the intervals ending at it to the histograms, callers hold the mutex of the log the times belong to
+	void record_stage(PipelineTimes& times, PipelineStage stage, std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now());
+
+	const Histogram& get_histogram(PipelineInterval interval) const { return histograms[static_cast<size_t>(interval)]; }
+
+	// called by the owner of the queue whenever its size changes, while holding the queue lock
+	void set_queue_depth(PipelineQueue queue, size_t depth) { queue_depths[static_cast<size_t>(queue)].set(depth); }
+
+	const QueueDepth& get_queue_depth(PipelineQueue queue) const { return queue_depths[static_cast<size_t>(queue)]; }
+
+	// intervals completed per minute since the last reset, the sustained throughput of the stage the interval ends at
+	double get_rate_per_minute(PipelineInterval interval) const;
+
+	std::chrono::steady_clock::duration get_elapsed() const;
+
+	static MemoryUsage get_memory_usage();
+
+	// called once per Elite Insights run that got as far as starting the process
+	void record_parse_resources(TriggerID trigger_id, const ParseResourceUsage& usage, bool parsed, const std::string& encounter_name);
+
+	std::map<TriggerID, ParseResourceTotals> get_parse_resources();
+
+	void reset();
+
+	// writes the percentiles and non-empty buckets of all histograms as json, returns the file written
+	std::filesystem::path export_to_file();
+
+private:
+	std::array<Histogram, static_cast<size_t>(PipelineInterval::COUNT)> histograms;
+	std::array<QueueDepth, static_cast<size_t>(PipelineQueue::COUNT)> queue_depths;
+
+	std::mutex parse_resources_mutex;
+	std::map<TriggerID, ParseResourceTotals> parse_resources;
+
+	std::atomic<std::chrono::steady_clock::rep> reset_time = std::chrono::steady_clock::now().time_since_epoch().count();
+};
+
+DECLARE_MODULE(Statistics, statistics)
@@ -0,0 +1,226 @@
+#ifdef _WIN32
+
+#include "subprocess.h"
+
+#include <psapi.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+std::chrono::milliseconds to_milliseconds(const FILETIME& file_time)
+{
+	// FILETIME durations count 100 nanosecond intervals
+	auto ticks = (static_cast<uint64_t>(file_time.dwHighDateTime) << 32) | file_time.dwLowDateTime;
+	return std::chrono::milliseconds(ticks / 10000);
+}
+
+std::chrono::milliseconds to_milliseconds(const LARGE_INTEGER& time) { return std::chrono::milliseconds(static_cast<uint64_t>(time.QuadPart) / 10000); }
+} // namespace
+
+Subprocess::Subprocess(const std::filesystem::path& executable_file, const std::vector<std::wstring>& arguments)
+{
+	SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, TRUE };
+	HANDLE write_pipe = nullptr;
+
+	if (!CreatePipe(&read_pipe, &write_pipe, &sa, 0))
+		throw std::runtime_error("Failed to create read/write pipe");
+
+	// only the write end is meant for the child, an inherited read end would be held open by it
+	SetHandleInformation(read_pipe, HANDLE_FLAG_INHERIT, 0);
+
+	cancel_event = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+	if (!cancel_event)
+	{
+		CloseHandle(read_pipe);
+		CloseHandle(write_pipe);
+		throw std::runtime_error("Failed to create cancel event");
+	}
+
+	STARTUPINFOW si = {};
+	PROCESS_INFORMATION pi = {};
+	si.cb = sizeof(si);
+	si.dwFlags |= STARTF_USESTDHANDLES;
+	si.hStdOutput = write_pipe;
+	si.hStdError = write_pipe;
+
+	auto command = L"\"" + executable_file.wstring() + L"\"";
+
+	for (const auto& argument : arguments)
+		command += L" \"" + argument + L"\"";
+
+	std::vector<wchar_t> command_buffer(command.begin(), command.end());
+	command_buffer.push_back(L'\0');
+
+	job_handle = CreateJobObjectW(NULL, NULL);
+
+	if (job_handle)
+	{
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+		limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+		SetInformationJobObject(job_handle, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+	}
+
+	start_time = std::chrono::steady_clock::now();
+
+	// started suspended so it is in the job before it can start processes of its own
+	auto created = CreateProcessW(NULL, command_buffer.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si, &pi);
+
+	// the child holds its own copy, the pipe reports the end of the output once the child closed it
+	CloseHandle(write_pipe);
+
+	if (!created)
+	{
+		CloseHandle(read_pipe);
+		CloseHandle(cancel_event);
+		if (job_handle)
+			CloseHandle(job_handle);
+		throw std::runtime_error("Failed to start " + executable_file.filename().string());
+	}
+
+	if (job_handle && !AssignProcessToJobObject(job_handle, pi.hProcess))
+	{
+		CloseHandle(job_handle);
+		job_handle = nullptr;
+	}
+
+	ResumeThread(pi.hThread);
+	CloseHandle(pi.hThread);
+
+	process_handle = pi.hProcess;
+	process_id = pi.dwProcessId;
+}
+
+Subprocess::~Subprocess()
+{
+	if (process_handle)
+	{
+		if (WaitForSingleObject(process_handle, 0) == WAIT_TIMEOUT)
+			terminate();
+
+		CloseHandle(process_handle);
+	}
+
+	// kills whatever the child left running
+	if (job_handle)
+		CloseHandle(job_handle);
+
+	if (read_pipe)
+		CloseHandle(read_pipe);
+
+	if (cancel_event)
+		CloseHandle(cancel_event);
+}
+
+SubprocessResult Subprocess::wait(std::chrono::steady_clock::time_point deadline, const OutputCallback& on_output)
+{
+	SubprocessResult result;
+
+	std::thread reader_thread([this, &on_output]() {
+		CHAR buffer[4096];
+		DWORD bytes_read;
+
+		while (ReadFile(read_pipe, buffer, sizeof(buffer), &bytes_read, NULL) && bytes_read > 0)
+			on_output(std::string_view(buffer, bytes_read));
+	});
+
+	HANDLE handles[] = { process_handle, cancel_event };
+
+	auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+	auto wait_result = WaitForMultipleObjects(2, handles, FALSE, static_cast<DWORD>(std::clamp<long long>(remaining, 0, INFINITE - 1)));
+
+	// the process may still be running, it is terminated instead of reading an exit code it does not have yet
+	if (wait_result == WAIT_FAILED)
+	{
+		auto error = GetLastError();
+
+		terminate();
+		WaitForSingleObject(process_handle, 1000);
+
+		if (WaitForSingleObject(reader_thread.native_handle(), 1000) == WAIT_TIMEOUT)
+			CancelSynchronousIo(reader_thread.native_handle());
+
+		reader_thread.join();
+
+		throw std::runtime_error("Failed to wait for process " + std::to_string(process_id) + ", error " + std::to_string(error));
+	}
+
+	if (wait_result != WAIT_OBJECT_0)
+	{
+		result.timed_out = wait_result == WAIT_TIMEOUT;
+		result.cancelled = wait_result == WAIT_OBJECT_0 + 1;
+
+		terminate();
+		WaitForSingleObject(process_handle, INFINITE);
+	}
+
+	// processes started by the child may still hold the pipe open, their output is not waited for
+	if (WaitForSingleObject(reader_thread.native_handle(), 1000) == WAIT_TIMEOUT)
+		CancelSynchronousIo(reader_thread.native_handle());
+
+	reader_thread.join();
+
+	result.wall_time = std::chrono::steady_clock::now() - start_time;
+
+	DWORD exit_code = 0;
+	GetExitCodeProcess(process_handle, &exit_code);
+	result.exit_code = exit_code;
+
+	JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accounting{};
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+
+	if (job_handle && QueryInformationJobObject(job_handle, JobObjectBasicAndIoAccountingInformation, &accounting, sizeof(accounting), NULL) &&
+		QueryInformationJobObject(job_handle, JobObjectExtendedLimitInformation, &limits, sizeof(limits), NULL))
+	{
+		result.user_time = to_milliseconds(accounting.BasicInfo.TotalUserTime);
+		result.kernel_time = to_milliseconds(accounting.BasicInfo.TotalKernelTime);
+		result.read_bytes = accounting.IoInfo.ReadTransferCount;
+		result.write_bytes = accounting.IoInfo.WriteTransferCount;
+		result.peak_committed_memory = limits.PeakJobMemoryUsed;
+	}
+	else
+	{
+		FILETIME creation_time, exit_time, kernel_time, user_time;
+
+		if (GetProcessTimes(process_handle, &creation_time, &exit_time, &kernel_time, &user_time))
+		{
+			result.kernel_time = to_milliseconds(kernel_time);
+			result.user_time = to_milliseconds(user_time);
+		}
+
+		IO_COUNTERS io_counters{};
+
+		if (GetProcessIoCounters(process_handle, &io_counters))
+		{
+			result.read_bytes = io_counters.ReadTransferCount;
+			result.write_bytes = io_counters.WriteTransferCount;
+		}
+	}
+
+	PROCESS_MEMORY_COUNTERS counters{};
+
+	if (GetProcessMemoryInfo(process_handle, &counters, sizeof(counters)))
+	{
+		result.peak_working_set = counters.PeakWorkingSetSize;
+
+		if (result.peak_committed_memory == 0)
+			result.peak_committed_memory = counters.PeakPagefileUsage;
+	}
+
+	return result;
+}
+
+void Subprocess::cancel() { SetEvent(cancel_event); }
+
+void Subprocess::terminate()
+{
+	if (job_handle)
+		TerminateJobObject(job_handle, EXIT_FAILURE);
+	else
+		TerminateProcess(process_handle, EXIT_FAILURE);
+}
+
+#endif
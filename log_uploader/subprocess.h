@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <atomic>
+#include <sys/types.h>
+#endif
+
+struct SubprocessResult
+{
+	// of a child killed by a signal 128 plus the signal number, as shells report it
+	uint32_t exit_code = 0;
+	bool timed_out = false;
+	bool cancelled = false;
+
+	std::chrono::steady_clock::duration wall_time{};
+
+	// cpu time, committed memory and i/o include processes the child started, the working set is that of the child alone.
+	// outside Windows they come from wait4 and procfs and include only the processes the child waited for, committed memory is not accounted
+	std::chrono::milliseconds user_time{};
+	std::chrono::milliseconds kernel_time{};
+	uint64_t peak_working_set = 0;
+	uint64_t peak_committed_memory = 0;
+	uint64_t read_bytes = 0;
+	uint64_t write_bytes = 0;
+};
+
+// child process with stdout and stderr redirected into a single pipe that is drained while it runs, so it never blocks on a full pipe.
+// on Windows it runs in a job object that accounts for the resources of the whole process tree and terminates it along with the child,
+// elsewhere it is started with posix_spawn in a process group of its own that is terminated the same way
+class Subprocess
+{
+public:
+	using OutputCallback = std::function<void(std::string_view)>;
+
+	// arguments are quoted individually on Windows and passed as they are elsewhere
+	Subprocess(const std::filesystem::path& executable_file, const std::vector<std::wstring>& arguments);
+	~Subprocess();
+
+	Subprocess(const Subprocess&) = delete;
+	Subprocess& operator=(const Subprocess&) = delete;
+
+	// streams the output to on_output from a reader thread until the process exits, the deadline passes or it is cancelled, the process is terminated in the latter cases.
+	// throws after terminating it if the wait itself fails
+	SubprocessResult wait(std::chrono::steady_clock::time_point deadline, const OutputCallback& on_output);
+
+	// terminates the process from any thread, wait then returns with cancelled set
+	void cancel();
+
+	uint32_t get_process_id() const { return static_cast<uint32_t>(process_id); }
+
+private:
+#ifdef _WIN32
+	HANDLE process_handle = nullptr;
+	// nullptr if the job could not be created or assigned, the child is then accounted and terminated on its own
+	HANDLE job_handle = nullptr;
+	HANDLE read_pipe = nullptr;
+	HANDLE cancel_event = nullptr;
+	DWORD process_id = 0;
+#else
+	pid_t process_id = 0;
+	int read_pipe = -1;
+
+	// written once the child exited and by cancel, wait sleeps on it until then or the deadline
+	int event_pipe[2] = { -1, -1 };
+	std::atomic<bool> exited = false;
+	std::atomic<bool> cancel_requested = false;
+
+	// set once waitpid collected the child, its pid may be reused afterwards
+	bool reaped = false;
+#endif
+
+	std::chrono::steady_clock::time_point start_time;
+
+	void terminate();
+};
@@ -0,0 +1,272 @@
+#ifndef _WIN32
+
+#include "subprocess.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace
+{
+void close_pipe(int& fd)
+{
+	if (fd >= 0)
+		close(fd);
+
+	fd = -1;
+}
+
+std::chrono::milliseconds to_milliseconds(const timeval& time) { return std::chrono::milliseconds(static_cast<uint64_t>(time.tv_sec) * 1000 + time.tv_usec / 1000); }
+
+// bytes read and written through any file or pipe, like the transfer counts of a job. those of the processes it waited for are included
+bool read_io_counters(pid_t process_id, uint64_t& read_bytes, uint64_t& write_bytes)
+{
+	std::ifstream io_file("/proc/" + std::to_string(process_id) + "/io");
+	std::string name;
+	uint64_t value;
+	int found = 0;
+
+	while (io_file >> name >> value)
+	{
+		if (name == "rchar:")
+			read_bytes = value, ++found;
+		else if (name == "wchar:")
+			write_bytes = value, ++found;
+	}
+
+	return found == 2;
+}
+} // namespace
+
+Subprocess::Subprocess(const std::filesystem::path& executable_file, const std::vector<std::wstring>& arguments)
+{
+	int output_pipe[2];
+
+	// not inherited by processes other threads start meanwhile, the child gets the write end through the file actions
+	if (pipe2(output_pipe, O_CLOEXEC) != 0)
+		throw std::runtime_error("Failed to create read/write pipe");
+
+	if (pipe2(event_pipe, O_CLOEXEC | O_NONBLOCK) != 0)
+	{
+		close(output_pipe[0]);
+		close(output_pipe[1]);
+		throw std::runtime_error("Failed to create cancel event");
+	}
+
+	read_pipe = output_pipe[0];
+
+	std::vector<std::string> argument_strings = { executable_file.string() };
+
+	for (const auto& argument : arguments)
+		argument_strings.push_back(std::filesystem::path(argument).string());
+
+	std::vector<char*> argv;
+
+	for (auto& argument : argument_strings)
+		argv.push_back(argument.data());
+
+	argv.push_back(nullptr);
+
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+	posix_spawn_file_actions_adddup2(&file_actions, output_pipe[1], STDOUT_FILENO);
+	posix_spawn_file_actions_adddup2(&file_actions, output_pipe[1], STDERR_FILENO);
+
+	// a process group of its own, terminate reaches the processes it started as well
+	posix_spawnattr_t attributes;
+	posix_spawnattr_init(&attributes);
+	posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&attributes, 0);
+
+	start_time = std::chrono::steady_clock::now();
+
+	auto error = posix_spawn(&process_id, argv[0], &file_actions, &attributes, argv.data(), environ);
+
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&file_actions);
+
+	// the child holds its own copy, the pipe reports the end of the output once the child closed it
+	close(output_pipe[1]);
+
+	if (error != 0)
+	{
+		close_pipe(read_pipe);
+		close_pipe(event_pipe[0]);
+		close_pipe(event_pipe[1]);
+		throw std::runtime_error("Failed to start " + executable_file.filename().string() + ": " + std::strerror(error));
+	}
+}
+
+Subprocess::~Subprocess()
+{
+	if (process_id > 0 && !reaped)
+	{
+		terminate();
+
+		int status;
+		while (waitpid(process_id, &status, 0) < 0 && errno == EINTR)
+			;
+	}
+
+	close_pipe(read_pipe);
+	close_pipe(event_pipe[0]);
+	close_pipe(event_pipe[1]);
+}
+
+SubprocessResult Subprocess::wait(std::chrono::steady_clock::time_point deadline, const OutputCallback& on_output)
+{
+	SubprocessResult result;
+
+	std::mutex reader_mutex;
+	std::condition_variable reader_cv;
+	bool reader_done = false;
+	std::atomic<bool> stop_reading = false;
+
+	// polls so it can be told to give up on output held open by processes the child started
+	std::thread reader_thread([this, &on_output, &reader_mutex, &reader_cv, &reader_done, &stop_reading]() {
+		char buffer[4096];
+
+		while (!stop_reading.load())
+		{
+			pollfd read_poll = { read_pipe, POLLIN, 0 };
+
+			if (poll(&read_poll, 1, 100) <= 0)
+				continue;
+
+			auto bytes_read = read(read_pipe, buffer, sizeof(buffer));
+
+			if (bytes_read < 0 && errno == EINTR)
+				continue;
+
+			if (bytes_read <= 0)
+				break;
+
+			on_output(std::string_view(buffer, static_cast<size_t>(bytes_read)));
+		}
+
+		std::unique_lock lock(reader_mutex);
+		reader_done = true;
+		reader_cv.notify_all();
+	});
+
+	int status = 0;
+	rusage usage{};
+	bool has_io_counters = false;
+
+	std::thread waiter_thread([this, &status, &usage, &has_io_counters, &result]() {
+		// exited but not collected yet, its i/o counters are gone once it is
+		siginfo_t info{};
+		while (waitid(P_PID, static_cast<id_t>(process_id), &info, WEXITED | WNOWAIT) < 0 && errno == EINTR)
+			;
+
+		has_io_counters = read_io_counters(process_id, result.read_bytes, result.write_bytes);
+
+		while (wait4(process_id, &status, 0, &usage) < 0 && errno == EINTR)
+			;
+
+		exited.store(true);
+
+		char event = 'x';
+		[[maybe_unused]] auto written = write(event_pipe[1], &event, 1);
+	});
+
+	const auto finish_reading = [&]() {
+		std::unique_lock lock(reader_mutex);
+
+		// processes started by the child may still hold the pipe open, their output is not waited for
+		if (!reader_cv.wait_for(lock, std::chrono::seconds(1), [&reader_done]() { return reader_done; }))
+		{
+			stop_reading.store(true);
+			kill(-process_id, SIGKILL);
+		}
+
+		lock.unlock();
+		reader_thread.join();
+	};
+
+	while (!exited.load() && !cancel_requested.load())
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+		if (remaining <= 0)
+			break;
+
+		pollfd event_poll = { event_pipe[0], POLLIN, 0 };
+
+		// the process may still be running, it is terminated instead of reading an exit status it does not have yet
+		if (poll(&event_poll, 1, static_cast<int>(std::min<long long>(remaining, INT_MAX))) < 0 && errno != EINTR)
+		{
+			auto error = errno;
+
+			terminate();
+			waiter_thread.join();
+			reaped = true;
+			finish_reading();
+
+			throw std::runtime_error("Failed to wait for process " + std::to_string(process_id) + ", error " + std::to_string(error));
+		}
+	}
+
+	if (!exited.load())
+	{
+		result.cancelled = cancel_requested.load();
+		result.timed_out = !result.cancelled;
+
+		terminate();
+	}
+
+	waiter_thread.join();
+	reaped = true;
+
+	finish_reading();
+
+	result.wall_time = std::chrono::steady_clock::now() - start_time;
+
+	if (WIFEXITED(status))
+		result.exit_code = static_cast<uint32_t>(WEXITSTATUS(status));
+	else if (WIFSIGNALED(status))
+		result.exit_code = static_cast<uint32_t>(128 + WTERMSIG(status));
+
+	// of the child and the processes it waited for, the peak resident set is the largest of them rather than their sum
+	result.user_time = to_milliseconds(usage.ru_utime);
+	result.kernel_time = to_milliseconds(usage.ru_stime);
+	result.peak_working_set = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+
+	// without procfs only the blocks that went to the disk are counted
+	if (!has_io_counters)
+	{
+		result.read_bytes = static_cast<uint64_t>(usage.ru_inblock) * 512;
+		result.write_bytes = static_cast<uint64_t>(usage.ru_oublock) * 512;
+	}
+
+	return result;
+}
+
+void Subprocess::cancel()
+{
+	cancel_requested.store(true);
+
+	char event = 'c';
+	[[maybe_unused]] auto written = write(event_pipe[1], &event, 1);
+}
+
+void Subprocess::terminate() { kill(-process_id, SIGKILL); }
+
+#endif
@@ -0,0 +1,83 @@
+#include "tracing.h"
+#include "addon.h"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+
+IMPLEMENT_MODULE(Tracer, tracer)
+
+#define TRACE_FILE "trace.json"
+
+void Tracer::set_thread_name(const char* name)
+{
+	std::lock_guard lock(thread_names_mutex);
+	thread_names[GetCurrentThreadId()] = name;
+}
+
+void Tracer::record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	auto position = write_position.fetch_add(1, std::memory_order_relaxed);
+	auto& event = events[position % capacity];
+
+	event.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	event.name = name;
+	event.thread_id = GetCurrentThreadId();
+	event.start_us = std::chrono::duration_cast<std::chrono::microseconds>(start - epoch).count();
+	event.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+	event.sequence.store(position + 1, std::memory_order_release);
+}
+
+void Tracer::clear()
+{
+	for (auto& event : events)
+		event.sequence.store(0, std::memory_order_relaxed);
+}
+
+std::filesystem::path Tracer::export_to_file()
+{
+	nlohmann::json trace_events = nlohmann::json::array();
+
+	auto process_id = GetCurrentProcessId();
+
+	{
+		std::lock_guard lock(thread_names_mutex);
+
+		for (const auto& [thread_id, name] : thread_names)
+			trace_events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", process_id }, { "tid", thread_id }, { "args", { { "name", name } } } });
+	}
+
+	for (auto& event : events)
+	{
+		auto sequence = event.sequence.load(std::memory_order_acquire);
+
+		if (sequence == 0)
+			continue;
+
+		auto name = event.name;
+		auto thread_id = event.thread_id;
+		auto start_us = event.start_us;
+		auto duration_us = event.duration_us;
+
+		// the slot was overwritten while it was read
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (event.sequence.load(std::memory_order_relaxed) != sequence)
+			continue;
+
+		trace_events.push_back({ { "name", name }, { "ph", "X" }, { "pid", process_id }, { "tid", thread_id }, { "ts", start_us }, { "dur", duration_us } });
+	}
+
+	auto file_path = addon::directory / TRACE_FILE;
+
+	std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+		throw std::runtime_error("Failed to create file: " + file_path.string());
+
+	file << nlohmann::json{ { "traceEvents", trace_events }, { "displayTimeUnit", "ms" } }.dump();
+
+	return file_path;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "module.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// records a span from here to the end of the enclosing scope, name must be a string literal
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+// names the calling thread in exported traces, only the first call per thread takes effect
+#define TRACE_THREAD(name)                             \
+	{                                                  \
+		thread_local bool thread_named = false;        \
+		if (!thread_named)                             \
+		{                                              \
+			thread_named = true;                       \
+			addon::tracer->set_thread_name(name);      \
+		}                                              \
+	}
+
+// bounded ring of completed spans, exported as chrome trace_event json. spans cost a single relaxed load while tracing is disabled
+class Tracer
+{
+public:
+	static constexpr size_t capacity = 1 << 16;
+
+	std::atomic<bool> enabled = false;
+
+	void set_thread_name(const char* name);
+
+	void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+	void clear();
+
+	// writes the recorded spans to trace.json in the addon directory, returns the file written
+	std::filesystem::path export_to_file();
+
+private:
+	struct Event
+	{
+		// 0 while the slot is being written, otherwise the position it was written at plus one
+		std::atomic<uint64_t> sequence = 0;
+		const char* name = nullptr;
+		uint32_t thread_id = 0;
+		int64_t start_us = 0;
+		int64_t duration_us = 0;
+	};
+
+	std::array<Event, capacity> events;
+	std::atomic<uint64_t> write_position = 0;
+
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	std::mutex thread_names_mutex;
+	std::unordered_map<uint32_t, std::string> thread_names;
+};
+
+DECLARE_MODULE(Tracer, tracer)
+
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name) : name(addon::tracer->enabled.load(std::memory_order_relaxed) ? name : nullptr)
+	{
+		if (this->name)
+			start = std::chrono::steady_clock::now();
+	}
+
+	~TraceScope()
+	{
+		if (name)
+			addon::tracer->record(name, start, std::chrono::steady_clock::now());
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* name;
+	std::chrono::steady_clock::time_point start;
+};
+
+// acquires a deferred lock inside a span so the time spent waiting for it shows up in traces
+template <typename Lock> void traced_lock(Lock& lock, const char* name)
+{
+	TraceScope scope(name);
+	lock.lock();
+}
@@ -1,7 +1,15 @@
 #include "ui.h"
+#include "dps_report_uploader.h"
 #include "log_manager.h"
+#include "retention_manager.h"
+#include "statistics.h"
+#include "tracing.h"
 #include "ui_elements.h"
 
+#include <algorithm>
+#include <format>
+#include <vector>
+
 IMPLEMENT_MODULE(UI, ui)
 
 #define SAVE_SETTING(Setting) addon::settings->write([this, &settings](auto& _settings) { _settings.Setting = settings.Setting; });
@@ -28,6 +36,15 @@ IMPLEMENT_MODULE(UI, ui)
 		SAVE_SETTING(Setting);                                                   \
 	}
 
+// the uploaders append the endpoint paths to the server url, applied once editing finished so typing http:// works
+static std::string normalize_server_url(std::string server_url, const std::string& default_url)
+{
+	while (server_url.ends_with('/'))
+		server_url.pop_back();
+
+	return server_url.empty() ? default_url : server_url;
+}
+
 void UI::initialize()
 {}
 
@@ -39,6 +56,12 @@ void UI::render_options()
 
 	if (ImGui::BeginTabBar("OptionsTabBar"))
 	{
+		if (ImGui::BeginTabItem("General Options"))
+		{
+			draw_general_options(settings);
+			ImGui::EndTabItem();
+		}
+
 		if (ImGui::BeginTabItem("Display Options"))
 		{
 			draw_display_options(settings);
@@ -63,6 +86,12 @@ void UI::render_options()
 			ImGui::EndTabItem();
 		}
 
+		if (ImGui::BeginTabItem("Statistics"))
+		{
+			draw_statistics();
+			ImGui::EndTabItem();
+		}
+
 		ImGui::EndTabBar();
 	}
 }
@@ -71,6 +100,11 @@ void UI::render_context_menu()
 {
 	auto settings = addon::settings->read([this](auto& settings) { return settings; });
 
+	if (ImGui::BeginMenu("General"))
+	{
+		draw_general_options(settings);
+		ImGui::EndMenu();
+	}
 	if (ImGui::BeginMenu("Display"))
 	{
 		draw_display_options(settings);
@@ -95,6 +129,46 @@ void UI::render_context_menu()
 	}
 }
 
+void UI::draw_general_options(SettingsData& settings)
+{
+	ImGui::ID id("General Settings");
+
+	if (ImGui::InputInt("Upload bandwidth limit (KiB/s)", &settings.general.upload_rate_limit, 64, 512))
+	{
+		settings.general.upload_rate_limit = std::max(settings.general.upload_rate_limit, 0);
+		SAVE_SETTING(general.upload_rate_limit);
+	}
+	ImGui::HoverTooltip("Maximum upload bandwidth shared by all dps.report and Wingman uploads. 0 for unlimited.");
+
+	UI_CHECKBOX_T("Compress evtc uploads", general.compress_evtc_uploads, "Compress uncompressed .evtc logs to .zevtc before uploading them. The compressed copy is removed once all uploads are done.");
+
+	// Squad share directory
+	{
+		char squad_share_directory[MAX_PATH] = {};
+		strncpy_s(squad_share_directory, settings.general.squad_share_directory.c_str(), sizeof(squad_share_directory) - 1);
+
+		if (ImGui::InputText("Squad share folder", squad_share_directory, sizeof(squad_share_directory)))
+		{
+			settings.general.squad_share_directory = squad_share_directory;
+			SAVE_SETTING(general.squad_share_directory);
+		}
+		ImGui::HoverTooltip("Folder shared with your squad, e.g. a network or synced drive. Logs of a fight another squad member already uploaded to dps.report resolve to their upload instead of being uploaded again. Leave empty to disable.");
+	}
+
+	// Log level
+	{
+		auto log_level = settings.general.log_level - 1;
+
+		if (ImGui::Combo("Log level", &log_level, "Critical\0Warning\0Info\0Debug\0Trace\0"))
+		{
+			settings.general.log_level = log_level + 1;
+			addon::log_level.store(static_cast<LogLevel>(settings.general.log_level));
+			SAVE_SETTING(general.log_level);
+		}
+		ImGui::HoverTooltip("Most detailed messages passed to the Nexus log, which filters them by its own log level as well.");
+	}
+}
+
 void UI::draw_display_options(SettingsData& settings)
 {
 	ImGui::ID id("Display Settings");
@@ -139,6 +213,7 @@ void UI::draw_display_options(SettingsData& settings)
 	ImGui::Spacing();
 	ImGui::Text("Columns");
 	UI_CHECKBOX("Parser", display.log_table.parser_column);
+	UI_CHECKBOX_T("ETA", display.log_table.eta_column, "Expected time until queued and running parses finish, predicted from earlier parses of the encounter and the log size.");
 	UI_CHECKBOX("DPS Report", display.log_table.dps_report_column);
 	UI_CHECKBOX("Wingman", display.log_table.wingman_column);
 }
@@ -177,6 +252,28 @@ void UI::draw_dps_report_options(SettingsData& settings)
 	UI_CHECKBOX_T("Anonymize", dps_report.anonymize, "Player names will be anonymized.");
 	UI_CHECKBOX_T("Detailed WvW", dps_report.detailed_wvw, "Enable detailed WvW reports.");
 
+	if (ImGui::SliderInt("Concurrent uploads", &settings.dps_report.concurrent_uploads, 1, static_cast<int>(DPSReportUploader::max_concurrent_uploads)))
+		SAVE_SETTING(dps_report.concurrent_uploads);
+	ImGui::HoverTooltip("Number of logs uploaded to dps.report at the same time. Connections are kept alive between uploads.");
+
+	// Server url
+	{
+		char server_url[256] = {};
+		strncpy_s(server_url, settings.dps_report.server_url.c_str(), sizeof(server_url) - 1);
+
+		if (ImGui::InputText("Server url", server_url, sizeof(server_url)))
+		{
+			settings.dps_report.server_url = server_url;
+			SAVE_SETTING(dps_report.server_url);
+		}
+		if (ImGui::IsItemDeactivatedAfterEdit())
+		{
+			settings.dps_report.server_url = normalize_server_url(server_url, SettingsData::DPSReport().server_url);
+			SAVE_SETTING(dps_report.server_url);
+		}
+		ImGui::HoverTooltip("Address uploads are sent to, e.g. a local stand-in of dps.report for load tests. Leave empty for dps.report.");
+	}
+
 	ImGui::Spacing();
 	ImGui::Separator();
 	ImGui::Spacing();
@@ -190,6 +287,25 @@ void UI::draw_wingman_options(SettingsData& settings)
 
 	UI_CHECKBOX_T("Auto upload", wingman.auto_upload, "Automatically upload new logs based on selected encounters and filter options");
 	UI_COMBO("Auto upload result filter", wingman.auto_upload_filter, "None\0Successful only\0");
+	UI_CHECKBOX_T("Compress uploads", wingman.compress_uploads, "Send the json and html reports gzip compressed. Falls back to uncompressed uploads if the server does not accept them.");
+
+	// Server url
+	{
+		char server_url[256] = {};
+		strncpy_s(server_url, settings.wingman.server_url.c_str(), sizeof(server_url) - 1);
+
+		if (ImGui::InputText("Server url", server_url, sizeof(server_url)))
+		{
+			settings.wingman.server_url = server_url;
+			SAVE_SETTING(wingman.server_url);
+		}
+		if (ImGui::IsItemDeactivatedAfterEdit())
+		{
+			settings.wingman.server_url = normalize_server_url(server_url, SettingsData::Wingman().server_url);
+			SAVE_SETTING(wingman.server_url);
+		}
+		ImGui::HoverTooltip("Address checks and uploads are sent to, e.g. a local stand-in of Wingman for load tests. Leave empty for Wingman.");
+	}
 
 	ImGui::Spacing();
 	ImGui::Separator();
@@ -198,6 +314,192 @@ void UI::draw_wingman_options(SettingsData& settings)
 	UI_OPTION(ImGui::EncounterSelector, "Auto Upload Encounter Selection", wingman.auto_upload_encounters);
 }
 
+void UI::draw_statistics()
+{
+	ImGui::ID id("Statistics");
+
+	auto elapsed_minutes = std::chrono::duration_cast<std::chrono::minutes>(addon::statistics->get_elapsed()).count();
+
+	ImGui::Text("Pipeline latencies of logs added in the last %lld min", elapsed_minutes);
+
+	if (ImGui::BeginTable("Pipeline Latencies", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+	{
+		ImGui::TableSetupColumn("Interval");
+		ImGui::TableSetupColumn("Count");
+		ImGui::TableSetupColumn("Per minute");
+		ImGui::TableSetupColumn("Mean");
+		ImGui::TableSetupColumn("p50");
+		ImGui::TableSetupColumn("p90");
+		ImGui::TableSetupColumn("p99");
+		ImGui::TableSetupColumn("Max");
+		ImGui::TableHeadersRow();
+
+		static const auto format_duration = [](double ms) { return ms < 1000.0 ? std::format("{:.0f} ms", ms) : std::format("{:.2f} s", ms / 1000.0); };
+
+		for (size_t i = 0; i < Statistics::interval_definitions.size(); ++i)
+		{
+			const auto& histogram = addon::statistics->get_histogram(static_cast<PipelineInterval>(i));
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(Statistics::interval_definitions[i].name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", histogram.get_count());
+
+			if (histogram.get_count() == 0)
+				continue;
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", addon::statistics->get_rate_per_minute(static_cast<PipelineInterval>(i)));
+
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(format_duration(histogram.get_mean()).c_str());
+
+			for (auto percentile : { 50.0, 90.0, 99.0 })
+			{
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(format_duration(static_cast<double>(histogram.get_percentile(percentile))).c_str());
+			}
+
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(format_duration(static_cast<double>(histogram.get_max())).c_str());
+		}
+
+		ImGui::EndTable();
+	}
+
+	if (ImGui::BeginTable("Queue Depths", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+	{
+		ImGui::TableSetupColumn("Queue");
+		ImGui::TableSetupColumn("Waiting");
+		ImGui::TableSetupColumn("Peak");
+		ImGui::TableHeadersRow();
+
+		for (size_t i = 0; i < Statistics::queue_names.size(); ++i)
+		{
+			const auto& queue_depth = addon::statistics->get_queue_depth(static_cast<PipelineQueue>(i));
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(Statistics::queue_names[i]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%zu", queue_depth.get_current());
+			ImGui::TableNextColumn();
+			ImGui::Text("%zu", queue_depth.get_peak());
+		}
+
+		ImGui::EndTable();
+	}
+
+	// encounters that keep Elite Insights busy the longest come first
+	auto parse_resources = addon::statistics->get_parse_resources();
+
+	std::vector<std::pair<TriggerID, ParseResourceTotals>> encounters(parse_resources.begin(), parse_resources.end());
+	std::ranges::sort(encounters, std::ranges::greater(), [](const auto& encounter) { return encounter.second.cpu_time; });
+
+	if (!encounters.empty() && ImGui::BeginTable("Elite Insights Resources", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+	{
+		ImGui::TableSetupColumn("Encounter");
+		ImGui::TableSetupColumn("Runs");
+		ImGui::TableSetupColumn("Mean time");
+		ImGui::TableSetupColumn("Max time");
+		ImGui::TableSetupColumn("Cores");
+		ImGui::TableSetupColumn("Peak memory");
+		ImGui::TableSetupColumn("Read");
+		ImGui::TableSetupColumn("Written");
+		ImGui::TableHeadersRow();
+
+		for (const auto& [trigger_id, totals] : encounters)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+
+			if (totals.name.empty())
+				ImGui::Text("Trigger %u", static_cast<uint32_t>(trigger_id));
+			else
+				ImGui::TextUnformatted(totals.name.c_str());
+
+			ImGui::TableNextColumn();
+
+			if (totals.failed > 0)
+				ImGui::Text("%llu (%llu failed)", totals.count, totals.failed);
+			else
+				ImGui::Text("%llu", totals.count);
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f s", totals.wall_time.count() / 1000.0 / totals.count);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f s", totals.max_wall_time.count() / 1000.0);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", totals.get_cores());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.0f MiB", totals.max_peak_working_set / 1048576.0);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f MiB", totals.read_bytes / 1048576.0 / totals.count);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f MiB", totals.write_bytes / 1048576.0 / totals.count);
+		}
+
+		ImGui::EndTable();
+		ImGui::HoverTooltip("Elite Insights runs per encounter. Cores is the cpu time divided by the wall time, read and written are per run.");
+	}
+
+	auto memory_usage = Statistics::get_memory_usage();
+
+	ImGui::Text("Memory: %.1f MiB working set, %.1f MiB peak, %.1f MiB private", memory_usage.working_set / 1048576.0, memory_usage.peak_working_set / 1048576.0, memory_usage.private_bytes / 1048576.0);
+	ImGui::HoverTooltip("Memory of the whole game process, not only of this addon");
+
+	if (ImGui::Button("Export"))
+	{
+		try
+		{
+			auto file_path = addon::statistics->export_to_file();
+			addon::log("Statistics exported to " + file_path.string(), LOGLEVEL_INFO);
+		}
+		catch (const std::exception& e)
+		{
+			addon::log("Failed to export statistics. Exception: " + std::string(e.what()), LOGLEVEL_WARNING);
+		}
+	}
+	ImGui::HoverTooltip("Write the latency histograms, throughput, queue depths, Elite Insights resource usage and memory usage to statistics.json in the addon directory");
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Reset"))
+		addon::statistics->reset();
+
+	ImGui::Spacing();
+	ImGui::Separator();
+	ImGui::Spacing();
+
+	auto tracing = addon::tracer->enabled.load();
+
+	if (ImGui::Checkbox("Record trace", &tracing))
+		addon::tracer->enabled.store(tracing);
+	ImGui::HoverTooltip("Record when the monitor, parser, uploader and ui threads are busy or waiting. Only the most recent spans are kept.");
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Export trace"))
+	{
+		try
+		{
+			auto file_path = addon::tracer->export_to_file();
+			addon::log("Trace exported to " + file_path.string(), LOGLEVEL_INFO);
+		}
+		catch (const std::exception& e)
+		{
+			addon::log("Failed to export trace. Exception: " + std::string(e.what()), LOGLEVEL_WARNING);
+		}
+	}
+	ImGui::HoverTooltip("Write the recorded spans to trace.json in the addon directory, open it in chrome://tracing or ui.perfetto.dev");
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Clear trace"))
+		addon::tracer->clear();
+}
+
 void UI::draw_parser_options(SettingsData& settings)
 {
 	ImGui::ID id("Parser Settings");
@@ -205,4 +507,33 @@ void UI::draw_parser_options(SettingsData& settings)
 	UI_CHECKBOX_T("Auto parse", parser.auto_parse, "Automatically parse new (z)evtc files");
 	UI_CHECKBOX_T("Auto update", parser.auto_update, "Automatically check for new Elite Insights version on startup and install if available");
 	UI_COMBO("Update channel", parser.update_channel, "Latest\0Latest (Wingman)\0");
+	UI_CHECKBOX_T("Always generate html reports", parser.always_generate_html, "Logs are parsed into a json report only unless Wingman will upload them. The html report is generated when it is opened.");
+	UI_CHECKBOX_T("Compress reports", parser.compress_reports, "Keep the json and html reports gzip compressed on disk. Reports are decompressed into a temporary file when opened.");
+
+	ImGui::Spacing();
+	ImGui::Separator();
+	ImGui::Spacing();
+
+	if (ImGui::InputInt("Maximum report size (MiB)", &settings.parser.retention_max_size_mb, 64, 256))
+	{
+		settings.parser.retention_max_size_mb = std::max(settings.parser.retention_max_size_mb, 0);
+		SAVE_SETTING(parser.retention_max_size_mb);
+		addon::retention_manager->enforce();
+	}
+	ImGui::HoverTooltip("Total size of the Elite Insights reports kept on disk. The least recently used reports of logs already on Wingman or from previous sessions are removed first. 0 for unlimited.");
+
+	if (ImGui::InputInt("Maximum report age (days)", &settings.parser.retention_max_age_days, 1, 7))
+	{
+		settings.parser.retention_max_age_days = std::max(settings.parser.retention_max_age_days, 0);
+		SAVE_SETTING(parser.retention_max_age_days);
+		addon::retention_manager->enforce();
+	}
+	ImGui::HoverTooltip("Reports unused for longer are removed under the same conditions. 0 for unlimited.");
+
+	auto disk_usage = addon::retention_manager->get_disk_usage();
+
+	if (disk_usage.indexed)
+		ImGui::Text("Reports use %.1f MiB in %zu files", disk_usage.bytes / 1048576.0, disk_usage.files);
+	else
+		ImGui::TextDisabled("Indexing reports...");
 }
@@ -16,10 +16,12 @@ public:
 	LogsTable logs_table;
 
 private:
+	void draw_general_options(SettingsData& settings);
 	void draw_display_options(SettingsData& settings);
 	void draw_dps_report_options(SettingsData& settings);
 	void draw_wingman_options(SettingsData& settings);
 	void draw_parser_options(SettingsData& settings);
+	void draw_statistics();
 };
 
 DECLARE_MODULE(UI, ui)
@@ -6,6 +6,7 @@
 #include <imgui_internal.h>
 
 #include <algorithm>
+#include <format>
 #include <unordered_map>
 
 #include <ShlObj.h>
@@ -54,21 +55,34 @@ void ImGui::ButtonParser(std::shared_ptr<Log> log, LogData& log_data)
 		}
 	};
 
-	auto available = log_data.parser_data.status == ParseStatus::PARSED || log_data.parser_data.status == ParseStatus::UNPARSED;
+	// reports missing because the log was parsed without one or they were removed by the retention manager are generated on open
+	auto report_queued = log_data.parser_data.report_queued;
+	auto available = (log_data.parser_data.status == ParseStatus::PARSED && !report_queued) || log_data.parser_data.status == ParseStatus::UNPARSED;
 
-	if (ButtonDisabled(get_text(log_data.parser_data.status), !available))
+	if (ButtonDisabled(report_queued ? "Generating" : get_text(log_data.parser_data.status), !available))
 	{
 		if (log_data.parser_data.status == ParseStatus::UNPARSED)
 			addon::parser->add_log(log);
 		else if (log_data.parser_data.status == ParseStatus::PARSED)
-			ShellExecute(nullptr, L"open", log_data.parser_data.html_file_path.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
+			addon::parser->open_report(log);
 	}
 
-	if (log_data.parser_data.error_message.has_value())
-		HoverTooltip(log_data.parser_data.error_message.value().c_str());
+	std::string tooltip = log_data.parser_data.error_message.value_or("");
+
+	if (const auto& usage = log_data.parser_data.resource_usage; usage.has_value())
+	{
+		if (!tooltip.empty())
+			tooltip += "\n\n";
+
+		tooltip += std::format("Elite Insights: {:.1f} s, {:.1f} s CPU ({:.1f} cores)\nPeak memory: {:.0f} MiB\nI/O: {:.1f} MiB read, {:.1f} MiB written", usage->wall_time.count() / 1000.0,
+			usage->get_cpu_time().count() / 1000.0, usage->get_cores(), usage->peak_working_set / 1048576.0, usage->read_bytes / 1048576.0, usage->write_bytes / 1048576.0);
+	}
+
+	if (!tooltip.empty())
+		HoverTooltip(tooltip.c_str());
 }
 
-bool ImGui::ButtonUpload(UploadStatus upload_status, bool available)
+bool ImGui::ButtonUpload(UploadStatus upload_status, bool available, bool retrying)
 {
 	static const auto get_text = [](UploadStatus status) -> const char* {
 		switch (status)
@@ -92,7 +106,7 @@ bool ImGui::ButtonUpload(UploadStatus upload_status, bool available)
 		}
 	};
 
-	return ButtonDisabled(get_text(upload_status), !available);
+	return ButtonDisabled(retrying ? "Retrying" : get_text(upload_status), !available);
 }
 
 void ImGui::ButtonDPSReportUpload(std::shared_ptr<Log> log, DpsReportUpload& upload_data)
@@ -123,7 +137,15 @@ void ImGui::ButtonDPSReportUpload(std::shared_ptr<Log> log, DpsReportUpload& upl
 		}
 	};
 
-	if (ButtonDisabled(get_text(upload_data.status), !available))
+	if (upload_data.status == UploadStatus::UPLOADING && upload_data.bytes_total > 0)
+	{
+		UploadProgressBar(upload_data);
+		return;
+	}
+
+	auto text = upload_data.next_retry_time.has_value() ? "Retrying" : get_text(upload_data.status);
+
+	if (ButtonDisabled(text, !available))
 	{
 		if (upload_data.status == UploadStatus::AVAILABLE)
 			addon::dps_report_uploader->add_log(log);
@@ -131,24 +153,28 @@ void ImGui::ButtonDPSReportUpload(std::shared_ptr<Log> log, DpsReportUpload& upl
 			upload_data.open();
 	}
 
-	if (upload_data.error_message.has_value())
-		HoverTooltip(upload_data.error_message.value().c_str());
+	UploadTooltip(upload_data);
 }
 
 void ImGui::ButtonWingmanUpload(std::shared_ptr<Log> log, WingmanUpload& upload_data, ParserData& parser_data)
 {
 	ID id("Wingman Button");
 
+	if (upload_data.status == UploadStatus::UPLOADING && upload_data.bytes_total > 0)
+	{
+		UploadProgressBar(upload_data);
+		return;
+	}
+
 	auto available = upload_data.status == UploadStatus::AVAILABLE && parser_data.status == ParseStatus::PARSED;
 
-	if (ButtonUpload(upload_data.status, available))
+	if (ButtonUpload(upload_data.status, available, upload_data.next_retry_time.has_value()))
 	{
 		if (upload_data.status == UploadStatus::AVAILABLE)
 			addon::wingman_uploader->add_log(log);
 	}
 
-	if (upload_data.error_message.has_value())
-		HoverTooltip(upload_data.error_message.value().c_str());
+	UploadTooltip(upload_data);
 }
 
 bool ImGui::EncounterSelector(const char* label, EncounterSelection* value)
@@ -343,6 +369,38 @@ void ImGui::HoverTooltip(const char* text)
 		SetTooltip("%s", text);
 }
 
+void ImGui::UploadTooltip(const Upload& upload_data)
+{
+	if (!IsItemHovered())
+		return;
+
+	if (upload_data.next_retry_time.has_value())
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::seconds>(upload_data.next_retry_time.value() - std::chrono::system_clock::now());
+		auto text = std::format("Attempt {} failed: {}\nNext attempt in {}s", upload_data.attempts, upload_data.error_message.value_or("Unknown error"), std::max(remaining.count(), 0ll));
+
+		SetTooltip("%s", text.c_str());
+	}
+	else if (upload_data.error_message.has_value())
+	{
+		if (upload_data.attempts > 1)
+			SetTooltip("%s (%d attempts)", upload_data.error_message.value().c_str(), upload_data.attempts);
+		else
+			SetTooltip("%s", upload_data.error_message.value().c_str());
+	}
+}
+
+void ImGui::UploadProgressBar(const Upload& upload_data)
+{
+	auto fraction = upload_data.bytes_total > 0 ? static_cast<float>(static_cast<double>(upload_data.bytes_sent) / static_cast<double>(upload_data.bytes_total)) : 0.f;
+	auto overlay = std::format("{:.0f}%", fraction * 100.f);
+
+	ProgressBar(fraction, ImVec2(GetColumnWidth(), 0.f), overlay.c_str());
+
+	if (IsItemHovered())
+		SetTooltip("%.1f / %.1f MB", static_cast<double>(upload_data.bytes_sent) / (1024.0 * 1024.0), static_cast<double>(upload_data.bytes_total) / (1024.0 * 1024.0));
+}
+
 void ImGui::CenterNextTextItemHorizontally(const char* text)
 {
 	const auto offset = (ImGui::GetColumnWidth() - ImGui::CalcTextSize(text).x) * .5f;
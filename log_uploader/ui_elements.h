@@ -21,11 +21,13 @@ public:
 bool ButtonDisabled(const char* label, bool disabled);
 
 void ButtonParser(std::shared_ptr<Log> log, LogData& log_data);
-bool ButtonUpload(UploadStatus upload_status, bool available);
+bool ButtonUpload(UploadStatus upload_status, bool available, bool retrying = false);
 void ButtonDPSReportUpload(std::shared_ptr<Log> log, DpsReportUpload& upload_data);
 void ButtonWingmanUpload(std::shared_ptr<Log> log, WingmanUpload& upload_data, ParserData& parser_data);
 bool EncounterSelector(const char* label, EncounterSelection* value);
 void HoverTooltip(const char* text);
+void UploadTooltip(const Upload& upload_data);
+void UploadProgressBar(const Upload& upload_data);
 void CenterNextTextItemHorizontally(const char* text);
 } // namespace ImGui
 
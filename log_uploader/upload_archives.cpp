@@ -0,0 +1,120 @@
+#include "upload_archives.h"
+#include "addon.h"
+#include "compression.h"
+#include "settings.h"
+
+IMPLEMENT_MODULE(UploadArchives, upload_archives)
+
+#define ARCHIVE_DIRECTORY "upload-archives"
+
+void UploadArchives::initialize()
+{
+	directory = addon::directory / ARCHIVE_DIRECTORY;
+
+	std::error_code ec;
+
+	// archives left behind by a previous session are of no use anymore
+	std::filesystem::remove_all(directory, ec);
+	std::filesystem::create_directories(directory, ec);
+}
+
+void UploadArchives::release()
+{
+	{
+		std::lock_guard lock(archives_mutex);
+
+		// an archive still being written belongs to an uploader that has already been joined
+		archives.clear();
+	}
+
+	std::error_code ec;
+	std::filesystem::remove_all(directory, ec);
+}
+
+std::filesystem::path UploadArchives::get_upload_file_path(const std::filesystem::path& evtc_file_path)
+{
+	if (evtc_file_path.extension() != ".evtc" || !addon::settings->get().general.compress_evtc_uploads)
+		return evtc_file_path;
+
+	std::promise<std::filesystem::path> promise;
+	std::shared_future<std::filesystem::path> archive;
+	bool owner = false;
+
+	{
+		std::lock_guard lock(archives_mutex);
+
+		auto it = archives.find(evtc_file_path);
+
+		if (it == archives.end())
+		{
+			archive = promise.get_future().share();
+			archives.emplace(evtc_file_path, archive);
+			owner = true;
+		}
+		else
+		{
+			archive = it->second;
+		}
+	}
+
+	// the first uploader to ask compresses the log, the other one waits for the same archive
+	if (owner)
+	{
+		auto archive_file_path = directory / evtc_file_path.filename().replace_extension(".zevtc");
+
+		try
+		{
+			// logs of different encounters can share a file name
+			for (int i = 1; std::filesystem::exists(archive_file_path); ++i)
+				archive_file_path = directory / (evtc_file_path.stem().string() + "_" + std::to_string(i) + ".zevtc");
+
+			zip_file(evtc_file_path, archive_file_path, evtc_file_path.filename().string());
+
+			addon::log(LOGLEVEL_DEBUG, "Compressed {} for upload: {} KiB -> {} KiB", evtc_file_path.filename().string(), std::filesystem::file_size(evtc_file_path) / 1024, std::filesystem::file_size(archive_file_path) / 1024);
+
+			promise.set_value(archive_file_path);
+		}
+		catch (const std::exception& e)
+		{
+			addon::log("Failed to compress " + evtc_file_path.string() + " for upload, uploading it uncompressed. Exception: " + e.what(), LOGLEVEL_WARNING);
+			promise.set_value(evtc_file_path);
+		}
+	}
+
+	return archive.get();
+}
+
+void UploadArchives::release_log(std::shared_ptr<Log> log)
+{
+	static const auto is_pending = [](UploadStatus status) { return status == UploadStatus::QUEUED || status == UploadStatus::UPLOADING; };
+
+	std::shared_lock lock(log->mutex);
+
+	// wingman uploads only start after parsing, the archive is kept until then
+	if (is_pending(log->dps_report_upload.status) || is_pending(log->wingman_upload.status) || log->parser_data.status == ParseStatus::QUEUED || log->parser_data.status == ParseStatus::PARSING)
+		return;
+
+	auto evtc_file_path = log->evtc_file_path;
+
+	lock.unlock();
+
+	std::shared_future<std::filesystem::path> archive;
+
+	{
+		std::lock_guard archives_lock(archives_mutex);
+
+		auto it = archives.find(evtc_file_path);
+
+		if (it == archives.end() || it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+
+		archive = it->second;
+		archives.erase(it);
+	}
+
+	if (archive.get() != evtc_file_path)
+	{
+		std::error_code ec;
+		std::filesystem::remove(archive.get(), ec);
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "log.h"
+#include "module.h"
+
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+// deflates raw evtc files into temporary zevtc archives before upload, both uploaders share the archive of a log
+class UploadArchives
+{
+public:
+	void initialize();
+	void release();
+
+	// returns the file to upload for the log, the evtc itself if it is already compressed or compression is disabled
+	std::filesystem::path get_upload_file_path(const std::filesystem::path& evtc_file_path);
+
+	// removes the archive of the log once no upload of it is pending anymore
+	void release_log(std::shared_ptr<Log> log);
+
+private:
+	std::filesystem::path directory;
+
+	std::mutex archives_mutex;
+	std::unordered_map<std::filesystem::path, std::shared_future<std::filesystem::path>> archives;
+};
+
+DECLARE_MODULE(UploadArchives, upload_archives)
@@ -0,0 +1,296 @@
+#include "upload_journal.h"
+#include "addon.h"
+#include "dps_report_uploader.h"
+#include "log_manager.h"
+#include "wingman_uploader.h"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+IMPLEMENT_MODULE(UploadJournal, upload_journal)
+
+#define JOURNAL_FILE "upload-journal.jsonl"
+#define FLUSH_INTERVAL std::chrono::milliseconds(500)
+#define MAX_PENDING_AGE std::chrono::days(7)
+
+namespace
+{
+const char* get_service_name(UploadService service) { return service == UploadService::WINGMAN ? "wingman" : "dps_report"; }
+
+std::string to_utf8(const std::filesystem::path& path)
+{
+	auto u8 = path.u8string();
+	return std::string(u8.begin(), u8.end());
+}
+
+std::filesystem::path from_utf8(const std::string& str) { return std::filesystem::path(std::u8string(str.begin(), str.end())); }
+} // namespace
+
+void UploadJournal::initialize()
+{
+	file_path = addon::directory / JOURNAL_FILE;
+
+	try
+	{
+		load();
+	}
+	catch (const std::exception& e)
+	{
+		addon::log("Failed to load upload journal: " + file_path.string() + " Exception: " + e.what(), LOGLEVEL_WARNING);
+		pending_uploads.clear();
+	}
+
+#ifdef _WIN32
+	file_handle = CreateFileW(file_path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file_handle == INVALID_HANDLE_VALUE)
+#else
+	file_descriptor = open(file_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+
+	if (file_descriptor < 0)
+#endif
+	{
+		addon::log("Failed to open upload journal: " + file_path.string(), LOGLEVEL_WARNING);
+		return;
+	}
+
+	initialized.store(true);
+
+	flush_thread = std::thread(&UploadJournal::run, this);
+}
+
+void UploadJournal::release()
+{
+	stop_restore();
+
+	initialized.store(false);
+
+	buffer_cv.notify_all();
+
+	if (flush_thread.joinable())
+		flush_thread.join();
+
+	flush();
+
+#ifdef _WIN32
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file_handle);
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (file_descriptor >= 0)
+	{
+		close(file_descriptor);
+		file_descriptor = -1;
+	}
+#endif
+
+	pending_uploads.clear();
+}
+
+void UploadJournal::record_queued(UploadService service, const std::filesystem::path& evtc_file_path) { append("queued", service, evtc_file_path); }
+
+void UploadJournal::record_completed(UploadService service, const std::filesystem::path& evtc_file_path) { append("completed", service, evtc_file_path); }
+
+void UploadJournal::append(const std::string& action, UploadService service, const std::filesystem::path& evtc_file_path)
+{
+	if (!initialized.load())
+		return;
+
+	auto time = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	nlohmann::json record = { { "action", action }, { "service", get_service_name(service) }, { "path", to_utf8(evtc_file_path) }, { "time", time } };
+
+	std::lock_guard lock(buffer_mutex);
+	buffer += record.dump() + "\n";
+}
+
+void UploadJournal::load()
+{
+	pending_uploads.clear();
+
+	if (!std::filesystem::exists(file_path))
+		return;
+
+	std::map<std::pair<UploadService, std::filesystem::path>, int64_t> pending;
+
+	{
+		std::ifstream file(file_path, std::ios::binary);
+
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open journal file");
+
+		std::string line;
+
+		while (std::getline(file, line))
+		{
+			try
+			{
+				auto record = nlohmann::json::parse(line);
+
+				auto service = record.at("service").get<std::string>() == "wingman" ? UploadService::WINGMAN : UploadService::DPS_REPORT;
+				auto key = std::make_pair(service, from_utf8(record.at("path").get<std::string>()));
+
+				if (record.at("action").get<std::string>() == "queued")
+					pending[key] = record.value("time", int64_t(0));
+				else
+					pending.erase(key);
+			}
+			catch (const nlohmann::json::exception&)
+			{
+				// torn record from a crash while writing, everything before it is intact
+			}
+		}
+	}
+
+	auto min_time = std::chrono::duration_cast<std::chrono::seconds>((std::chrono::system_clock::now() - MAX_PENDING_AGE).time_since_epoch()).count();
+
+	// compact the journal so it only contains the uploads that are still pending
+	auto temp_file_path = file_path;
+	temp_file_path += ".tmp";
+
+	{
+		std::ofstream temp_file(temp_file_path, std::ios::binary | std::ios::trunc);
+
+		if (!temp_file.is_open())
+			throw std::runtime_error("Failed to write compacted journal file");
+
+		for (const auto& [key, time] : pending)
+		{
+			if (time < min_time)
+				continue;
+
+			nlohmann::json record = { { "action", "queued" }, { "service", get_service_name(key.first) }, { "path", to_utf8(key.second) }, { "time", time } };
+			temp_file << record.dump() << "\n";
+
+			pending_uploads.push_back(key);
+		}
+	}
+
+	std::filesystem::rename(temp_file_path, file_path);
+}
+
+void UploadJournal::flush()
+{
+	std::string data;
+
+	{
+		std::lock_guard lock(buffer_mutex);
+		std::swap(data, buffer);
+	}
+
+#ifdef _WIN32
+	if (data.empty() || file_handle == INVALID_HANDLE_VALUE)
+		return;
+
+	DWORD bytes_written = 0;
+
+	if (!WriteFile(file_handle, data.data(), static_cast<DWORD>(data.size()), &bytes_written, nullptr) || bytes_written != data.size())
+	{
+		addon::log("Failed to write upload journal", LOGLEVEL_WARNING);
+		return;
+	}
+
+	FlushFileBuffers(file_handle);
+#else
+	if (data.empty() || file_descriptor < 0)
+		return;
+
+	if (write(file_descriptor, data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+	{
+		addon::log("Failed to write upload journal", LOGLEVEL_WARNING);
+		return;
+	}
+
+	fsync(file_descriptor);
+#endif
+}
+
+void UploadJournal::run()
+{
+	while (initialized.load())
+	{
+		{
+			std::unique_lock lock(buffer_mutex);
+			buffer_cv.wait_for(lock, FLUSH_INTERVAL, [&]() { return !initialized.load(); });
+		}
+
+		flush();
+	}
+}
+
+void UploadJournal::restore()
+{
+	if (pending_uploads.empty() || restore_thread.joinable())
+		return;
+
+	restore_thread = std::thread(&UploadJournal::run_restore, this, restore_stop_source.get_token());
+}
+
+void UploadJournal::stop_restore()
+{
+	restore_stop_source.request_stop();
+
+	if (restore_thread.joinable())
+		restore_thread.join();
+}
+
+void UploadJournal::run_restore(std::stop_token stop_token)
+{
+	std::map<std::filesystem::path, std::vector<UploadService>> uploads_by_file;
+
+	for (const auto& [service, evtc_file_path] : pending_uploads)
+		uploads_by_file[evtc_file_path].push_back(service);
+
+	pending_uploads.clear();
+
+	auto restored = 0;
+
+	for (const auto& [evtc_file_path, services] : uploads_by_file)
+	{
+		// the remaining uploads stay pending in the journal and are restored on the next load
+		if (stop_token.stop_requested())
+			break;
+
+		std::shared_ptr<Log> log;
+
+		if (std::filesystem::exists(evtc_file_path))
+			log = addon::log_manager->add_log(evtc_file_path);
+
+		if (!log)
+		{
+			for (auto service : services)
+				record_completed(service, evtc_file_path);
+
+			continue;
+		}
+
+		for (auto service : services)
+		{
+			if (service == UploadService::DPS_REPORT)
+			{
+				std::shared_lock lock(log->mutex);
+				auto available = log->dps_report_upload.status == UploadStatus::AVAILABLE;
+				lock.unlock();
+
+				// auto upload may already have queued it
+				if (available)
+					addon::dps_report_uploader->add_log(log);
+			}
+			else
+				addon::wingman_uploader->resume_upload(log);
+
+			++restored;
+		}
+	}
+
+	addon::log("Restored " + std::to_string(restored) + " pending uploads", LOGLEVEL_INFO);
+}
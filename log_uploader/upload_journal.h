@@ -0,0 +1,68 @@
+#pragma once
+
+#include "module.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class UploadService
+{
+	DPS_REPORT,
+	WINGMAN
+};
+
+// write-ahead journal of queued uploads, logs still pending when the addon unloads or crashes are queued again on the next load
+class UploadJournal
+{
+public:
+	void initialize();
+	void release();
+
+	void record_queued(UploadService service, const std::filesystem::path& evtc_file_path);
+	void record_completed(UploadService service, const std::filesystem::path& evtc_file_path);
+
+	// re-adds the logs of all uploads that were pending when the journal was loaded, in the background as adding a log hashes its evtc file
+	void restore();
+	// stops restoring before the modules it adds the logs to are released
+	void stop_restore();
+
+private:
+	std::filesystem::path file_path;
+#ifdef _WIN32
+	HANDLE file_handle = INVALID_HANDLE_VALUE;
+#else
+	int file_descriptor = -1;
+#endif
+
+	std::vector<std::pair<UploadService, std::filesystem::path>> pending_uploads;
+
+	// records are buffered and written with a single flush per interval
+	std::mutex buffer_mutex;
+	std::condition_variable buffer_cv;
+	std::string buffer;
+
+	std::thread flush_thread;
+	std::atomic<bool> initialized = false;
+
+	std::thread restore_thread;
+	std::stop_source restore_stop_source;
+
+	void append(const std::string& action, UploadService service, const std::filesystem::path& evtc_file_path);
+	void load();
+	void flush();
+	void run();
+	void run_restore(std::stop_token stop_token);
+};
+
+DECLARE_MODULE(UploadJournal, upload_journal)
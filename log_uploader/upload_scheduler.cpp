@@ -0,0 +1,134 @@
+#include "upload_scheduler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <random>
+#include <sstream>
+
+bool is_transient_status(long status_code)
+{
+	switch (status_code)
+	{
+	case 0: // timeout or connection error
+	case 408:
+	case 425:
+	case 429:
+	case 500:
+	case 502:
+	case 503:
+	case 504:
+		return true;
+	default:
+		return false;
+	}
+}
+
+std::optional<std::chrono::seconds> parse_retry_after(const cpr::Response& response)
+{
+	auto it = response.header.find("Retry-After");
+
+	if (it == response.header.end() || it->second.empty())
+		return std::nullopt;
+
+	const auto& value = it->second;
+
+	// delays beyond a day are treated as malformed, they would overflow the scheduling time points
+	static constexpr auto max_retry_after = std::chrono::hours(24);
+
+	if (std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); }))
+	{
+		long long seconds = 0;
+		auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), seconds);
+
+		if (error != std::errc() || end != value.data() + value.size() || std::chrono::seconds(seconds) > max_retry_after)
+			return std::nullopt;
+
+		return std::chrono::seconds(seconds);
+	}
+
+	// http date, e.g. "Wed, 21 Oct 2015 07:28:00 GMT"
+	std::istringstream ss(value);
+	std::chrono::sys_seconds time_point;
+	ss >> std::chrono::parse("%a, %d %b %Y %T GMT", time_point);
+
+	if (ss.fail())
+		return std::nullopt;
+
+	auto delay = std::chrono::duration_cast<std::chrono::seconds>(time_point - std::chrono::system_clock::now());
+
+	if (delay > max_retry_after)
+		return std::nullopt;
+
+	return std::max(delay, std::chrono::seconds(0));
+}
+
+void TokenBucket::refill(std::chrono::steady_clock::time_point now)
+{
+	auto elapsed = std::chrono::duration<double>(now - last_refill).count();
+
+	if (elapsed > 0)
+	{
+		tokens = std::min(capacity, tokens + elapsed * tokens_per_second);
+		last_refill = now;
+	}
+}
+
+std::chrono::steady_clock::time_point TokenBucket::get_available_time(std::chrono::steady_clock::time_point now)
+{
+	refill(now);
+
+	auto available_time = now;
+
+	if (tokens < 1.0)
+		available_time += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((1.0 - tokens) / tokens_per_second));
+
+	return std::max(available_time, blocked_until);
+}
+
+void TokenBucket::consume(std::chrono::steady_clock::time_point now)
+{
+	refill(now);
+	tokens = std::max(tokens - 1.0, 0.0);
+}
+
+void TokenBucket::block_until(std::chrono::steady_clock::time_point time_point)
+{
+	blocked_until = std::max(blocked_until, time_point);
+
+	// the server asked us to back off, do not burst afterwards
+	tokens = 0.0;
+}
+
+void CircuitBreaker::record_success()
+{
+	consecutive_failures = 0;
+	open_until = {};
+}
+
+void CircuitBreaker::record_failure(std::chrono::steady_clock::time_point now)
+{
+	++consecutive_failures;
+
+	if (!is_tripped())
+		return;
+
+	// every failed trial doubles the pause, capped at 16x the cooldown
+	auto exponent = std::min(consecutive_failures - failure_threshold, 4);
+	open_until = now + cooldown * (1 << exponent);
+}
+
+std::chrono::milliseconds RetryPolicy::get_delay(int attempt, std::optional<std::chrono::seconds> retry_after) const
+{
+	if (retry_after.has_value())
+		return std::chrono::duration_cast<std::chrono::milliseconds>(retry_after.value());
+
+	auto exponent = std::clamp(attempt - 1, 0, 16);
+	auto delay = std::min<std::chrono::milliseconds>(base_delay * (1ll << exponent), max_delay);
+
+	// equal jitter, keeps at least half of the delay while spreading retries of concurrent workers
+	thread_local std::mt19937 generator(std::random_device{}());
+	std::uniform_int_distribution<long long> distribution(0, delay.count() / 2);
+
+	return delay / 2 + std::chrono::milliseconds(distribution(generator));
+}
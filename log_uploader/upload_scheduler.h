@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cpr/cpr.h>
+
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+// failure that is expected to resolve on its own (timeouts, rate limits, server errors) and is retried automatically
+class TransientUploadError : public std::runtime_error
+{
+public:
+	TransientUploadError(const std::string& message, std::optional<std::chrono::seconds> retry_after = std::nullopt) : std::runtime_error(message), retry_after(retry_after) {}
+
+	std::optional<std::chrono::seconds> retry_after;
+};
+
+// thrown when an upload was cancelled from the logs table or its uploader was released
+class UploadCancelled : public std::runtime_error
+{
+public:
+	UploadCancelled() : std::runtime_error("Cancelled") {}
+};
+
+bool is_transient_status(long status_code);
+std::optional<std::chrono::seconds> parse_retry_after(const cpr::Response& response);
+
+// rate limiter for a single endpoint, not synchronized, guarded by the owning uploader's queue mutex
+class TokenBucket
+{
+public:
+	TokenBucket(double capacity, double tokens_per_second) : capacity(capacity), tokens_per_second(tokens_per_second), tokens(capacity) {}
+
+	std::chrono::steady_clock::time_point get_available_time(std::chrono::steady_clock::time_point now);
+	void consume(std::chrono::steady_clock::time_point now);
+
+	// used for Retry-After, no tokens are handed out before the given time
+	void block_until(std::chrono::steady_clock::time_point time_point);
+
+private:
+	double capacity;
+	double tokens_per_second;
+	double tokens;
+
+	std::chrono::steady_clock::time_point last_refill = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point blocked_until{};
+
+	void refill(std::chrono::steady_clock::time_point now);
+};
+
+// pauses an uploader after consecutive transient failures, not synchronized, guarded by the owning uploader's queue mutex
+class CircuitBreaker
+{
+public:
+	CircuitBreaker(int failure_threshold, std::chrono::seconds cooldown) : failure_threshold(failure_threshold), cooldown(cooldown) {}
+
+	// while tripped only a single trial upload may be in flight until one succeeds
+	bool is_tripped() const { return consecutive_failures >= failure_threshold; }
+
+	std::chrono::steady_clock::time_point get_open_until() const { return open_until; }
+
+	void record_success();
+	void record_failure(std::chrono::steady_clock::time_point now);
+
+private:
+	int failure_threshold;
+	std::chrono::seconds cooldown;
+
+	int consecutive_failures = 0;
+	std::chrono::steady_clock::time_point open_until{};
+};
+
+class RetryPolicy
+{
+public:
+	int max_attempts = 5;
+
+	std::chrono::milliseconds base_delay = std::chrono::seconds(5);
+	std::chrono::milliseconds max_delay = std::chrono::minutes(5);
+
+	// exponential backoff with jitter, a server provided Retry-After takes precedence
+	std::chrono::milliseconds get_delay(int attempt, std::optional<std::chrono::seconds> retry_after) const;
+};
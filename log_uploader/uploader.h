@@ -2,31 +2,64 @@
 
 #include "log.h"
 #include "module.h"
+#include "settings.h"
+#include "statistics.h"
+#include "tracing.h"
+#include "upload_scheduler.h"
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
+
+// a log in the upload queues together with the cancellation of the upload it was queued for. cancelling the upload or queueing the log again makes the entry
+// stale, workers drop stale entries without touching the upload state or the journal
+class UploadJob
+{
+public:
+	std::shared_ptr<Log> log;
+	std::stop_source cancellation;
+
+	// checkUpload already passed for this upload, the uploader does not repeat it
+	bool prechecked = false;
+
+	explicit operator bool() const { return log != nullptr; }
+
+	// called with the current cancellation of the log while holding its mutex
+	bool is_current(const std::stop_source& current_cancellation) const { return cancellation == current_cancellation && !cancellation.stop_requested(); }
+};
 
 class Uploader
 {
 public:
-	Uploader() = default;
+	Uploader(TokenBucket rate_limiter, PipelineQueue queue) : queue(queue), rate_limiter(rate_limiter) {}
 	~Uploader() = default;
 
 	virtual void add_log(std::shared_ptr<Log> log) = 0;
 
-	void initialize()
+	// cancels a queued or running upload of the log, the log becomes available for upload again
+	virtual void cancel(std::shared_ptr<Log> log) = 0;
+
+	virtual void initialize()
 	{
 		initialized.store(true);
-		upload_thread = std::thread(&Uploader::run, this);
+
+		for (size_t i = 0; i < get_worker_count(); ++i)
+			upload_threads.emplace_back(&Uploader::run, this);
 	}
 
 	void clear_upload_queue()
 	{
 		std::lock_guard lock(this->upload_queue_mutex);
-		std::queue<std::shared_ptr<Log>> empty;
+		std::queue<UploadJob> empty;
 		std::swap(upload_queue, empty);
+		retry_queue.clear();
+		update_queue_depth();
 	}
 
-	void release()
+	virtual void release()
 	{
 		initialized.store(false);
 
@@ -34,19 +67,252 @@ public:
 
 		upload_cv.notify_all();
 
-		if (this->upload_thread.joinable())
-			this->upload_thread.join();
+		for (auto& upload_thread : this->upload_threads)
+			if (upload_thread.joinable())
+				upload_thread.join();
+
+		this->upload_threads.clear();
 	}
 
 protected:
 	std::condition_variable upload_cv;
 
 	std::mutex upload_queue_mutex;
-	std::queue<std::shared_ptr<Log>> upload_queue;
+	std::queue<UploadJob> upload_queue;
 
-	std::thread upload_thread;
+	std::vector<std::thread> upload_threads;
 
 	std::atomic<bool> initialized = false;
 
+	// number of uploads currently taken from the queue, guarded by upload_queue_mutex
+	size_t active_uploads = 0;
+
+	// logs waiting for their next attempt, guarded by upload_queue_mutex
+	std::multimap<std::chrono::steady_clock::time_point, UploadJob> retry_queue;
+
+	// logs waiting in the upload and retry queues are reported to the statistics as this queue
+	const PipelineQueue queue;
+
+	// must be called under upload_queue_mutex after the upload or retry queue changed
+	void update_queue_depth() { addon::statistics->set_queue_depth(queue, upload_queue.size() + retry_queue.size()); }
+
+	// scheduling state of the upload endpoint, guarded by upload_queue_mutex
+	TokenBucket rate_limiter;
+	CircuitBreaker circuit_breaker = CircuitBreaker(3, std::chrono::seconds(60));
+	RetryPolicy retry_policy;
+
+	// number of worker threads started by initialize, each running its own run loop
+	virtual size_t get_worker_count() const { return 1; }
+
+	// maximum number of uploads in flight at once, evaluated under upload_queue_mutex
+	virtual size_t get_concurrency_limit() const { return get_worker_count(); }
+
+	// blocks until a log is available and the concurrency limit, rate limiter and circuit breaker allow another upload, returns an empty job when released.
+	// without take_token the rate limiter is left to acquire_token, logs resolved without a request then do not use up a token
+	UploadJob acquire_log(bool take_token = true)
+	{
+		TRACE_SCOPE("Uploader::acquire_log");
+
+		std::unique_lock upload_queue_lock(upload_queue_mutex);
+
+		while (initialized.load())
+		{
+			auto now = std::chrono::steady_clock::now();
+
+			while (!retry_queue.empty() && retry_queue.begin()->first <= now)
+			{
+				upload_queue.push(retry_queue.begin()->second);
+				retry_queue.erase(retry_queue.begin());
+			}
+
+			std::optional<std::chrono::steady_clock::time_point> wake_time;
+
+			if (!retry_queue.empty())
+				wake_time = retry_queue.begin()->first;
+
+			auto trial_in_flight = circuit_breaker.is_tripped() && active_uploads > 0;
+
+			if (!upload_queue.empty() && active_uploads < get_concurrency_limit() && !trial_in_flight)
+			{
+				auto ready_time = take_token ? std::max(rate_limiter.get_available_time(now), circuit_breaker.get_open_until()) : circuit_breaker.get_open_until();
+
+				if (ready_time <= now)
+				{
+					if (take_token)
+						rate_limiter.consume(now);
+
+					auto job = upload_queue.front();
+					upload_queue.pop();
+					++active_uploads;
+					update_queue_depth();
+
+					return job;
+				}
+
+				wake_time = wake_time.has_value() ? std::min(wake_time.value(), ready_time) : ready_time;
+			}
+
+			if (wake_time.has_value())
+				upload_cv.wait_until(upload_queue_lock, wake_time.value());
+			else
+				upload_cv.wait(upload_queue_lock);
+		}
+
+		return {};
+	}
+
+	// blocks until the rate limiter allows the upload of a log taken by acquire_log without a token, returns false once released
+	bool acquire_token() { return wait_for_token(false); }
+
+	// blocks until the rate limiter allows a request made beside the upload queue, such as a precheck. returns false right away while the circuit breaker is tripped,
+	// its single trial goes through the upload queue, and once released
+	bool acquire_request() { return wait_for_token(true); }
+
+	bool wait_for_token(bool fail_while_tripped)
+	{
+		std::unique_lock upload_queue_lock(upload_queue_mutex);
+
+		while (initialized.load())
+		{
+			if (fail_while_tripped && circuit_breaker.is_tripped())
+				return false;
+
+			auto now = std::chrono::steady_clock::now();
+			auto ready_time = rate_limiter.get_available_time(now);
+
+			if (ready_time <= now)
+			{
+				rate_limiter.consume(now);
+				return true;
+			}
+
+			upload_cv.wait_until(upload_queue_lock, ready_time);
+		}
+
+		return false;
+	}
+
+	// must be called once for every job returned by acquire_log
+	void release_log()
+	{
+		{
+			std::lock_guard upload_queue_lock(upload_queue_mutex);
+			--active_uploads;
+		}
+
+		upload_cv.notify_all();
+	}
+
+	void record_success()
+	{
+		std::lock_guard upload_queue_lock(upload_queue_mutex);
+		circuit_breaker.record_success();
+	}
+
+	// returns the delay until the next attempt, or nullopt if the log has used up its attempts
+	std::optional<std::chrono::milliseconds> record_transient_failure(int attempts, std::optional<std::chrono::seconds> retry_after)
+	{
+		std::lock_guard upload_queue_lock(upload_queue_mutex);
+
+		record_failed_request(retry_after);
+
+		if (attempts >= retry_policy.max_attempts)
+			return std::nullopt;
+
+		return retry_policy.get_delay(attempts, retry_after);
+	}
+
+	// a transient failure of a request that is not an upload attempt, callers hold upload_queue_mutex
+	void record_failed_request(std::optional<std::chrono::seconds> retry_after)
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		circuit_breaker.record_failure(now);
+
+		if (retry_after.has_value())
+			rate_limiter.block_until(now + retry_after.value());
+	}
+
+	void schedule_retry(UploadJob job, std::chrono::milliseconds delay)
+	{
+		{
+			std::lock_guard upload_queue_lock(upload_queue_mutex);
+			retry_queue.emplace(std::chrono::steady_clock::now() + delay, std::move(job));
+			update_queue_depth();
+		}
+
+		upload_cv.notify_all();
+	}
+
+	bool is_cancelled(const std::stop_token& cancel_token) const { return cancel_token.stop_requested() || !initialized.load(); }
+
+	// transfers aborted by a cancel callback fail like a lost connection, this tells them apart
+	void throw_if_cancelled(const std::stop_token& cancel_token) const
+	{
+		if (is_cancelled(cancel_token))
+			throw UploadCancelled();
+	}
+
+	// aborts the transfer once the job is cancelled or the uploader released, curl calls it about once per second even while no data moves
+	cpr::ProgressCallback make_cancel_callback(std::stop_token cancel_token) const
+	{
+		return cpr::ProgressCallback([this, cancel_token](cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t, intptr_t) -> bool { return !is_cancelled(cancel_token); });
+	}
+
+	// keeps track of transfers in flight across all uploaders, the bandwidth cap is split between them
+	class Transfer
+	{
+	public:
+		Transfer() { ++transfers_in_flight; }
+		~Transfer() { --transfers_in_flight; }
+		Transfer(const Transfer&) = delete;
+		Transfer& operator=(const Transfer&) = delete;
+
+		cpr::LimitRate get_limit_rate() const
+		{
+			auto upload_rate_limit = addon::settings->read([](const SettingsData& settings) { return settings.general.upload_rate_limit; });
+
+			if (upload_rate_limit <= 0)
+				return cpr::LimitRate(0, 0);
+
+			auto transfers = std::max(transfers_in_flight.load(), 1);
+
+			return cpr::LimitRate(0, static_cast<std::int64_t>(upload_rate_limit) * 1024 / transfers);
+		}
+
+	private:
+		static inline std::atomic<int> transfers_in_flight = 0;
+	};
+
+	// writes the bytes sent by a transfer into the upload state returned by get_upload, view updates are throttled. aborts the transfer like make_cancel_callback
+	template <typename Accessor>
+	cpr::ProgressCallback make_progress_callback(std::shared_ptr<Log> log, Accessor get_upload, std::stop_token cancel_token) const
+	{
+		auto last_update = std::make_shared<std::chrono::steady_clock::time_point>();
+
+		return cpr::ProgressCallback([this, log, get_upload, last_update, cancel_token](cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t, cpr::cpr_pf_arg_t upload_total, cpr::cpr_pf_arg_t upload_now, intptr_t) -> bool {
+			if (is_cancelled(cancel_token))
+				return false;
+
+			if (upload_total <= 0)
+				return true;
+
+			auto now = std::chrono::steady_clock::now();
+
+			if (upload_now < upload_total && now - *last_update < std::chrono::milliseconds(100))
+				return true;
+
+			*last_update = now;
+
+			std::unique_lock lock(log->mutex);
+			Upload& upload = get_upload(*log);
+			upload.bytes_sent = static_cast<uint64_t>(upload_now);
+			upload.bytes_total = static_cast<uint64_t>(upload_total);
+			log->update_view();
+
+			return true;
+		});
+	}
+
 	virtual void run() = 0;
 };
\ No newline at end of file
@@ -1,16 +1,69 @@
 #include "wingman_uploader.h"
 #include "addon.h"
+#include "compression.h"
+#include "fingerprint_index.h"
+#include "parser.h"
 #include "settings.h"
+#include "statistics.h"
+#include "tracing.h"
+#include "upload_archives.h"
+#include "upload_journal.h"
 
 #include <cpr/cpr.h>
 
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <ctime>
+#endif
+
 IMPLEMENT_MODULE(WingmanUploader, wingman_uploader)
 
-#define CPR_PARAMETERS \
-	cpr::Timeout { std::chrono::seconds(180) }
-#define TEST_CONNECTION_URL "https://gw2wingman.nevermindcreations.de/testConnection"
-#define CHECK_UPLOAD_URL "https://gw2wingman.nevermindcreations.de/checkUpload"
-#define UPLOAD_PROCESSED_URL "https://gw2wingman.nevermindcreations.de/uploadProcessed"
+// uploads throttled by the bandwidth cap take as long as they take, only a transfer that stalls or a response that does not come is given up on
+#define CPR_PARAMETERS cpr::ConnectTimeout(std::chrono::seconds(30)), cpr::LowSpeed(1, 180)
+#define CHECK_CPR_PARAMETERS \
+	cpr::Timeout { std::chrono::seconds(30) }
+#define TEST_CONNECTION_PATH "/testConnection"
+#define CHECK_UPLOAD_PATH "/checkUpload"
+#define UPLOAD_PROCESSED_PATH "/uploadProcessed"
+
+void WingmanUploader::initialize()
+{
+	Uploader::initialize();
+
+	for (size_t i = 0; i < max_concurrent_prechecks; ++i)
+		precheck_threads.emplace_back(&WingmanUploader::run_precheck, this);
+}
+
+void WingmanUploader::release()
+{
+	Uploader::release();
+
+	{
+		std::lock_guard lock(precheck_queue_mutex);
+		std::queue<UploadJob> empty;
+		std::swap(precheck_queue, empty);
+		addon::statistics->set_queue_depth(PipelineQueue::WINGMAN_PRECHECK, 0);
+		report_pending_logs.clear();
+	}
+
+	precheck_cv.notify_all();
+
+	for (auto& precheck_thread : precheck_threads)
+		if (precheck_thread.joinable())
+			precheck_thread.join();
+
+	precheck_threads.clear();
+
+	// their uploads stay pending in the journal and are restored on the next load
+	{
+		std::lock_guard resumed_logs_lock(resumed_logs_mutex);
+		resumed_logs.clear();
+	}
+
+	// the prechecks requesting checks are stopped, a running check is aborted by the release
+	if (availability_thread.joinable())
+		availability_thread.join();
+}
 
 void WingmanUploader::add_log(std::shared_ptr<Log> log)
 {
@@ -27,19 +80,67 @@ void WingmanUploader::add_log(std::shared_ptr<Log> log)
 	}
 
 	log->wingman_upload.status = UploadStatus::QUEUED;
+	log->wingman_upload.attempts = 0;
+	log->wingman_upload.error_message.reset();
+	log->wingman_cancellation = std::stop_source();
+	log->wingman_upload.next_retry_time.reset();
+	addon::statistics->record_stage(log->pipeline_times, PipelineStage::WINGMAN_QUEUED);
 
 	log->update_view();
 
+	addon::upload_journal->record_queued(UploadService::WINGMAN, log->evtc_file_path);
+
+	// logs parsed in json mode have no html report yet, the upload continues in report_ready
+	if (!log->parser_data.has_report())
+	{
+		{
+			std::lock_guard precheck_queue_lock(precheck_queue_mutex);
+			report_pending_logs.insert(log);
+		}
+
+		lock.unlock();
+
+		if (!addon::parser->generate_report(log, false))
+			report_ready(log, "Parser unavailable");
+
+		return;
+	}
+
 	{
-		std::unique_lock upload_queue_lock(upload_queue_mutex);
-		this->upload_queue.push(log);
-		this->upload_cv.notify_one();
+		std::unique_lock precheck_queue_lock(precheck_queue_mutex);
+		this->precheck_queue.push(UploadJob{ log, log->wingman_cancellation });
+		addon::statistics->set_queue_depth(PipelineQueue::WINGMAN_PRECHECK, precheck_queue.size());
+		this->precheck_cv.notify_one();
 	}
 }
 
 void WingmanUploader::process_auto_upload(std::shared_ptr<Log> log)
 {
-	auto settings = addon::settings->get().wingman;
+	{
+		std::shared_lock lock(log->mutex);
+		auto parsed = log->parser_data.status == ParseStatus::PARSED;
+		lock.unlock();
+
+		// Elite Insights reported a failure, a restored upload of the log has nothing to upload
+		if (!parsed)
+		{
+			drop_resumed_upload(log);
+			return;
+		}
+	}
+
+	{
+		std::unique_lock resumed_logs_lock(resumed_logs_mutex);
+
+		if (resumed_logs.erase(log) > 0)
+		{
+			resumed_logs_lock.unlock();
+			this->add_log(log);
+			return;
+		}
+	}
+
+	auto settings = addon::settings->read([](const SettingsData& s) { return s.wingman; });
 
 	if (!settings.auto_upload)
 		return;
@@ -48,59 +149,351 @@ void WingmanUploader::process_auto_upload(std::shared_ptr<Log> log)
 
 	auto log_trigger_id = log->trigger_id;
 
-	if (log->parser_data.status != ParseStatus::PARSED || (settings.auto_upload_filter == AutoUploadFilter::SUCCESSFUL_ONLY && !log->parser_data.encounter.success))
+	// only logs never queued for Wingman, reports generated later pass through here again
+	if (log->wingman_upload.status != UploadStatus::AVAILABLE || log->parser_data.status != ParseStatus::PARSED || (settings.auto_upload_filter == AutoUploadFilter::SUCCESSFUL_ONLY && !log->parser_data.encounter.success))
 		return;
 
 	lock.unlock();
 
-	bool is_in_filter = std::find(settings.auto_upload_encounters.begin(), settings.auto_upload_encounters.end(), log_trigger_id) != settings.auto_upload_encounters.end();
+	if (is_encounter_selected(settings.auto_upload_encounters, log_trigger_id))
+		this->add_log(log);
+}
+
+void WingmanUploader::resume_upload(std::shared_ptr<Log> log)
+{
+	std::shared_lock lock(log->mutex);
+	auto parse_status = log->parser_data.status;
+	lock.unlock();
 
-	if (is_in_filter)
+	if (parse_status == ParseStatus::PARSED)
+	{
 		this->add_log(log);
+		return;
+	}
+
+	if (parse_status == ParseStatus::FAILED)
+	{
+		addon::upload_journal->record_completed(UploadService::WINGMAN, log->evtc_file_path);
+		return;
+	}
+
+	{
+		std::lock_guard resumed_logs_lock(resumed_logs_mutex);
+		resumed_logs.insert(log);
+	}
+
+	if (parse_status == ParseStatus::UNPARSED)
+		addon::parser->add_log(log);
 }
 
-void WingmanUploader::run()
+void WingmanUploader::drop_resumed_upload(std::shared_ptr<Log> log)
 {
-	addon::log("Starting Wingman uploader", LOGLEVEL_DEBUG);
+	{
+		std::lock_guard resumed_logs_lock(resumed_logs_mutex);
+
+		if (resumed_logs.erase(log) == 0)
+			return;
+	}
+
+	addon::upload_journal->record_completed(UploadService::WINGMAN, log->evtc_file_path);
+	addon::log("Dropped restored Wingman upload, the log was not parsed: " + log->id, LOGLEVEL_INFO);
+}
+
+bool WingmanUploader::needs_report(std::shared_ptr<Log> log)
+{
+	{
+		std::lock_guard resumed_logs_lock(resumed_logs_mutex);
+
+		if (resumed_logs.contains(log))
+			return true;
+	}
+
+	auto settings = addon::settings->read([](const SettingsData& s) { return s.wingman; });
+
+	if (!settings.auto_upload)
+		return false;
+
+	std::shared_lock lock(log->mutex);
+
+	// the success filter is only known after parsing, failed attempts get a report they may not need
+	return is_encounter_selected(settings.auto_upload_encounters, log->trigger_id);
+}
+
+void WingmanUploader::report_ready(std::shared_ptr<Log> log, std::optional<std::string> error_message)
+{
+	{
+		std::lock_guard precheck_queue_lock(precheck_queue_mutex);
+
+		if (report_pending_logs.erase(log) == 0)
+			return;
+	}
+
+	std::unique_lock lock(log->mutex);
+
+	// cancelled while the report was generated
+	if (log->wingman_upload.status != UploadStatus::QUEUED)
+		return;
+
+	auto id = log->id;
+
+	if (error_message.has_value())
+	{
+		log->wingman_upload.status = UploadStatus::FAILED;
+		log->wingman_upload.error_message = "Failed to generate report: " + error_message.value();
+		log->update_view();
+
+		lock.unlock();
+
+		addon::upload_journal->record_completed(UploadService::WINGMAN, log->evtc_file_path);
+		addon::upload_archives->release_log(log);
+
+		addon::log("Wingman upload failed: " + id + ". Error: " + error_message.value(), LOGLEVEL_WARNING);
+		return;
+	}
+
+	{
+		std::unique_lock precheck_queue_lock(precheck_queue_mutex);
+		this->precheck_queue.push(UploadJob{ log, log->wingman_cancellation });
+		addon::statistics->set_queue_depth(PipelineQueue::WINGMAN_PRECHECK, precheck_queue.size());
+		this->precheck_cv.notify_one();
+	}
+}
+
+void WingmanUploader::cancel(std::shared_ptr<Log> log)
+{
+	std::unique_lock lock(log->mutex);
+
+	auto status = log->wingman_upload.status;
+
+	if (status != UploadStatus::QUEUED && status != UploadStatus::UPLOADING)
+		return;
+
+	log->wingman_cancellation.request_stop();
+
+	// running uploads are reset by their worker once the transfer was aborted
+	if (status == UploadStatus::UPLOADING)
+		return;
+
+	log->wingman_upload.status = UploadStatus::AVAILABLE;
+	log->wingman_upload.next_retry_time.reset();
+	log->wingman_upload.error_message = "Cancelled";
+	log->update_view();
+
+	lock.unlock();
+
+	addon::upload_journal->record_completed(UploadService::WINGMAN, log->evtc_file_path);
+	addon::upload_archives->release_log(log);
+}
+
+void WingmanUploader::run_precheck()
+{
+	TRACE_THREAD("Wingman precheck");
 
 	while (true)
 	{
-		std::unique_lock upload_queue_lock(upload_queue_mutex);
+		std::unique_lock precheck_queue_lock(precheck_queue_mutex);
 
-		upload_cv.wait(upload_queue_lock, [&]() { return !upload_queue.empty() || !initialized.load(); });
+		{
+			TRACE_SCOPE("WingmanUploader::run_precheck wait queue");
+			precheck_cv.wait(precheck_queue_lock, [&]() { return !precheck_queue.empty() || !initialized.load(); });
+		}
 
 		if (!initialized.load())
 			break;
 
-		auto log = upload_queue.front();
-		upload_queue.pop();
+		auto job = precheck_queue.front();
+		precheck_queue.pop();
+		addon::statistics->set_queue_depth(PipelineQueue::WINGMAN_PRECHECK, precheck_queue.size());
+
+		precheck_queue_lock.unlock();
 
-		upload_queue_lock.unlock();
+		TRACE_SCOPE("WingmanUploader::run_precheck");
 
-		std::unique_lock lock(log->mutex);
+		const auto& log = job.log;
 
-		if (log->parser_data.status != ParseStatus::PARSED || log->wingman_upload.status != UploadStatus::QUEUED)
+		std::unique_lock lock(log->mutex, std::defer_lock);
+		traced_lock(lock, "WingmanUploader::run_precheck wait log");
+
+		if (!job.is_current(log->wingman_cancellation) || log->wingman_upload.status != UploadStatus::QUEUED)
+			continue;
+
+		auto id = log->id;
+		auto log_data = log->get_data();
+		auto cancel_token = log->wingman_cancellation.get_token();
+
+		lock.unlock();
+
+		try
+		{
+			// duplicates known to the fingerprint index need neither a request nor a token
+			auto exists = addon::fingerprint_index->contains_wingman_upload(log_data.get_fingerprint());
+
+			if (!exists)
+			{
+				// prechecks count towards the rate limit of the uploads, while the circuit breaker is tripped the log is handed on unchecked and checked by its upload
+				if (!this->acquire_request())
+				{
+					if (is_cancelled(cancel_token))
+						continue;
+
+					throw std::runtime_error("Circuit breaker tripped");
+				}
+
+				throw_if_cancelled(cancel_token);
+
+				exists = !this->check_upload(log_data, cancel_token);
+				this->record_success();
+			}
+
+			if (exists)
+			{
+				lock.lock();
+
+				// cancelled during the check
+				if (!job.is_current(log->wingman_cancellation) || log->wingman_upload.status != UploadStatus::QUEUED)
+					continue;
+
+				log->wingman_upload.status = UploadStatus::SKIPPED;
+				log->wingman_upload.error_message = "Log already exists";
+				log->update_view();
+
+				lock.unlock();
+
+				addon::upload_journal->record_completed(UploadService::WINGMAN, log_data.evtc_file_path);
+				addon::upload_archives->release_log(log);
+
+				addon::log("Wingman upload skipped, log already exists: " + id, LOGLEVEL_INFO);
+				continue;
+			}
+
+			job.prechecked = true;
+		}
+		catch (const UploadCancelled&)
+		{
+			continue;
+		}
+		catch (const TransientUploadError& e)
+		{
+			// counts towards the circuit breaker like a failed upload, the uploader repeats the check and takes care of retries
+			{
+				std::lock_guard upload_queue_lock(upload_queue_mutex);
+				record_failed_request(e.retry_after);
+			}
+
+			addon::log(LOGLEVEL_DEBUG, "Wingman precheck failed: {}. Error: {}", id, e.what());
+		}
+		catch (const std::exception& e)
+		{
+			addon::log(LOGLEVEL_DEBUG, "Wingman precheck failed: {}. Error: {}", id, e.what());
+		}
+
+		{
+			std::lock_guard upload_queue_lock(upload_queue_mutex);
+			this->upload_queue.push(job);
+			update_queue_depth();
+		}
+
+		// prechecks wait on the same condition for the rate limiter, a single notification may wake one of them instead of an upload worker
+		this->upload_cv.notify_all();
+	}
+}
+
+void WingmanUploader::run()
+{
+	addon::log("Starting Wingman uploader", LOGLEVEL_DEBUG);
+
+	TRACE_THREAD("Wingman uploader");
+
+	while (true)
+	{
+		auto job = this->acquire_log();
+
+		if (!job)
+			break;
+
+		TRACE_SCOPE("WingmanUploader::run");
+
+		const auto& log = job.log;
+
+		std::unique_lock lock(log->mutex, std::defer_lock);
+		traced_lock(lock, "WingmanUploader::run wait log");
+
+		// cancelled while queued, cancel already made the log available and completed its journal entry. a log queued again has its own entry
+		if (!job.is_current(log->wingman_cancellation) || log->wingman_upload.status != UploadStatus::QUEUED)
+		{
+			lock.unlock();
+			this->release_log();
+			continue;
+		}
+
+		if (log->parser_data.status != ParseStatus::PARSED)
 		{
 			addon::log("Log unavailable for wingman upload: " + log->id, LOGLEVEL_WARNING);
 			log->wingman_upload.status = UploadStatus::FAILED;
+			log->update_view();
+			lock.unlock();
+
+			addon::upload_journal->record_completed(UploadService::WINGMAN, log->evtc_file_path);
+			addon::upload_archives->release_log(log);
+
+			this->release_log();
 			continue;
 		}
 
 		log->wingman_upload.status = UploadStatus::UPLOADING;
+		log->wingman_upload.next_retry_time.reset();
+		addon::statistics->record_stage(log->pipeline_times, PipelineStage::WINGMAN_STARTED);
 
 		log->update_view();
 
 		auto id = log->id;
 		auto log_data = log->get_data();
+		auto attempts = log->wingman_upload.attempts + 1;
+		auto cancel_token = log->wingman_cancellation.get_token();
 
 		lock.unlock();
 
+		// a retry repeats the check, the log may have been uploaded from elsewhere in the meantime
+		auto prechecked = std::exchange(job.prechecked, false);
+
 		WingmanUpload upload;
+		std::optional<std::chrono::milliseconds> retry_delay;
+		auto cancelled = false;
 
 		try
 		{
-			upload = this->upload(log_data);
-			addon::log("Wingman upload successful: " + id, LOGLEVEL_INFO);
+			upload = this->upload(log_data, prechecked, make_progress_callback(log, [](Log& l) -> Upload& { return l.wingman_upload; }, cancel_token), cancel_token);
+			this->record_success();
+
+			if (upload.status == UploadStatus::UPLOADED)
+			{
+				addon::fingerprint_index->record_wingman_upload(log_data.get_fingerprint());
+				addon::log("Wingman upload successful: " + id, LOGLEVEL_INFO);
+			}
+		}
+		catch (const UploadCancelled& e)
+		{
+			upload.status = UploadStatus::AVAILABLE;
+			upload.error_message = e.what();
+			cancelled = true;
+			addon::log("Wingman upload cancelled: " + id, LOGLEVEL_INFO);
+		}
+		catch (const TransientUploadError& e)
+		{
+			upload.error_message = e.what();
+			retry_delay = this->record_transient_failure(attempts, e.retry_after);
+
+			if (retry_delay.has_value())
+			{
+				upload.status = UploadStatus::QUEUED;
+				upload.next_retry_time = std::chrono::system_clock::now() + retry_delay.value();
+				addon::log("Wingman upload attempt " + std::to_string(attempts) + " failed: " + id + ", retrying in " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(retry_delay.value()).count()) + "s. Error: " + e.what(), LOGLEVEL_INFO);
+			}
+			else
+			{
+				upload.status = UploadStatus::FAILED;
+				addon::log("Wingman upload failed after " + std::to_string(attempts) + " attempts: " + id + ". Error: " + e.what(), LOGLEVEL_WARNING);
+			}
 		}
 		catch (const std::exception& e)
 		{
@@ -109,89 +502,110 @@ void WingmanUploader::run()
 			addon::log("Wingman upload failed: " + id + ". Error: " + e.what(), LOGLEVEL_WARNING);
 		}
 
+		upload.attempts = attempts;
+
 		lock.lock();
 
 		log->wingman_upload = upload;
+		if (upload.status == UploadStatus::UPLOADED)
+			addon::statistics->record_stage(log->pipeline_times, PipelineStage::WINGMAN_FINISHED);
 		log->update_view();
+		lock.unlock();
+
+		if (retry_delay.has_value())
+		{
+			this->schedule_retry(job, retry_delay.value());
+		}
+		// uploads interrupted by releasing the uploader stay in the journal and resume on the next start
+		else if (!cancelled || cancel_token.stop_requested())
+		{
+			addon::upload_journal->record_completed(UploadService::WINGMAN, log_data.evtc_file_path);
+			addon::upload_archives->release_log(log);
+		}
+
+		this->release_log();
 	}
 
 	addon::log("Wingman uploader stopped", LOGLEVEL_DEBUG);
 }
 
-WingmanUpload WingmanUploader::upload(LogData& log_data)
+WingmanUpload WingmanUploader::upload(LogData& log_data, bool prechecked, cpr::ProgressCallback progress_callback, std::stop_token cancel_token)
 {
-	auto settings = addon::settings->get().wingman;
-
 	WingmanUpload upload;
 	upload.status = UploadStatus::FAILED;
 
-	if (!std::filesystem::exists(log_data.evtc_file_path) || !std::filesystem::exists(log_data.parser_data.json_file_path) || !std::filesystem::exists(log_data.parser_data.html_file_path))
-		throw std::runtime_error("Missing required files for upload (evtc, json, html)");
+	// reports kept compressed at rest only exist as their gzip copy
+	auto report_exists = [](const std::filesystem::path& file_path, const std::filesystem::path& compressed_file_path) {
+		return (!file_path.empty() && std::filesystem::exists(file_path)) || (!compressed_file_path.empty() && std::filesystem::exists(compressed_file_path));
+	};
 
-	if (!this->get_server_availability())
-		throw std::runtime_error("Wingman servers unavailable");
+	if (!std::filesystem::exists(log_data.evtc_file_path) || !report_exists(log_data.parser_data.json_file_path, log_data.parser_data.compressed_json_file_path) ||
+		!report_exists(log_data.parser_data.html_file_path, log_data.parser_data.compressed_html_file_path))
+		throw std::runtime_error("Missing required files for upload (evtc, json, html)");
 
-	// check upload
+	if (!prechecked && !this->check_upload(log_data, cancel_token))
 	{
-		auto get_file_creation_time = [](std::filesystem::path file_path) // this should get the same result as the elite insights wingman uploader
-		{
-			WIN32_FILE_ATTRIBUTE_DATA file_info;
+		upload.status = UploadStatus::SKIPPED;
+		upload.error_message = "Log already exists";
+		return upload;
+	}
 
-			if (!GetFileAttributesExW(file_path.wstring().c_str(), GetFileExInfoStandard, &file_info))
-				throw std::runtime_error("Unable to get file attributes for " + file_path.string());
+	// upload processed
+	{
+		const auto& parser_data = log_data.parser_data;
 
-			FILETIME file_time = file_info.ftCreationTime;
-			SYSTEMTIME system_time;
-			SYSTEMTIME system_time_utc;
+		auto settings = addon::settings->get().wingman;
 
-			FileTimeToSystemTime(&file_time, &system_time_utc);
+		auto compressed = this->compression_supported.load() && settings.compress_uploads && !parser_data.compressed_json_file_path.empty() &&
+			!parser_data.compressed_html_file_path.empty() && std::filesystem::exists(parser_data.compressed_json_file_path) && std::filesystem::exists(parser_data.compressed_html_file_path);
 
-			SystemTimeToTzSpecificLocalTime(NULL, &system_time_utc, &system_time);
+		auto upload_file_path = addon::upload_archives->get_upload_file_path(log_data.evtc_file_path);
 
-			FILETIME local_file_time;
-			SystemTimeToFileTime(&system_time, &local_file_time);
+		auto add_report = [](cpr::Multipart& multipart, const std::string& name, const std::filesystem::path& file_path, const std::filesystem::path& compressed_file_path, bool compressed) {
+			auto file_name = file_path.empty() ? compressed_file_path.stem().string() : file_path.filename().string();
 
-			ULARGE_INTEGER ull;
-			ull.LowPart = local_file_time.dwLowDateTime;
-			ull.HighPart = local_file_time.dwHighDateTime;
+			if (compressed)
+				multipart.parts.emplace_back(name, cpr::Files { cpr::File(compressed_file_path.string(), file_name + ".gz") }, "application/gzip");
+			else if (!file_path.empty() && std::filesystem::exists(file_path))
+				multipart.parts.emplace_back(name, cpr::Files { cpr::File(file_path.string(), file_name) });
+			else
+			{
+				// the server does not take compressed reports but only the gzip copy is left on disk
+				auto content = gunzip_to_string(compressed_file_path);
+				multipart.parts.emplace_back(name, cpr::Buffer { content.begin(), content.end(), file_name });
+			}
+		};
 
-			constexpr uint64_t WINDOWS_TICK = 10000000ULL;
-			constexpr uint64_t EPOCH_DIFFERENCE = 11644473600ULL;
+		auto post = [&](bool compressed) {
+			cpr::Multipart multipart = { { "file", cpr::File(upload_file_path.string(), upload_file_path.filename().string()) }, { "account", parser_data.encounter.account_name } };
 
-			return (ull.QuadPart / WINDOWS_TICK) - EPOCH_DIFFERENCE;
-		};
+			add_report(multipart, "jsonfile", parser_data.json_file_path, parser_data.compressed_json_file_path, compressed);
+			add_report(multipart, "htmlfile", parser_data.html_file_path, parser_data.compressed_html_file_path, compressed);
 
-		auto file_size = std::filesystem::file_size(log_data.evtc_file_path);
-		auto file_creation_time = get_file_creation_time(log_data.evtc_file_path);
+			Transfer transfer;
 
-		cpr::Multipart multipart = { { "file", log_data.evtc_file_path.filename().string() }, { "timestamp", std::to_string(file_creation_time) }, { "filesize", std::to_string(file_size) }, { "account", log_data.parser_data.encounter.account_name },
-			{ "triggerID", std::to_string(static_cast<int>(log_data.trigger_id)) } };
+			return cpr::Post(cpr::Url(settings.server_url + UPLOAD_PROCESSED_PATH), CPR_PARAMETERS, multipart, transfer.get_limit_rate(), progress_callback);
+		};
 
-		auto response = cpr::Post(cpr::Url(CHECK_UPLOAD_URL), CPR_PARAMETERS, multipart);
+		auto response = post(compressed);
 
+		// a log cancelled after the server took it counts as uploaded, like on dps.report
 		if (response.status_code != 200)
-			throw std::runtime_error("Status " + std::to_string(response.status_code) + " on checkUpload");
+			throw_if_cancelled(cancel_token);
 
-		if (response.text == "Error")
-			throw std::runtime_error("Error on checkUpload");
-
-		if (response.text == "False")
+		// only an explicit rejection of the compressed reports (e.g. 415) resends them uncompressed, a 200 was handled by the server
+		if (compressed && response.status_code >= 400 && response.status_code < 500 && !is_transient_status(response.status_code))
 		{
-			upload.status = UploadStatus::SKIPPED;
-			upload.error_message = "Log already exists";
-			return upload;
-		}
+			addon::log("Wingman did not accept compressed reports, disabling compression. Status: " + std::to_string(response.status_code), LOGLEVEL_WARNING);
+			this->compression_supported.store(false);
+			response = post(false);
 
-		if (response.text != "True")
-			throw std::runtime_error("Unexpected response on checkUpload: " + response.text);
-	}
-
-	// upload processed
-	{
-		cpr::Multipart multipart = { { "file", cpr::File(log_data.evtc_file_path.string(), log_data.evtc_file_path.filename().string()) }, { "jsonfile", cpr::File(log_data.parser_data.json_file_path.string(), log_data.parser_data.json_file_path.filename().string()) },
-			{ "htmlfile", cpr::File(log_data.parser_data.html_file_path.string(), log_data.parser_data.html_file_path.filename().string()) }, { "account", log_data.parser_data.encounter.account_name } };
+			if (response.status_code != 200)
+				throw_if_cancelled(cancel_token);
+		}
 
-		auto response = cpr::Post(cpr::Url(UPLOAD_PROCESSED_URL), CPR_PARAMETERS, multipart);
+		if (is_transient_status(response.status_code))
+			throw TransientUploadError("Status " + std::to_string(response.status_code) + " on uploadProcessed", parse_retry_after(response));
 
 		if (response.status_code != 200)
 			throw std::runtime_error("Status " + std::to_string(response.status_code) + " on uploadProcessed");
@@ -205,26 +619,133 @@ WingmanUpload WingmanUploader::upload(LogData& log_data)
 	return upload;
 }
 
-bool WingmanUploader::get_server_availability()
+bool WingmanUploader::check_upload(LogData& log_data, std::stop_token cancel_token)
+{
+	if (!std::filesystem::exists(log_data.evtc_file_path))
+		throw std::runtime_error("Missing evtc file: " + log_data.evtc_file_path.string());
+
+	auto fingerprint = log_data.get_fingerprint();
+
+	if (addon::fingerprint_index->contains_wingman_upload(fingerprint))
+		return false;
+
+	if (!this->get_server_availability(cancel_token))
+	{
+		throw_if_cancelled(cancel_token);
+		throw TransientUploadError("Wingman servers unavailable");
+	}
+
+	auto get_file_creation_time = [](std::filesystem::path file_path) // this should get the same result as the elite insights wingman uploader
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA file_info;
+
+		if (!GetFileAttributesExW(file_path.wstring().c_str(), GetFileExInfoStandard, &file_info))
+			throw std::runtime_error("Unable to get file attributes for " + file_path.string());
+
+		FILETIME file_time = file_info.ftCreationTime;
+		SYSTEMTIME system_time;
+		SYSTEMTIME system_time_utc;
+
+		FileTimeToSystemTime(&file_time, &system_time_utc);
+
+		SystemTimeToTzSpecificLocalTime(NULL, &system_time_utc, &system_time);
+
+		FILETIME local_file_time;
+		SystemTimeToFileTime(&system_time, &local_file_time);
+
+		ULARGE_INTEGER ull;
+		ull.LowPart = local_file_time.dwLowDateTime;
+		ull.HighPart = local_file_time.dwHighDateTime;
+
+		constexpr uint64_t WINDOWS_TICK = 10000000ULL;
+		constexpr uint64_t EPOCH_DIFFERENCE = 11644473600ULL;
+
+		return (ull.QuadPart / WINDOWS_TICK) - EPOCH_DIFFERENCE;
+#else
+		// the creation time is not portable, arcdps never writes to a finished log so its last write time is the closest
+		struct stat file_status;
+
+		if (stat(file_path.c_str(), &file_status) != 0)
+			throw std::runtime_error("Unable to get file attributes for " + file_path.string());
+
+		tm local_time{};
+		localtime_r(&file_status.st_mtime, &local_time);
+
+		return static_cast<uint64_t>(file_status.st_mtime + local_time.tm_gmtoff);
+#endif
+	};
+
+	auto file_size = std::filesystem::file_size(log_data.evtc_file_path);
+	auto file_creation_time = get_file_creation_time(log_data.evtc_file_path);
+
+	cpr::Multipart multipart = { { "file", log_data.evtc_file_path.filename().string() }, { "timestamp", std::to_string(file_creation_time) }, { "filesize", std::to_string(file_size) }, { "account", log_data.parser_data.encounter.account_name },
+		{ "triggerID", std::to_string(static_cast<int>(log_data.trigger_id)) } };
+
+	auto response = cpr::Post(cpr::Url(addon::settings->get().wingman.server_url + CHECK_UPLOAD_PATH), CHECK_CPR_PARAMETERS, multipart, make_cancel_callback(cancel_token));
+	throw_if_cancelled(cancel_token);
+
+	if (is_transient_status(response.status_code))
+		throw TransientUploadError("Status " + std::to_string(response.status_code) + " on checkUpload", parse_retry_after(response));
+
+	if (response.status_code != 200)
+		throw std::runtime_error("Status " + std::to_string(response.status_code) + " on checkUpload");
+
+	if (response.text == "Error")
+		throw std::runtime_error("Error on checkUpload");
+
+	if (response.text == "False")
+	{
+		addon::fingerprint_index->record_wingman_upload(fingerprint);
+		return false;
+	}
+
+	if (response.text != "True")
+		throw std::runtime_error("Unexpected response on checkUpload: " + response.text);
+
+	return true;
+}
+
+bool WingmanUploader::get_server_availability(std::stop_token cancel_token)
 {
-	static std::chrono::system_clock::time_point last_check_time = std::chrono::system_clock::now();
 	static const std::chrono::seconds check_interval = std::chrono::seconds(180);
-	auto current_time = std::chrono::system_clock::now();
 
-	static auto servers_available_cached = false;
+	std::unique_lock lock(server_availability_mutex);
+
+	auto current_time = std::chrono::steady_clock::now();
 
-	if (!servers_available_cached || current_time - last_check_time > check_interval)
+	// concurrent prechecks share a single availability check instead of each sending their own
+	if (!availability_check_running && (!this->servers_available.load() || current_time - last_availability_check > check_interval))
 	{
-		last_check_time = current_time;
+		availability_check_running = true;
 
-		auto response = cpr::Get(cpr::Url(TEST_CONNECTION_URL), CPR_PARAMETERS);
+		// the previous check already finished
+		if (availability_thread.joinable())
+			availability_thread.join();
 
-		servers_available_cached = (response.status_code == 200 && response.text == "True");
+		availability_thread = std::thread(&WingmanUploader::check_server_availability, this);
+	}
+
+	// an available result is used while it is refreshed, an unavailable one has to wait for the check
+	if (!this->servers_available.load())
+		server_availability_cv.wait(lock, cancel_token, [&]() { return !availability_check_running; });
 
-		this->servers_available.store(servers_available_cached);
+	return this->servers_available.load();
+}
 
-		return servers_available_cached;
+void WingmanUploader::check_server_availability()
+{
+	TRACE_THREAD("Wingman availability check");
+
+	// shared by all prechecks, only releasing the uploader aborts it
+	auto response = cpr::Get(cpr::Url(addon::settings->get().wingman.server_url + TEST_CONNECTION_PATH), CHECK_CPR_PARAMETERS, make_cancel_callback(std::stop_token()));
+
+	{
+		std::lock_guard lock(server_availability_mutex);
+		this->servers_available.store(response.status_code == 200 && response.text == "True");
+		last_availability_check = std::chrono::steady_clock::now();
+		availability_check_running = false;
 	}
 
-	return servers_available_cached;
+	server_availability_cv.notify_all();
 }
@@ -2,21 +2,75 @@
 
 #include "uploader.h"
 
+#include <condition_variable>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
 class WingmanUploader : public Uploader
 {
 public:
+	WingmanUploader() : Uploader(TokenBucket(5, 0.2), PipelineQueue::WINGMAN) {}
+
+	void initialize() override;
+	void release() override;
+
 	void add_log(std::shared_ptr<Log> log) override;
+	void cancel(std::shared_ptr<Log> log) override;
 
 	void process_auto_upload(std::shared_ptr<Log> log);
 
+	// queues a restored upload, unparsed logs are uploaded once parsing completes regardless of the auto upload settings
+	void resume_upload(std::shared_ptr<Log> log);
+
+	// forgets a restored upload waiting for a parse that failed or was cancelled, it is completed in the journal as well
+	void drop_resumed_upload(std::shared_ptr<Log> log);
+
+	// whether an upload of the log is expected once it is parsed, its html report is then generated with the parse
+	bool needs_report(std::shared_ptr<Log> log);
+
+	// called by the parser once a report generation finished, continues the upload waiting for it
+	void report_ready(std::shared_ptr<Log> log, std::optional<std::string> error_message);
+
 	std::atomic<bool> servers_available = false;
 
+	static constexpr size_t max_concurrent_prechecks = 4;
+
 private:
 	void run() override;
 
-	WingmanUpload upload(LogData& log_data);
+	// checkUpload runs for queued logs ahead of the uploadProcessed of the current one
+	void run_precheck();
+
+	WingmanUpload upload(LogData& log_data, bool prechecked, cpr::ProgressCallback progress_callback, std::stop_token cancel_token);
+
+	// returns false if the log is already known to Wingman
+	bool check_upload(LogData& log_data, std::stop_token cancel_token);
+
+	// the result of testConnection is cached, a stale available result is refreshed in the background while callers keep using it
+	bool get_server_availability(std::stop_token cancel_token);
+	void check_server_availability();
+
+	std::condition_variable precheck_cv;
+	std::mutex precheck_queue_mutex;
+	std::queue<UploadJob> precheck_queue;
+	std::vector<std::thread> precheck_threads;
+
+	// queued logs waiting for the parser to generate their html report, guarded by precheck_queue_mutex
+	std::unordered_set<std::shared_ptr<Log>> report_pending_logs;
+
+	std::mutex resumed_logs_mutex;
+	std::unordered_set<std::shared_ptr<Log>> resumed_logs;
+
+	// cleared once Wingman rejects gzip compressed reports, uploads are sent uncompressed for the rest of the session
+	std::atomic<bool> compression_supported = true;
 
-	bool get_server_availability();
+	std::mutex server_availability_mutex;
+	std::condition_variable_any server_availability_cv;
+	std::chrono::steady_clock::time_point last_availability_check{};
+	bool availability_check_running = false;
+	std::thread availability_thread;
 };
 
 DECLARE_MODULE(WingmanUploader, wingman_uploader)
@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+"""Writes synthetic arcdps logs (revision 1 evtc, optionally zipped as zevtc) for benchmarks and fuzzing.
+
+The layout matches what EVTCParser::parse reads: a 16 byte header, 96 byte agents, 68 byte skills and
+64 byte combat events. Output is deterministic for a given seed, zevtc archives included.
+
+    evtc_generator.py generate out.zevtc --trigger ValeGuardian --players 10 --duration 300 --event-rate 2000
+    evtc_generator.py generate out.evtc --size 50M --seed 7
+    evtc_generator.py corpus corpus/ --sizes 1M,10M,100M,500M --formats evtc,zevtc
+    evtc_generator.py corpus replay/ --sizes 1M --formats zevtc --count 20
+"""
+
+import argparse
+import json
+import random
+import re
+import struct
+import sys
+import zipfile
+from pathlib import Path
+
+EVTC_H = Path(__file__).resolve().parent.parent / "log_uploader" / "evtc.h"
+
+HEADER_SIZE = 16
+AGENT = struct.Struct("<QIIhhhhhh64sI")
+SKILL = struct.Struct("<i64s")
+# time, src_agent, dst_agent, value, buff_dmg, overstack_value, skillid, src/dst/src_master/dst_master instid,
+# iff, buff, result, is_activation, is_buffremove, is_ninety, is_fifty, is_moving, is_statechange, is_flanking, is_shields, is_offcycle, pad
+EVENT = struct.Struct("<QQQiiIIHHHHBBBBBBBBBBBBI")
+
+assert AGENT.size == 96 and SKILL.size == 68 and EVENT.size == 64
+
+STATECHANGE_NONE = 0
+STATECHANGE_ENTER_COMBAT = 1
+STATECHANGE_HEALTH_UPDATE = 8
+STATECHANGE_LOG_START = 9
+STATECHANGE_LOG_END = 10
+
+NPC_ELITE = 0xFFFFFFFF
+EVENTS_PER_CHUNK = 65536
+ZIP_TIME = (2024, 1, 1, 0, 0, 0)
+SERVER_TIME = 1704106800  # 2024-01-01 11:00:00 UTC, shifted by the seed so logs of a corpus differ
+
+
+def read_trigger_ids():
+    """Maps the TriggerID enumerators of evtc.h to their values."""
+    source = EVTC_H.read_text(encoding="utf-8")
+    block = re.search(r"enum class TriggerID[^{]*\{(.*?)\};", source, re.S)
+
+    if not block:
+        sys.exit(f"TriggerID enum not found in {EVTC_H}")
+
+    return {name: int(value) for name, value in re.findall(r"^\s*(\w+)\s*=\s*(\d+)\s*,", block.group(1), re.M)}
+
+
+def parse_trigger(value):
+    if value.isdigit():
+        return int(value)
+
+    trigger_ids = read_trigger_ids()
+
+    if value not in trigger_ids:
+        sys.exit(f"Unknown TriggerID {value}, see {EVTC_H}")
+
+    return trigger_ids[value]
+
+
+def parse_size(value):
+    match = re.fullmatch(r"(\d+)([KMG]?)B?", value.strip().upper())
+
+    if not match:
+        raise argparse.ArgumentTypeError(f"invalid size: {value}")
+
+    return int(match.group(1)) * {"": 1, "K": 1 << 10, "M": 1 << 20, "G": 1 << 30}[match.group(2)]
+
+
+class Layout:
+    """Agents and skills of a log, the player count sets the squad size."""
+
+    def __init__(self, rng, trigger_id, players, enemies, skills):
+        self.players = []
+        self.enemies = []
+        self.agents = []
+
+        for i in range(players):
+            address = 0x1000 + i
+            name = f"Player {i}\0:Account.{rng.randrange(1000, 9999)}\0{1 + i // 5}\0".encode()
+            self.agents.append(AGENT.pack(address, rng.randrange(1, 10), rng.choice((0, 5, 18, 27, 40, 55, 62, 81)), 0, 0, 0, 48, 0, 48, name, 0))
+            self.players.append((address, 100 + i))
+
+        for i in range(enemies):
+            address = 0x100000 + i
+            # the boss is the first npc, its species id is the trigger id
+            species = trigger_id if i == 0 else rng.randrange(1, 0xFFFF)
+            self.agents.append(AGENT.pack(address, species, NPC_ELITE, 0, 0, 0, 400, 0, 400, f"Enemy {i}\0".encode(), 0))
+            self.enemies.append((address, 1000 + i))
+
+        self.skills = [SKILL.pack(1000 + i, f"Skill {i}".encode()) for i in range(skills)]
+
+    def get_header(self, trigger_id):
+        return b"EVTC" + b"20240612" + bytes([1]) + struct.pack("<H", trigger_id) + b"\0"
+
+    def get_tables(self):
+        return b"".join([struct.pack("<I", len(self.agents)), *self.agents, struct.pack("<I", len(self.skills)), *self.skills])
+
+
+def generate_events(rng, layout, event_count, duration_ms, server_time):
+    """Yields chunks of packed events: LogStart, combat spread evenly over the duration, LogEnd."""
+    start = 0x10000000
+    boss_address, boss_instid = layout.enemies[0]
+    buffer = bytearray(EVENTS_PER_CHUNK * EVENT.size)
+    pack_into = EVENT.pack_into
+    uniform = rng.random
+    players = layout.players
+    enemies = layout.enemies
+    skill_count = len(layout.skills)
+    step = duration_ms / max(event_count - 2, 1)
+
+    # LogStart carries the server timestamp in value and the local one in buff_dmg
+    pack_into(buffer, 0, start, 0, 0, server_time, server_time, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, STATECHANGE_LOG_START, 0, 0, 0, 0)
+    position = 1
+
+    for i in range(event_count - 2):
+        time = start + int(i * step)
+        roll = uniform()
+        source_address, source_instid = players[int(uniform() * len(players))]
+        skill_id = 1000 + int(uniform() * skill_count)
+
+        if roll < 0.7:
+            # direct damage to an enemy, mostly the boss
+            target_address, target_instid = (boss_address, boss_instid) if uniform() < 0.8 else enemies[int(uniform() * len(enemies))]
+            pack_into(buffer, position * EVENT.size, time, source_address, target_address, int(uniform() * 20000), 0, 0, skill_id, source_instid, target_instid, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, STATECHANGE_NONE,
+                int(uniform() < 0.5), 0, 0, 0)
+        elif roll < 0.95:
+            # boon applied to a squad member
+            target_address, target_instid = players[int(uniform() * len(players))]
+            pack_into(buffer, position * EVENT.size, time, source_address, target_address, int(uniform() * 5000), 0, 0, skill_id, source_instid, target_instid, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, STATECHANGE_NONE, 0,
+                0, 0, 0)
+        elif roll < 0.99:
+            # boss health in hundredths of a percent
+            health = max(0, 10000 - int(10000 * i / event_count))
+            pack_into(buffer, position * EVENT.size, time, boss_address, health, 0, 0, 0, 0, boss_instid, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, STATECHANGE_HEALTH_UPDATE, 0, 0, 0, 0)
+        else:
+            pack_into(buffer, position * EVENT.size, time, source_address, 1 + source_instid % 10, 0, 0, 0, 0, source_instid, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, STATECHANGE_ENTER_COMBAT, 0, 0, 0, 0)
+
+        position += 1
+
+        if position == EVENTS_PER_CHUNK:
+            yield bytes(buffer)
+            position = 0
+
+    pack_into(buffer, position * EVENT.size, start + duration_ms, 0, 0, server_time + duration_ms // 1000, server_time + duration_ms // 1000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        STATECHANGE_LOG_END, 0, 0, 0, 0)
+    position += 1
+
+    yield bytes(buffer[: position * EVENT.size])
+
+
+def write_log(output, trigger_id, players, enemies, skills, duration, event_rate, size, seed):
+    """Writes one log, returns its uncompressed size and event count."""
+    rng = random.Random(seed)
+    layout = Layout(rng, trigger_id, players, enemies, skills)
+    header = layout.get_header(trigger_id) + layout.get_tables()
+
+    if size is not None:
+        event_count = max((size - len(header)) // EVENT.size, 2)
+        duration_ms = int(event_count / event_rate * 1000)
+    else:
+        duration_ms = int(duration * 1000)
+        event_count = max(int(duration * event_rate), 2)
+
+    server_time = SERVER_TIME + seed % 100000 * 600
+    chunks = generate_events(rng, layout, event_count, duration_ms, server_time)
+    output = Path(output)
+    output.parent.mkdir(parents=True, exist_ok=True)
+
+    if output.suffix == ".zevtc":
+        # fixed timestamp and attributes keep the archive byte for byte reproducible
+        info = zipfile.ZipInfo(output.stem + ".evtc", date_time=ZIP_TIME)
+        info.compress_type = zipfile.ZIP_DEFLATED
+        info.create_system = 0
+
+        with zipfile.ZipFile(output, "w") as archive, archive.open(info, "w", force_zip64=len(header) + event_count * EVENT.size >= 0xFFFFFFFF) as file:
+            file.write(header)
+            for chunk in chunks:
+                file.write(chunk)
+    else:
+        with open(output, "wb") as file:
+            file.write(header)
+            for chunk in chunks:
+                file.write(chunk)
+
+    return len(header) + event_count * EVENT.size, event_count
+
+
+def add_log_options(parser):
+    parser.add_argument("--trigger", default="ValeGuardian", help="TriggerID name from evtc.h or its numeric value (default: ValeGuardian)")
+    parser.add_argument("--players", type=int, default=10, help="squad members, each an agent with an account name (default: 10)")
+    parser.add_argument("--enemies", type=int, default=4, help="npc agents, the first one is the boss (default: 4)")
+    parser.add_argument("--skills", type=int, default=200, help="entries in the skill table (default: 200)")
+    parser.add_argument("--event-rate", type=float, default=2000, help="combat events per second of fight (default: 2000)")
+    parser.add_argument("--seed", type=int, default=1, help="random seed, equal seeds produce identical files (default: 1)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    generate = commands.add_parser("generate", help="write a single .evtc or .zevtc")
+    generate.add_argument("output", help="file to write, the extension selects evtc or zevtc")
+    add_log_options(generate)
+    length = generate.add_mutually_exclusive_group()
+    length.add_argument("--duration", type=float, default=300, help="fight length in seconds (default: 300)")
+    length.add_argument("--size", type=parse_size, help="uncompressed size such as 1M or 500M, overrides the duration")
+
+    corpus = commands.add_parser("corpus", help="write logs of several sizes and formats with a manifest.json")
+    corpus.add_argument("directory")
+    add_log_options(corpus)
+    corpus.add_argument("--sizes", default="1M,10M,100M,500M", help="comma separated uncompressed sizes (default: 1M,10M,100M,500M)")
+    corpus.add_argument("--formats", default="evtc,zevtc", help="comma separated extensions (default: evtc,zevtc)")
+    corpus.add_argument("--count", type=int, default=1, help="distinct logs per size, each with a seed of its own (default: 1)")
+
+    args = parser.parse_args()
+    trigger_id = parse_trigger(args.trigger)
+
+    if args.players < 1 or args.enemies < 1 or args.skills < 1 or args.event_rate <= 0:
+        sys.exit("players, enemies, skills and event rate must be positive")
+
+    if args.command == "corpus" and args.count < 1:
+        sys.exit("count must be positive")
+
+    if args.command == "generate":
+        size, events = write_log(args.output, trigger_id, args.players, args.enemies, args.skills, args.duration, args.event_rate, args.size, args.seed)
+        print(f"{args.output}: {events} events, {size} bytes uncompressed")
+        return
+
+    directory = Path(args.directory)
+    manifest = []
+
+    for size_index, size_text in enumerate(args.sizes.split(",")):
+        size = parse_size(size_text)
+
+        for index in range(args.count):
+            # a single log per size keeps the names and seeds of earlier corpora
+            suffix = f"-{index:03d}" if args.count > 1 else ""
+
+            for extension in args.formats.split(","):
+                output = directory / f"{trigger_id}-{size_text.strip().lower()}{suffix}.{extension.strip()}"
+                # the same seed per size and index, so the evtc and zevtc of a log hold the same log
+                seed = args.seed + size_index * args.count + index
+                evtc_size, events = write_log(output, trigger_id, args.players, args.enemies, args.skills, None, args.event_rate, size, seed)
+                manifest.append({"file": output.name, "trigger_id": trigger_id, "evtc_size": evtc_size, "file_size": output.stat().st_size, "events": events, "seed": seed})
+                print(f"{output}: {events} events, {evtc_size} bytes uncompressed, {output.stat().st_size} bytes on disk")
+
+    (directory / "manifest.json").write_text(json.dumps(manifest, indent=2) + "\n")
+
+
+if __name__ == "__main__":
+    main()
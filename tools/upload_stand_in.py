@@ -0,0 +1,295 @@
+#!/usr/bin/env python3
+"""Local stand-in for the dps.report and Wingman upload endpoints.
+
+Implements /uploadContent (dps.report) and /testConnection, /checkUpload, /uploadProcessed (Wingman) the way the
+uploaders use them, with configurable latency, error rate, 429 bursts and a bandwidth cap. Point the server URL
+options of the addon, or the --stand-in option of the log_uploader_replay benchmark, at it:
+
+    upload_stand_in.py --port 8080 --latency 300 --error-rate 0.05 --burst-interval 60 --burst-duration 5 --throughput 2048
+
+GET /stats returns request counts, status codes, bytes received and handling times per endpoint, POST /reset clears them.
+"""
+
+import argparse
+import json
+import random
+import re
+import secrets
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+UPLOAD_ENDPOINTS = ("/uploadContent", "/uploadProcessed")
+ENDPOINTS = ("/uploadContent", "/testConnection", "/checkUpload", "/uploadProcessed")
+READ_CHUNK_SIZE = 64 * 1024
+
+
+class Bandwidth:
+    """Token bucket shared by all connections, caps the bytes read from request bodies per second."""
+
+    def __init__(self, bytes_per_second):
+        self.bytes_per_second = bytes_per_second
+        self.available = float(bytes_per_second)
+        self.last_refill = time.monotonic()
+        self.lock = threading.Lock()
+
+    def consume(self, size):
+        if self.bytes_per_second <= 0:
+            return
+
+        while True:
+            with self.lock:
+                now = time.monotonic()
+                self.available = min(self.bytes_per_second, self.available + (now - self.last_refill) * self.bytes_per_second)
+                self.last_refill = now
+
+                if self.available >= size or self.available >= self.bytes_per_second:
+                    self.available -= size
+                    return
+
+                wait = (min(size, self.bytes_per_second) - self.available) / self.bytes_per_second
+
+            time.sleep(wait)
+
+
+class Statistics:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        with self.lock:
+            self.started = time.monotonic()
+            self.endpoints = {endpoint: {"requests": 0, "statuses": {}, "bytes_received": 0, "handling_ms": []} for endpoint in ENDPOINTS}
+
+    def record(self, endpoint, status, bytes_received, handling_ms):
+        with self.lock:
+            entry = self.endpoints[endpoint]
+            entry["requests"] += 1
+            entry["statuses"][str(status)] = entry["statuses"].get(str(status), 0) + 1
+            entry["bytes_received"] += bytes_received
+            entry["handling_ms"].append(handling_ms)
+
+    def to_json(self):
+        with self.lock:
+            result = {"elapsed_s": time.monotonic() - self.started, "endpoints": {}}
+
+            for endpoint, entry in self.endpoints.items():
+                times = sorted(entry["handling_ms"])
+                percentile = lambda p: times[min(len(times) - 1, int(p / 100 * len(times)))] if times else 0
+                result["endpoints"][endpoint] = {"requests": entry["requests"], "statuses": entry["statuses"], "bytes_received": entry["bytes_received"], "p50_ms": percentile(50),
+                    "p99_ms": percentile(99), "max_ms": times[-1] if times else 0}
+
+            return result
+
+
+def parse_multipart(content_type, body):
+    """Returns the parts of a multipart/form-data body as {name: (filename, content)}."""
+    match = re.search(r'boundary="?([^";]+)"?', content_type or "")
+
+    if not match:
+        return {}
+
+    parts = {}
+
+    for part in body.split(b"--" + match.group(1).encode())[1:]:
+        if part.startswith(b"--"):
+            break
+
+        headers, _, content = part.strip(b"\r\n").partition(b"\r\n\r\n")
+        disposition = re.search(rb'name="([^"]*)"(?:; filename="([^"]*)")?', headers)
+
+        if disposition:
+            filename = disposition.group(2).decode(errors="replace") if disposition.group(2) is not None else None
+            parts[disposition.group(1).decode(errors="replace")] = (filename, content)
+
+    return parts
+
+
+class StandIn:
+    def __init__(self, options):
+        self.options = options
+        self.random = random.Random(options.seed)
+        self.random_lock = threading.Lock()
+        self.bandwidth = Bandwidth(options.throughput * 1024)
+        self.statistics = Statistics()
+        self.started = time.monotonic()
+        # evtc name and size of the logs Wingman already has, checkUpload answers False for them
+        self.wingman_logs = set()
+        self.wingman_lock = threading.Lock()
+
+    def roll(self):
+        with self.random_lock:
+            return self.random.random()
+
+    def get_latency(self, endpoint):
+        latency = self.options.latency if endpoint in UPLOAD_ENDPOINTS else self.options.check_latency
+        return max(0.0, latency + (self.roll() * 2 - 1) * self.options.latency_jitter) / 1000
+
+    def in_burst(self):
+        if self.options.burst_interval <= 0:
+            return False
+
+        return (time.monotonic() - self.started) % self.options.burst_interval < self.options.burst_duration
+
+    def get_failure(self, endpoint):
+        """Status and headers of an injected failure, or None to handle the request normally."""
+        if self.in_burst():
+            return 429, {"Retry-After": str(self.options.retry_after)}
+
+        if self.roll() < self.options.error_rate:
+            return (500, 502, 503)[int(self.roll() * 3)], {}
+
+        return None
+
+    def handle(self, endpoint, query, content_type, body):
+        """Returns status, headers and body of a request that is not failed on purpose."""
+        if endpoint == "/testConnection":
+            return 200, {}, b"True"
+
+        parts = parse_multipart(content_type, body)
+
+        if endpoint == "/uploadContent":
+            if "file" not in parts:
+                return 400, {"Content-Type": "application/json"}, json.dumps({"error": "No file uploaded"}).encode()
+
+            upload_id = secrets.token_hex(4) + "-" + re.sub(r"[^0-9A-Za-z]", "", (parts["file"][0] or "log"))[:24]
+            user_token = query.get("userToken", [secrets.token_hex(16)])[0]
+            response = {"id": upload_id, "permalink": f"http://{self.options.host}:{self.options.port}/{upload_id}", "userToken": user_token, "error": None}
+
+            return 200, {"Content-Type": "application/json"}, json.dumps(response).encode()
+
+        if endpoint == "/checkUpload":
+            key = (parts.get("file", (None, b""))[1], parts.get("filesize", (None, b""))[1])
+
+            with self.wingman_lock:
+                return 200, {}, b"False" if key in self.wingman_logs else b"True"
+
+        if endpoint == "/uploadProcessed":
+            if "file" not in parts or "jsonfile" not in parts or "htmlfile" not in parts:
+                return 200, {}, b"False"
+
+            if self.options.reject_gzip and any((parts[name][0] or "").endswith(".gz") for name in ("jsonfile", "htmlfile")):
+                return 415, {}, b"Unsupported Media Type"
+
+            filename = (parts["file"][0] or "").encode()
+
+            with self.wingman_lock:
+                self.wingman_logs.add((filename, str(len(parts["file"][1])).encode()))
+
+            return 200, {}, b"True"
+
+        return 404, {}, b"Not Found"
+
+
+def make_handler(stand_in):
+    class Handler(BaseHTTPRequestHandler):
+        # keep-alive, the dps.report uploader reuses its connection between uploads
+        protocol_version = "HTTP/1.1"
+        # headers and body are written separately, delayed acks would otherwise add 40 ms to every answer
+        disable_nagle_algorithm = True
+
+        def log_message(self, format, *args):
+            if stand_in.options.verbose:
+                super().log_message(format, *args)
+
+        def respond(self, status, headers, body):
+            self.send_response(status)
+            for name, value in headers.items():
+                self.send_header(name, value)
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def read_body(self):
+            remaining = int(self.headers.get("Content-Length", 0))
+            chunks = []
+
+            while remaining > 0:
+                chunk = self.rfile.read(min(READ_CHUNK_SIZE, remaining))
+
+                if not chunk:
+                    break
+
+                stand_in.bandwidth.consume(len(chunk))
+                chunks.append(chunk)
+                remaining -= len(chunk)
+
+            return b"".join(chunks)
+
+        def serve(self):
+            start = time.monotonic()
+            url = urlsplit(self.path)
+            body = self.read_body() if self.command == "POST" else b""
+
+            if url.path == "/stats":
+                return self.respond(200, {"Content-Type": "application/json"}, json.dumps(stand_in.statistics.to_json(), indent=2).encode())
+
+            if url.path == "/reset":
+                stand_in.statistics.reset()
+                return self.respond(200, {}, b"True")
+
+            if url.path not in ENDPOINTS:
+                return self.respond(404, {}, b"Not Found")
+
+            time.sleep(stand_in.get_latency(url.path))
+
+            failure = stand_in.get_failure(url.path)
+
+            if failure:
+                status, headers = failure
+                response = (status, headers, b"Too Many Requests" if status == 429 else b"Server Error")
+            else:
+                response = stand_in.handle(url.path, parse_qs(url.query), self.headers.get("Content-Type"), body)
+
+            self.respond(*response)
+            stand_in.statistics.record(url.path, response[0], len(body), (time.monotonic() - start) * 1000)
+
+        do_GET = serve
+        do_POST = serve
+
+    return Handler
+
+
+def add_options(parser):
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--latency", type=float, default=200, help="ms before uploadContent and uploadProcessed answer (default: 200)")
+    parser.add_argument("--check-latency", type=float, default=20, help="ms before testConnection and checkUpload answer (default: 20)")
+    parser.add_argument("--latency-jitter", type=float, default=0, help="latencies vary uniformly by up to this many ms (default: 0)")
+    parser.add_argument("--error-rate", type=float, default=0, help="fraction of requests answered with 500, 502 or 503 (default: 0)")
+    parser.add_argument("--burst-interval", type=float, default=0, help="every this many seconds a burst of 429 answers starts, 0 to disable (default: 0)")
+    parser.add_argument("--burst-duration", type=float, default=5, help="seconds each 429 burst lasts (default: 5)")
+    parser.add_argument("--retry-after", type=int, default=5, help="Retry-After seconds sent with 429 answers (default: 5)")
+    parser.add_argument("--throughput", type=float, default=0, help="KiB/s of request bodies read across all connections, 0 for unlimited (default: 0)")
+    parser.add_argument("--reject-gzip", action="store_true", help="answer uploadProcessed with gzip compressed reports with 415")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+
+
+def start(options):
+    """Starts the stand-in on a background thread, returns the server."""
+    server = ThreadingHTTPServer((options.host, options.port), make_handler(StandIn(options)))
+    server.daemon_threads = True
+    options.port = server.server_address[1]
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    add_options(parser)
+    options = parser.parse_args()
+
+    server = start(options)
+    print(f"Serving dps.report and Wingman stand-in on http://{options.host}:{options.port}")
+
+    try:
+        threading.Event().wait()
+    except KeyboardInterrupt:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()